@@ -49,7 +49,7 @@ namespace dae
 		static ColorRGB FresnelFunction_Schlick(const Vector3& h, const Vector3& v, const ColorRGB& f0)
 		{
 			constexpr ColorRGB basicColor { 1,1,1 };
-			const ColorRGB intermediate{ f0 + (basicColor - f0) * (std::powf(1 - Vector3::Dot(h, v), 5)) };
+			const ColorRGB intermediate{ f0 + (basicColor - f0) * (std::pow(1 - Vector3::Dot(h, v), 5)) };
 
 			return intermediate;
 		}
@@ -0,0 +1,423 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <utility>
+
+#include "ThreadPool.h"
+
+namespace dae
+{
+	namespace
+	{
+		struct BVHBin
+		{
+			Vector3 minAABB{ FLT_MAX, FLT_MAX, FLT_MAX };
+			Vector3 maxAABB{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			uint32_t primitiveCount{};
+
+			void Grow(const Vector3& minPoint, const Vector3& maxPoint)
+			{
+				minAABB = Vector3::Min(minAABB, minPoint);
+				maxAABB = Vector3::Max(maxAABB, maxPoint);
+			}
+		};
+
+		//Half the surface area of a box, the constant factor cancels out in the heuristic
+		float HalfArea(const Vector3& minAABB, const Vector3& maxAABB)
+		{
+			const Vector3 extent{ maxAABB - minAABB };
+			return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+		}
+	}
+
+	void BVH::Build(const std::vector<Vector3>& positions, const std::vector<int>& indices, uint32_t maxLeafSize)
+	{
+		Clear();
+		m_MaxLeafSize = maxLeafSize;
+
+		const uint32_t triangleCount{ static_cast<uint32_t>(indices.size() / 3) };
+		m_PrimitiveMin.resize(triangleCount);
+		m_PrimitiveMax.resize(triangleCount);
+		m_Centroids.resize(triangleCount);
+		for (uint32_t triangle{ 0 }; triangle < triangleCount; ++triangle)
+		{
+			const Vector3& v0{ positions[indices[triangle * 3]] };
+			const Vector3& v1{ positions[indices[triangle * 3 + 1]] };
+			const Vector3& v2{ positions[indices[triangle * 3 + 2]] };
+
+			m_PrimitiveMin[triangle] = Vector3::Min(v0, Vector3::Min(v1, v2));
+			m_PrimitiveMax[triangle] = Vector3::Max(v0, Vector3::Max(v1, v2));
+			m_Centroids[triangle] = (v0 + v1 + v2) / 3.f;
+		}
+
+		BuildFromPrimitiveBounds();
+	}
+
+	void BVH::Build(const std::vector<Vector3>& minAABBs, const std::vector<Vector3>& maxAABBs, uint32_t maxLeafSize)
+	{
+		Clear();
+		m_MaxLeafSize = maxLeafSize;
+
+		m_PrimitiveMin = minAABBs;
+		m_PrimitiveMax = maxAABBs;
+		m_Centroids.resize(minAABBs.size());
+		for (size_t primitive{ 0 }; primitive < minAABBs.size(); ++primitive)
+		{
+			m_Centroids[primitive] = (minAABBs[primitive] + maxAABBs[primitive]) * .5f;
+		}
+
+		BuildFromPrimitiveBounds();
+	}
+
+	void BVH::Refit(const std::vector<Vector3>& minAABBs, const std::vector<Vector3>& maxAABBs, ThreadPool* pThreadPool)
+	{
+		if (m_Nodes.empty())
+			return;
+
+		if (!pThreadPool || pThreadPool->GetThreadCount() == 1 || m_Nodes.size() < MinParallelRefitNodes)
+		{
+			//Children are always stored after their parent, so a reverse sweep visits them first
+			float summedCost{ 0.f };
+			for (size_t nodeIndex{ m_Nodes.size() }; nodeIndex-- > 0;)
+			{
+				summedCost += RefitNode(static_cast<uint32_t>(nodeIndex), minAABBs, maxAABBs);
+			}
+			m_SAHCost = NormalizeSAHCost(summedCost);
+			return;
+		}
+
+		//Split the tree breadth first until there are a few subtrees per thread, so uneven subtrees still balance out
+		const size_t numWantedSubtrees{ static_cast<size_t>(pThreadPool->GetThreadCount()) * 4 };
+		std::vector<uint32_t> topNodes{};
+		std::vector<uint32_t> subtreeRoots{ 0 };
+		while (subtreeRoots.size() < numWantedSubtrees)
+		{
+			std::vector<uint32_t> nextRoots{};
+			nextRoots.reserve(subtreeRoots.size() * 2);
+			for (const uint32_t nodeIndex : subtreeRoots)
+			{
+				const BVHNode& node{ m_Nodes[nodeIndex] };
+				if (node.IsLeaf())
+				{
+					nextRoots.push_back(nodeIndex);
+					continue;
+				}
+				topNodes.push_back(nodeIndex);
+				nextRoots.push_back(node.leftFirst);
+				nextRoots.push_back(node.leftFirst + 1);
+			}
+			if (nextRoots.size() == subtreeRoots.size())
+				break;
+			subtreeRoots = std::move(nextRoots);
+		}
+
+		std::vector<float> subtreeCosts(subtreeRoots.size());
+		pThreadPool->ParallelFor(static_cast<uint32_t>(subtreeRoots.size()), [&](uint32_t subtree, uint32_t)
+			{
+				subtreeCosts[subtree] = RefitSubtree(subtreeRoots[subtree], minAABBs, maxAABBs);
+			});
+
+		//Breadth first order lists every parent before its children, the reverse is safe to refit
+		float summedCost{ 0.f };
+		for (const float cost : subtreeCosts)
+		{
+			summedCost += cost;
+		}
+		for (size_t i{ topNodes.size() }; i-- > 0;)
+		{
+			summedCost += RefitNode(topNodes[i], minAABBs, maxAABBs);
+		}
+		m_SAHCost = NormalizeSAHCost(summedCost);
+	}
+
+	void BVH::Refit(const std::vector<Vector3>& positions, const std::vector<int>& indices, ThreadPool* pThreadPool)
+	{
+		const uint32_t triangleCount{ static_cast<uint32_t>(indices.size() / 3) };
+		m_PrimitiveMin.resize(triangleCount);
+		m_PrimitiveMax.resize(triangleCount);
+		const auto updateBounds{ [&](uint32_t firstTriangle, uint32_t endTriangle)
+			{
+				for (uint32_t triangle{ firstTriangle }; triangle < endTriangle; ++triangle)
+				{
+					const Vector3& v0{ positions[indices[triangle * 3]] };
+					const Vector3& v1{ positions[indices[triangle * 3 + 1]] };
+					const Vector3& v2{ positions[indices[triangle * 3 + 2]] };
+
+					m_PrimitiveMin[triangle] = Vector3::Min(v0, Vector3::Min(v1, v2));
+					m_PrimitiveMax[triangle] = Vector3::Max(v0, Vector3::Max(v1, v2));
+				}
+			} };
+
+		const uint32_t numChunks{ (triangleCount + RefitBoundsChunkSize - 1) / RefitBoundsChunkSize };
+		if (!pThreadPool || numChunks <= 1)
+		{
+			updateBounds(0, triangleCount);
+		}
+		else
+		{
+			pThreadPool->ParallelFor(numChunks, [&](uint32_t chunk, uint32_t)
+				{
+					updateBounds(chunk * RefitBoundsChunkSize, std::min(triangleCount, (chunk + 1) * RefitBoundsChunkSize));
+				});
+		}
+
+		Refit(m_PrimitiveMin, m_PrimitiveMax, pThreadPool);
+
+		m_PrimitiveMin.clear();
+		m_PrimitiveMax.clear();
+	}
+
+	float BVH::RefitNode(uint32_t nodeIndex, const std::vector<Vector3>& minAABBs, const std::vector<Vector3>& maxAABBs)
+	{
+		BVHNode& node{ m_Nodes[nodeIndex] };
+		if (node.IsLeaf())
+		{
+			node.minAABB = Vector3{ FLT_MAX, FLT_MAX, FLT_MAX };
+			node.maxAABB = Vector3{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			for (uint32_t i{ node.leftFirst }; i < node.leftFirst + node.primitiveCount; ++i)
+			{
+				node.minAABB = Vector3::Min(node.minAABB, minAABBs[m_PrimitiveIndices[i]]);
+				node.maxAABB = Vector3::Max(node.maxAABB, maxAABBs[m_PrimitiveIndices[i]]);
+			}
+			return HalfArea(node.minAABB, node.maxAABB) * static_cast<float>(node.primitiveCount);
+		}
+
+		const BVHNode& leftChild{ m_Nodes[node.leftFirst] };
+		const BVHNode& rightChild{ m_Nodes[node.leftFirst + 1] };
+		node.minAABB = Vector3::Min(leftChild.minAABB, rightChild.minAABB);
+		node.maxAABB = Vector3::Max(leftChild.maxAABB, rightChild.maxAABB);
+		return HalfArea(node.minAABB, node.maxAABB);
+	}
+
+	float BVH::RefitSubtree(uint32_t nodeIndex, const std::vector<Vector3>& minAABBs, const std::vector<Vector3>& maxAABBs)
+	{
+		float summedCost{ 0.f };
+		const BVHNode& node{ m_Nodes[nodeIndex] };
+		if (!node.IsLeaf())
+		{
+			summedCost += RefitSubtree(node.leftFirst, minAABBs, maxAABBs);
+			summedCost += RefitSubtree(node.leftFirst + 1, minAABBs, maxAABBs);
+		}
+		return summedCost + RefitNode(nodeIndex, minAABBs, maxAABBs);
+	}
+
+	float BVH::NormalizeSAHCost(float summedCost) const
+	{
+		const float rootArea{ HalfArea(m_Nodes[0].minAABB, m_Nodes[0].maxAABB) };
+		return rootArea > 0.f ? summedCost / rootArea : 0.f;
+	}
+
+	float BVH::ComputeSAHCost() const
+	{
+		if (m_Nodes.empty())
+			return 0.f;
+
+		float summedCost{ 0.f };
+		for (const BVHNode& node : m_Nodes)
+		{
+			summedCost += HalfArea(node.minAABB, node.maxAABB) * static_cast<float>(node.IsLeaf() ? node.primitiveCount : 1);
+		}
+		return NormalizeSAHCost(summedCost);
+	}
+
+	void BVH::BuildFromPrimitiveBounds()
+	{
+		const uint32_t primitiveCount{ static_cast<uint32_t>(m_Centroids.size()) };
+		m_PrimitiveCount = primitiveCount;
+		if (primitiveCount > 0)
+		{
+			m_PrimitiveIndices.resize(primitiveCount);
+			for (uint32_t primitive{ 0 }; primitive < primitiveCount; ++primitive)
+			{
+				m_PrimitiveIndices[primitive] = primitive;
+			}
+
+			//A binary tree with N leaves never has more than 2N - 1 nodes, reserving keeps node references stable
+			m_Nodes.reserve(static_cast<size_t>(primitiveCount) * 2 - 1);
+
+			BVHNode root{};
+			root.leftFirst = 0;
+			root.primitiveCount = primitiveCount;
+			m_Nodes.push_back(root);
+
+			UpdateNodeBounds(0);
+			Subdivide(0, 0);
+		}
+		m_SAHCost = ComputeSAHCost();
+		m_BuildSAHCost = m_SAHCost;
+
+		m_Centroids.clear();
+		m_PrimitiveMin.clear();
+		m_PrimitiveMax.clear();
+		m_Centroids.shrink_to_fit();
+		m_PrimitiveMin.shrink_to_fit();
+		m_PrimitiveMax.shrink_to_fit();
+	}
+
+	void BVH::AlignLeaves(uint32_t alignment)
+	{
+		std::vector<uint32_t> alignedIndices{};
+		alignedIndices.reserve(m_PrimitiveIndices.size() + m_Nodes.size() * (alignment - 1));
+
+		for (BVHNode& node : m_Nodes)
+		{
+			if (!node.IsLeaf())
+				continue;
+
+			const uint32_t alignedFirst{ static_cast<uint32_t>(alignedIndices.size()) };
+			alignedIndices.insert(alignedIndices.end(), m_PrimitiveIndices.begin() + node.leftFirst, m_PrimitiveIndices.begin() + node.leftFirst + node.primitiveCount);
+			while (alignedIndices.size() % alignment != 0)
+			{
+				alignedIndices.push_back(InvalidPrimitive);
+			}
+			node.leftFirst = alignedFirst;
+		}
+
+		m_PrimitiveIndices = std::move(alignedIndices);
+	}
+
+	void BVH::Clear()
+	{
+		m_Nodes.clear();
+		m_PrimitiveIndices.clear();
+		m_PrimitiveCount = 0;
+		m_SAHCost = 0.f;
+		m_BuildSAHCost = 0.f;
+	}
+
+	void BVH::Assign(std::vector<BVHNode> nodes, std::vector<uint32_t> primitiveIndices, uint32_t primitiveCount, uint32_t maxLeafSize)
+	{
+		m_Nodes = std::move(nodes);
+		m_PrimitiveIndices = std::move(primitiveIndices);
+		m_PrimitiveCount = primitiveCount;
+		m_MaxLeafSize = maxLeafSize;
+		m_SAHCost = ComputeSAHCost();
+		m_BuildSAHCost = m_SAHCost;
+	}
+
+	void BVH::UpdateNodeBounds(uint32_t nodeIndex)
+	{
+		BVHNode& node{ m_Nodes[nodeIndex] };
+		node.minAABB = Vector3{ FLT_MAX, FLT_MAX, FLT_MAX };
+		node.maxAABB = Vector3{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		for (uint32_t i{ node.leftFirst }; i < node.leftFirst + node.primitiveCount; ++i)
+		{
+			const uint32_t primitive{ m_PrimitiveIndices[i] };
+			node.minAABB = Vector3::Min(node.minAABB, m_PrimitiveMin[primitive]);
+			node.maxAABB = Vector3::Max(node.maxAABB, m_PrimitiveMax[primitive]);
+		}
+	}
+
+	void BVH::Subdivide(uint32_t nodeIndex, int depth)
+	{
+		BVHNode& node{ m_Nodes[nodeIndex] };
+		if (node.primitiveCount <= m_MaxLeafSize || depth >= MaxDepth)
+			return;
+
+		int axis{};
+		float splitPosition{};
+		const float splitCost{ FindBestSplit(node, axis, splitPosition) };
+		const float leafCost{ static_cast<float>(node.primitiveCount) * HalfArea(node.minAABB, node.maxAABB) };
+		if (splitCost >= leafCost)
+			return;
+
+		//Partition the primitive slots in place
+		int i{ static_cast<int>(node.leftFirst) };
+		int j{ i + static_cast<int>(node.primitiveCount) - 1 };
+		while (i <= j)
+		{
+			if (m_Centroids[m_PrimitiveIndices[i]][axis] < splitPosition)
+				++i;
+			else
+				std::swap(m_PrimitiveIndices[i], m_PrimitiveIndices[j--]);
+		}
+
+		const uint32_t leftCount{ static_cast<uint32_t>(i) - node.leftFirst };
+		if (leftCount == 0 || leftCount == node.primitiveCount)
+			return;
+
+		const uint32_t leftChildIndex{ static_cast<uint32_t>(m_Nodes.size()) };
+
+		BVHNode leftChild{};
+		leftChild.leftFirst = node.leftFirst;
+		leftChild.primitiveCount = leftCount;
+
+		BVHNode rightChild{};
+		rightChild.leftFirst = static_cast<uint32_t>(i);
+		rightChild.primitiveCount = node.primitiveCount - leftCount;
+
+		m_Nodes.push_back(leftChild);
+		m_Nodes.push_back(rightChild);
+
+		node.leftFirst = leftChildIndex;
+		node.primitiveCount = 0;
+
+		UpdateNodeBounds(leftChildIndex);
+		UpdateNodeBounds(leftChildIndex + 1);
+
+		Subdivide(leftChildIndex, depth + 1);
+		Subdivide(leftChildIndex + 1, depth + 1);
+	}
+
+	float BVH::FindBestSplit(const BVHNode& node, int& axis, float& splitPosition) const
+	{
+		float bestCost{ FLT_MAX };
+		for (int currentAxis{ 0 }; currentAxis < 3; ++currentAxis)
+		{
+			//Bin over the centroid bounds, not the node bounds, so the outer bins are never empty
+			float boundsMin{ FLT_MAX };
+			float boundsMax{ -FLT_MAX };
+			for (uint32_t i{ node.leftFirst }; i < node.leftFirst + node.primitiveCount; ++i)
+			{
+				const float centroid{ m_Centroids[m_PrimitiveIndices[i]][currentAxis] };
+				boundsMin = std::min(boundsMin, centroid);
+				boundsMax = std::max(boundsMax, centroid);
+			}
+			if (boundsMin == boundsMax)
+				continue;
+
+			BVHBin bins[NumBins]{};
+			const float scale{ NumBins / (boundsMax - boundsMin) };
+			for (uint32_t i{ node.leftFirst }; i < node.leftFirst + node.primitiveCount; ++i)
+			{
+				const uint32_t primitive{ m_PrimitiveIndices[i] };
+				const int binIndex{ std::min(NumBins - 1, static_cast<int>((m_Centroids[primitive][currentAxis] - boundsMin) * scale)) };
+				++bins[binIndex].primitiveCount;
+				bins[binIndex].Grow(m_PrimitiveMin[primitive], m_PrimitiveMax[primitive]);
+			}
+
+			//Sweep from both sides to get the area and count left and right of every bin boundary
+			float leftArea[NumBins - 1]{}, rightArea[NumBins - 1]{};
+			uint32_t leftCount[NumBins - 1]{}, rightCount[NumBins - 1]{};
+			BVHBin leftBox{}, rightBox{};
+			uint32_t leftSum{ 0 }, rightSum{ 0 };
+			for (int bin{ 0 }; bin < NumBins - 1; ++bin)
+			{
+				leftSum += bins[bin].primitiveCount;
+				leftCount[bin] = leftSum;
+				leftBox.Grow(bins[bin].minAABB, bins[bin].maxAABB);
+				leftArea[bin] = leftSum > 0 ? HalfArea(leftBox.minAABB, leftBox.maxAABB) : 0.f;
+
+				rightSum += bins[NumBins - 1 - bin].primitiveCount;
+				rightCount[NumBins - 2 - bin] = rightSum;
+				rightBox.Grow(bins[NumBins - 1 - bin].minAABB, bins[NumBins - 1 - bin].maxAABB);
+				rightArea[NumBins - 2 - bin] = rightSum > 0 ? HalfArea(rightBox.minAABB, rightBox.maxAABB) : 0.f;
+			}
+
+			const float binWidth{ (boundsMax - boundsMin) / NumBins };
+			for (int bin{ 0 }; bin < NumBins - 1; ++bin)
+			{
+				const float cost{ leftCount[bin] * leftArea[bin] + rightCount[bin] * rightArea[bin] };
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					axis = currentAxis;
+					splitPosition = boundsMin + binWidth * static_cast<float>(bin + 1);
+				}
+			}
+		}
+		return bestCost;
+	}
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Vector3.h"
+
+namespace dae
+{
+	class ThreadPool;
+
+	//Flat BVH node (32 bytes), children of an inner node are always stored next to each other
+	struct BVHNode
+	{
+		Vector3 minAABB{};
+		uint32_t leftFirst{}; //inner node: index of the left child, leaf: index of the first primitive slot
+		Vector3 maxAABB{};
+		uint32_t primitiveCount{}; //0 for inner nodes
+
+		bool IsLeaf() const { return primitiveCount > 0; }
+	};
+
+	//Builder a MeshGeometry uses for its BVH
+	enum class BVHBuildMethod
+	{
+		SAH, //binned surface area heuristic, slowest to build and fastest to trace
+		Linear, //Morton code LBVH, see LinearBVH
+		LinearTreelets //LBVH followed by treelet restructuring
+	};
+
+	//Node layout single rays trace a MeshGeometry's BVH in, every layout but Binary is a copy built from the binary tree
+	enum class BVHLayout
+	{
+		Binary, //BVHNode, also used by packets
+		Quantized, //8 bit child bounds, see QuantizedBVH
+		Wide4, //4 children per node tested at once, see WideBVH
+		Wide8 //8 children per node, one AVX register per bound when the build targets AVX
+	};
+
+	//Bounding volume hierarchy built with a binned surface area heuristic
+	//Used both per mesh over its triangles (bottom level) and per scene over its objects (top level)
+	class BVH final
+	{
+	public:
+		BVH() = default;
+		~BVH() = default;
+
+		/**
+		 * \brief (Re)builds the hierarchy over the triangles of a mesh
+		 * \param positions vertex positions
+		 * \param indices triangle list, 3 indices per triangle
+		 * \param maxLeafSize nodes with this many primitives or less are never split
+		 */
+		void Build(const std::vector<Vector3>& positions, const std::vector<int>& indices, uint32_t maxLeafSize = DefaultMaxLeafSize);
+		/**
+		 * \brief (Re)builds the hierarchy over arbitrary primitives
+		 * \param minAABBs per primitive bounds minimum
+		 * \param maxAABBs per primitive bounds maximum
+		 * \param maxLeafSize nodes with this many primitives or less are never split
+		 */
+		void Build(const std::vector<Vector3>& minAABBs, const std::vector<Vector3>& maxAABBs, uint32_t maxLeafSize = DefaultMaxLeafSize);
+		//Pads the primitive slots so every leaf starts at a multiple of alignment, padding slots hold InvalidPrimitive
+		void AlignLeaves(uint32_t alignment);
+		/**
+		 * \brief Recomputes all node bounds bottom-up without changing the topology, primitive count must not change
+		 * \param pThreadPool if set, large trees refit their lower subtrees in parallel before the nodes above them
+		 */
+		void Refit(const std::vector<Vector3>& minAABBs, const std::vector<Vector3>& maxAABBs, ThreadPool* pThreadPool = nullptr);
+		//Refit over the triangles of a mesh whose vertices moved, the triangle list itself must be unchanged
+		void Refit(const std::vector<Vector3>& positions, const std::vector<int>& indices, ThreadPool* pThreadPool = nullptr);
+		void Clear();
+		/**
+		 * \brief Takes over a hierarchy that was built before, e.g. read back from a mesh cache
+		 * \param nodes node array as returned by GetNodes
+		 * \param primitiveIndices slot array as returned by GetPrimitiveIndices, padding included
+		 * \param primitiveCount number of real primitives, without padding slots
+		 */
+		void Assign(std::vector<BVHNode> nodes, std::vector<uint32_t> primitiveIndices, uint32_t primitiveCount, uint32_t maxLeafSize);
+		uint32_t GetMaxLeafSize() const { return m_MaxLeafSize; }
+
+		//Expected cost of a random ray relative to testing the root box, in primitive tests, inner nodes count as one test
+		float GetSAHCost() const { return m_SAHCost; }
+		//Cost right after the last build, refits only keep the boxes tight while the topology slowly gets worse
+		float GetBuildSAHCost() const { return m_BuildSAHCost; }
+		//True once refits made the tree RebuildCostRatio times as expensive as it was after its build
+		bool HasDegraded() const { return m_SAHCost > m_BuildSAHCost * RebuildCostRatio; }
+
+		bool IsEmpty() const { return m_Nodes.empty(); }
+		uint32_t GetPrimitiveCount() const { return m_PrimitiveCount; }
+		uint32_t GetSlotCount() const { return static_cast<uint32_t>(m_PrimitiveIndices.size()); }
+		const std::vector<BVHNode>& GetNodes() const { return m_Nodes; }
+		//Maps the primitive slots referenced by the leaves to the original primitive index
+		const std::vector<uint32_t>& GetPrimitiveIndices() const { return m_PrimitiveIndices; }
+
+		Vector3 GetMinAABB() const { return m_Nodes.empty() ? Vector3{} : m_Nodes[0].minAABB; }
+		Vector3 GetMaxAABB() const { return m_Nodes.empty() ? Vector3{} : m_Nodes[0].maxAABB; }
+
+		static constexpr int NumBins{ 16 };
+		static constexpr uint32_t DefaultMaxLeafSize{ 2 };
+		static constexpr uint32_t InvalidPrimitive{ 0xFFFFFFFF };
+		static constexpr int MaxDepth{ 64 };
+		static constexpr float RebuildCostRatio{ 1.5f };
+		//Smaller trees are refit on the calling thread, splitting them costs more than it saves
+		static constexpr size_t MinParallelRefitNodes{ 4096 };
+		//Triangle bounds computed per task of a parallel triangle Refit
+		static constexpr uint32_t RefitBoundsChunkSize{ 8192 };
+
+	private:
+		std::vector<BVHNode> m_Nodes{};
+		std::vector<uint32_t> m_PrimitiveIndices{};
+		uint32_t m_PrimitiveCount{};
+		uint32_t m_MaxLeafSize{ DefaultMaxLeafSize };
+		float m_SAHCost{};
+		float m_BuildSAHCost{};
+
+		//Build data, only valid during Build and the triangle Refit
+		std::vector<Vector3> m_Centroids{};
+		std::vector<Vector3> m_PrimitiveMin{};
+		std::vector<Vector3> m_PrimitiveMax{};
+
+		void BuildFromPrimitiveBounds();
+		//Refits a single node from its primitives or its children and returns its contribution to the SAH cost
+		float RefitNode(uint32_t nodeIndex, const std::vector<Vector3>& minAABBs, const std::vector<Vector3>& maxAABBs);
+		float RefitSubtree(uint32_t nodeIndex, const std::vector<Vector3>& minAABBs, const std::vector<Vector3>& maxAABBs);
+		//Turns the summed node costs into the cost relative to the root box
+		float NormalizeSAHCost(float summedCost) const;
+		float ComputeSAHCost() const;
+		void UpdateNodeBounds(uint32_t nodeIndex);
+		void Subdivide(uint32_t nodeIndex, int depth);
+		float FindBestSplit(const BVHNode& node, int& axis, float& splitPosition) const;
+	};
+}
@@ -0,0 +1,234 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+
+#include "Renderer.h"
+#include "Scene.h"
+#include "Timer.h"
+#include "TriangleSIMD.h"
+
+namespace dae
+{
+	namespace
+	{
+		struct SceneResult
+		{
+			std::string sceneName{};
+			std::vector<double> frameTimes{}; //milliseconds, in render order
+			double mean{}, min{}, max{}, p50{}, p95{}, p99{};
+			double primaryRaysPerSecond{};
+			double raysPerSecond{};
+			RayStatistics statistics{}; //summed over the measured frames
+		};
+
+		//Nearest rank percentile of an ascending list
+		double GetPercentile(const std::vector<double>& sortedValues, double percentile)
+		{
+			if (sortedValues.empty())
+				return 0.0;
+
+			const size_t rank{ static_cast<size_t>(std::ceil(percentile / 100.0 * sortedValues.size())) };
+			return sortedValues[std::clamp<size_t>(rank, 1, sortedValues.size()) - 1];
+		}
+
+		//Sways the camera from side to side and slightly forward, always looking at the same point ahead of its start position
+		void UpdateCameraPath(Camera& camera, const Vector3& startOrigin, const Vector3& startForward, float progress)
+		{
+			const Vector3 right{ Vector3::Cross(Vector3::UnitY, startForward).Normalized() };
+			const Vector3 target{ startOrigin + startForward * 10.f };
+
+			camera.origin = startOrigin + right * (std::sin(progress * PI_2) * 1.5f) + startForward * (progress * 1.f);
+			camera.forward = (target - camera.origin).Normalized();
+			camera.isDirty = true;
+		}
+
+		bool RunScene(const std::string& sceneName, const BenchmarkSettings& settings, Renderer& renderer, SceneResult& result)
+		{
+			const std::unique_ptr<Scene> pScene{ CreateScene(sceneName) };
+			if (!pScene)
+				return false;
+
+			Camera& camera{ pScene->GetCamera() };
+			camera.isInputEnabled = false;
+			pScene->Initialize();
+
+			const Vector3 startOrigin{ camera.origin };
+			const Vector3 startForward{ camera.forward.Normalized() };
+
+			Timer timer{};
+			timer.SetFixedTimeStep(settings.timeStep);
+			timer.Start();
+
+			result.sceneName = sceneName;
+			result.frameTimes.clear();
+			result.frameTimes.reserve(settings.numFrames);
+			result.statistics = {};
+
+			const int totalFrames{ settings.numWarmupFrames + settings.numFrames };
+			for (int frame{ 0 }; frame < totalFrames; ++frame)
+			{
+				pScene->Update(&timer);
+				UpdateCameraPath(camera, startOrigin, startForward, static_cast<float>(frame) / static_cast<float>(totalFrames));
+
+				const auto start{ std::chrono::steady_clock::now() };
+				renderer.Render(pScene.get());
+				const std::chrono::duration<double, std::milli> elapsed{ std::chrono::steady_clock::now() - start };
+				if (frame >= settings.numWarmupFrames)
+				{
+					result.frameTimes.push_back(elapsed.count());
+					for (int i{ 0 }; i < NumRayCounters; ++i)
+					{
+						result.statistics.counts[i] += renderer.GetFrameStatistics().counts[i];
+					}
+				}
+
+				timer.Update();
+			}
+			timer.Stop();
+
+			std::vector<double> sortedTimes{ result.frameTimes };
+			std::sort(sortedTimes.begin(), sortedTimes.end());
+			if (!sortedTimes.empty())
+			{
+				const double totalTime{ std::accumulate(sortedTimes.begin(), sortedTimes.end(), 0.0) };
+				result.mean = totalTime / sortedTimes.size();
+				result.min = sortedTimes.front();
+				result.max = sortedTimes.back();
+				result.primaryRaysPerSecond = static_cast<double>(settings.width) * settings.height * sortedTimes.size() / (totalTime / 1000.0);
+				result.raysPerSecond = static_cast<double>(result.statistics.GetRayCount()) / (totalTime / 1000.0);
+			}
+			result.p50 = GetPercentile(sortedTimes, 50.0);
+			result.p95 = GetPercentile(sortedTimes, 95.0);
+			result.p99 = GetPercentile(sortedTimes, 99.0);
+			return true;
+		}
+
+		//Scene names can be full paths from --scene, quotes, backslashes and control characters are escaped to keep the JSON valid
+		void WriteEscaped(std::ofstream& file, const std::string& text)
+		{
+			for (const char character : text)
+			{
+				if (character == '"' || character == '\\')
+				{
+					file << '\\' << character;
+				}
+				else if (static_cast<unsigned char>(character) < 0x20)
+				{
+					constexpr char hexDigits[]{ "0123456789abcdef" };
+					file << "\\u00" << hexDigits[character >> 4] << hexDigits[character & 0xF];
+				}
+				else
+				{
+					file << character;
+				}
+			}
+		}
+
+		const char* GetCompilerName()
+		{
+#if defined(_MSC_VER)
+#define BENCHMARK_STRINGIZE_VALUE(value) #value
+#define BENCHMARK_STRINGIZE(value) BENCHMARK_STRINGIZE_VALUE(value)
+			return "MSVC " BENCHMARK_STRINGIZE(_MSC_VER);
+#elif defined(__clang__)
+			return "Clang " __clang_version__;
+#elif defined(__GNUC__)
+			return "GCC " __VERSION__;
+#else
+			return "Unknown";
+#endif
+		}
+
+		bool WriteJSON(const BenchmarkSettings& settings, const Renderer& renderer, const std::vector<SceneResult>& results)
+		{
+			std::ofstream file{ settings.outputPath };
+			if (!file)
+				return false;
+
+			file << "{\n";
+			file << "  \"compiler\": \"" << GetCompilerName() << "\",\n";
+			file << "  \"simd\": \"" << TriangleSIMD::ToString(TriangleSIMD::GetActiveLevel()) << "\",\n";
+			file << "  \"width\": " << settings.width << ",\n";
+			file << "  \"height\": " << settings.height << ",\n";
+			file << "  \"threads\": " << renderer.GetThreadCount() << ",\n";
+			file << "  \"tileSize\": " << renderer.GetTileSize() << ",\n";
+			file << "  \"frames\": " << settings.numFrames << ",\n";
+			file << "  \"warmupFrames\": " << settings.numWarmupFrames << ",\n";
+			file << "  \"timeStep\": " << settings.timeStep << ",\n";
+			file << "  \"scenes\": [\n";
+			for (size_t i{ 0 }; i < results.size(); ++i)
+			{
+				const SceneResult& result{ results[i] };
+				file << "    {\n";
+				file << "      \"name\": \"";
+				WriteEscaped(file, result.sceneName);
+				file << "\",\n";
+				file << "      \"meanMs\": " << result.mean << ",\n";
+				file << "      \"minMs\": " << result.min << ",\n";
+				file << "      \"maxMs\": " << result.max << ",\n";
+				file << "      \"p50Ms\": " << result.p50 << ",\n";
+				file << "      \"p95Ms\": " << result.p95 << ",\n";
+				file << "      \"p99Ms\": " << result.p99 << ",\n";
+				file << "      \"primaryRaysPerSecond\": " << result.primaryRaysPerSecond << ",\n";
+				file << "      \"raysPerSecond\": " << result.raysPerSecond << ",\n";
+				file << "      \"perFrame\": {";
+				for (int counter{ 0 }; counter < NumRayCounters; ++counter)
+				{
+					file << (counter == 0 ? "" : ", ") << "\"" << RayStats::ToString(static_cast<RayCounter>(counter)) << "\": "
+						<< result.statistics.counts[counter] / std::max<size_t>(1, result.frameTimes.size());
+				}
+				file << "},\n";
+				file << "      \"frameTimesMs\": [";
+				for (size_t frame{ 0 }; frame < result.frameTimes.size(); ++frame)
+				{
+					file << (frame == 0 ? "" : ", ") << result.frameTimes[frame];
+				}
+				file << "]\n";
+				file << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+			}
+			file << "  ]\n";
+			file << "}\n";
+			return static_cast<bool>(file);
+		}
+	}
+
+	int Benchmark::Run(const BenchmarkSettings& settings)
+	{
+		Renderer renderer{ settings.width, settings.height };
+		if (settings.numThreads > 0)
+			renderer.SetThreadCount(settings.numThreads);
+		if (settings.tileSize > 0)
+			renderer.SetTileSize(settings.tileSize);
+
+		const std::vector<std::string>& sceneNames{ settings.sceneNames.empty() ? GetSceneNames() : settings.sceneNames };
+		std::cout << "**BENCHMARK** " << sceneNames.size() << " scenes, " << settings.numFrames << " frames, "
+			<< settings.width << "x" << settings.height << ", " << renderer.GetThreadCount() << " threads\n";
+
+		std::vector<SceneResult> results(sceneNames.size());
+		for (size_t i{ 0 }; i < sceneNames.size(); ++i)
+		{
+			if (!RunScene(sceneNames[i], settings, renderer, results[i]))
+			{
+				std::cout << "Unknown scene " << sceneNames[i] << std::endl;
+				return 1;
+			}
+
+			std::cout << ">> " << results[i].sceneName << ": P50 = " << results[i].p50 << " ms, P95 = " << results[i].p95
+				<< " ms, P99 = " << results[i].p99 << " ms, " << results[i].raysPerSecond << " rays/s" << std::endl;
+		}
+
+		if (!WriteJSON(settings, renderer, results))
+		{
+			std::cout << "Could not write " << settings.outputPath << std::endl;
+			return 1;
+		}
+		std::cout << "Results written to " << settings.outputPath << std::endl;
+		return 0;
+	}
+}
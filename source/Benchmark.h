@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dae
+{
+	struct BenchmarkSettings
+	{
+		std::vector<std::string> sceneNames{}; //empty runs every built-in scene
+		int width{ 640 };
+		int height{ 480 };
+		uint32_t numThreads{ 0 }; //0 uses every hardware thread
+		int tileSize{ 0 }; //0 keeps the renderer default
+		int numFrames{ 60 };
+		int numWarmupFrames{ 2 }; //rendered before the measurement, they include the first BVH builds
+		float timeStep{ 1.f / 30.f };
+		std::string outputPath{ "benchmark.json" };
+	};
+
+	//Headless, non-interactive frame time measurement to track performance between builds
+	namespace Benchmark
+	{
+		/**
+		 * \brief Renders every scene along a fixed camera path and writes per frame wall times, percentiles and ray throughput as JSON
+		 * \return 0 on success, 1 if a scene is unknown or the JSON file could not be written
+		 */
+		int Run(const BenchmarkSettings& settings);
+	}
+}
@@ -36,6 +36,8 @@ namespace dae
 		float movementSpeed{ 1.f };
 		float rotationSpeed{ 0.5f };
 		float mouseSensitivity{ 0.2f };
+		bool isInputEnabled{ true }; //headless rendering has no keyboard or mouse to read
+		bool isDirty{ true }; //set whenever the view changes, cleared by Scene::ConsumeChanges
 
 		Matrix cameraToWorld{};
 
@@ -43,6 +45,7 @@ namespace dae
 		{
 			fovAngle = newFOV;
 			fovRadians = tan((fovAngle * TO_RADIANS) / 2);
+			isDirty = true;
 		}
 
 		Matrix CalculateCameraToWorld()
@@ -75,6 +78,12 @@ namespace dae
 			//SDL_GetRelativeMouseMode(); //used for locking the mouse to center of screen
 			//SDL_SetRelativeMouseMode(SDL_bool(true));
 
+			if (!isInputEnabled)
+				return;
+
+			const Vector3 previousOrigin{ origin };
+			const Vector3 previousForward{ forward };
+
 			const float deltaTime = pTimer->GetElapsed();
 			float shiftModifier{ 1.f };
 
@@ -194,6 +203,9 @@ namespace dae
 				forward = finalRotation.TransformVector(Vector3::UnitZ);
 				forward.Normalize();
 			}
+
+			if (origin != previousOrigin || forward != previousForward)
+				isDirty = true;
 		}
 	};
 }
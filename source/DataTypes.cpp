@@ -0,0 +1,146 @@
+#include "DataTypes.h"
+
+#include <algorithm>
+
+#include "LinearBVH.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+using namespace dae;
+
+void MeshGeometry::UpdateBVH(ThreadPool* pThreadPool)
+{
+	switch (bvhBuildMethod)
+	{
+	case BVHBuildMethod::SAH:
+		bvh.Build(positions, indices, TriangleBlockSize);
+		break;
+	case BVHBuildMethod::Linear:
+		LinearBVH::Build(bvh, positions, indices, TriangleBlockSize, false, pThreadPool);
+		break;
+	case BVHBuildMethod::LinearTreelets:
+		LinearBVH::Build(bvh, positions, indices, TriangleBlockSize, true, pThreadPool);
+		break;
+	}
+	bvh.AlignLeaves(TriangleBlockSize);
+	minAABB = bvh.GetMinAABB();
+	maxAABB = bvh.GetMaxAABB();
+
+	UpdatePrecomputedTriangles(pThreadPool);
+	UpdateBVHLayout();
+}
+
+void MeshGeometry::UpdateBVHLayout()
+{
+	quantizedBVH.Clear();
+	wideBVH4.Clear();
+	wideBVH8.Clear();
+	switch (bvhLayout)
+	{
+	case BVHLayout::Binary: break;
+	case BVHLayout::Quantized: quantizedBVH.Build(bvh); break;
+	case BVHLayout::Wide4: wideBVH4.Build(bvh); break;
+	case BVHLayout::Wide8: wideBVH8.Build(bvh); break;
+	}
+}
+
+void MeshGeometry::RefitBVH(ThreadPool* pThreadPool)
+{
+	PROFILE_ZONE("MeshGeometry::RefitBVH");
+	arePositionsDirty = false;
+	bvh.Refit(positions, indices, pThreadPool);
+	if (bvh.HasDegraded())
+	{
+		UpdateBVH(pThreadPool);
+		return;
+	}
+
+	minAABB = bvh.GetMinAABB();
+	maxAABB = bvh.GetMaxAABB();
+	UpdatePrecomputedTriangles(pThreadPool);
+	RefitBVHLayout(pThreadPool);
+}
+
+void MeshGeometry::RefitBVHLayout(ThreadPool* pThreadPool)
+{
+	switch (bvhLayout)
+	{
+	case BVHLayout::Binary: break;
+	case BVHLayout::Quantized: quantizedBVH.Refit(bvh, pThreadPool); break;
+	case BVHLayout::Wide4: wideBVH4.Refit(bvh, pThreadPool); break;
+	case BVHLayout::Wide8: wideBVH8.Refit(bvh, pThreadPool); break;
+	}
+}
+
+void MeshGeometry::UpdatePrecomputedTriangles(ThreadPool* pThreadPool)
+{
+	const std::vector<uint32_t>& primitiveIndices{ bvh.GetPrimitiveIndices() };
+	triangles.resize(primitiveIndices.size());
+	triangleBlocks.resize((primitiveIndices.size() + TriangleBlockSize - 1) / TriangleBlockSize);
+
+	const auto precomputeBlocks{ [&](size_t firstBlock, size_t endBlock)
+		{
+			for (size_t slot{ firstBlock * TriangleBlockSize }; slot < std::min(endBlock * TriangleBlockSize, primitiveIndices.size()); ++slot)
+			{
+				const uint32_t triangleIndex{ primitiveIndices[slot] };
+				PrecomputedTriangle& triangle{ triangles[slot] };
+				if (triangleIndex == BVH::InvalidPrimitive)
+				{
+					//Padding slot, a zeroed triangle has a zero determinant and is never hit
+					triangle = PrecomputedTriangle{};
+					triangle.triangleIndex = BVH::InvalidPrimitive;
+				}
+				else
+				{
+					const Vector3& v0{ positions[indices[triangleIndex * 3]] };
+					const Vector3& v1{ positions[indices[triangleIndex * 3 + 1]] };
+					const Vector3& v2{ positions[indices[triangleIndex * 3 + 2]] };
+
+					triangle.v0 = v0;
+					triangle.edge1 = v1 - v0;
+					triangle.edge2 = v2 - v0;
+					triangle.normal = Vector3::Cross(triangle.edge1, triangle.edge2).Normalized();
+					triangle.triangleIndex = triangleIndex;
+				}
+
+				TriangleBlock& block{ triangleBlocks[slot / TriangleBlockSize] };
+				const size_t lane{ slot % TriangleBlockSize };
+				block.v0X[lane] = triangle.v0.x;
+				block.v0Y[lane] = triangle.v0.y;
+				block.v0Z[lane] = triangle.v0.z;
+				block.edge1X[lane] = triangle.edge1.x;
+				block.edge1Y[lane] = triangle.edge1.y;
+				block.edge1Z[lane] = triangle.edge1.z;
+				block.edge2X[lane] = triangle.edge2.x;
+				block.edge2Y[lane] = triangle.edge2.y;
+				block.edge2Z[lane] = triangle.edge2.z;
+			}
+		} };
+
+	const uint32_t numChunks{ static_cast<uint32_t>((triangleBlocks.size() + PrecomputeChunkBlocks - 1) / PrecomputeChunkBlocks) };
+	if (!pThreadPool || numChunks <= 1)
+	{
+		precomputeBlocks(0, triangleBlocks.size());
+		return;
+	}
+	pThreadPool->ParallelFor(numChunks, [&](uint32_t chunk, uint32_t)
+		{
+			precomputeBlocks(static_cast<size_t>(chunk) * PrecomputeChunkBlocks, static_cast<size_t>(chunk + 1) * PrecomputeChunkBlocks);
+		});
+}
+
+void TriangleMesh::UpdateTransforms()
+{
+	PROFILE_ZONE("TriangleMesh::UpdateTransforms");
+	//Geometry changed since the last build (appended triangles, parsed OBJ)
+	if (pGeometry->IsBVHOutdated())
+		pGeometry->UpdateBVH();
+
+	//Calculate Final Transform 
+	worldTransform = scaleTransform * rotationTransform * translationTransform;
+	inverseTransform = Matrix::Inverse(worldTransform);
+	normalTransform = Matrix::Transpose(inverseTransform);
+
+	UpdateTransformedAABB(worldTransform);
+	isDirty = true;
+}
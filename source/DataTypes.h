@@ -1,18 +1,59 @@
 #pragma once
 #include <cassert>
+#include <cstdint>
 
 #include "Math.h"
+#include "BVH.h"
+#include "QuantizedBVH.h"
+#include "WideBVH.h"
+#include "TriangleSIMD.h"
 #include "vector"
+#include <memory>
 
 namespace dae
 {
+	class ThreadPool;
+
+#pragma region MATERIAL HANDLE
+	//Every material type has its own table in the MaterialTable
+	enum class MaterialType : uint32_t
+	{
+		SolidColor,
+		Lambert,
+		LambertPhong,
+		CookTorrence
+	};
+
+	//Compact reference to a material: the type in the top 2 bits, the index into the table of that type in the others
+	//The default handle is the solid red material every scene starts with
+	struct MaterialHandle
+	{
+		static constexpr uint32_t TypeShift{ 30 };
+		static constexpr uint32_t IndexMask{ (1u << TypeShift) - 1 };
+		static constexpr uint32_t MaxIndex{ IndexMask };
+
+		constexpr MaterialHandle() = default;
+		constexpr MaterialHandle(MaterialType type, uint32_t index) :
+			value{ static_cast<uint32_t>(type) << TypeShift | (index & IndexMask) }
+		{
+		}
+
+		constexpr MaterialType GetType() const { return static_cast<MaterialType>(value >> TypeShift); }
+		constexpr uint32_t GetIndex() const { return value & IndexMask; }
+
+		constexpr bool operator==(const MaterialHandle& other) const = default;
+
+		uint32_t value{};
+	};
+#pragma endregion
+
 #pragma region GEOMETRY
 	struct Sphere
 	{
 		Vector3 origin{};
 		float radius{};
 
-		unsigned char materialIndex{ 0 };
+		MaterialHandle material{};
 	};
 
 	struct Plane
@@ -20,7 +61,7 @@ namespace dae
 		Vector3 origin{};
 		Vector3 normal{};
 
-		unsigned char materialIndex{ 0 };
+		MaterialHandle material{};
 	};
 
 	enum class TriangleCullMode
@@ -51,63 +92,42 @@ namespace dae
 		Vector3 normal{};
 
 		TriangleCullMode cullMode{};
-		unsigned char materialIndex{};
+		MaterialHandle material{};
 	};
 
-	struct TriangleMesh
+	//Triangle layout used by the intersection kernel, everything that only depends on the vertices is precomputed
+	struct PrecomputedTriangle
 	{
-		TriangleMesh() = default;
-		TriangleMesh(const std::vector<Vector3>& _positions, const std::vector<int>& _indices, TriangleCullMode _cullMode):
-		positions(_positions), indices(_indices), cullMode(_cullMode)
-		{
-			//Calculate Normals
-			CalculateNormals();
-
-			//Update Transforms
-			UpdateTransforms();
-		}
-
-		TriangleMesh(const std::vector<Vector3>& _positions, const std::vector<int>& _indices, const std::vector<Vector3>& _normals, TriangleCullMode _cullMode) :
-			positions(_positions), indices(_indices), normals(_normals), cullMode(_cullMode)
-		{
-			UpdateTransforms();
-		}
+		Vector3 v0{};
+		Vector3 edge1{}; //v1 - v0
+		Vector3 edge2{}; //v2 - v0
+		Vector3 normal{}; //normalized geometric normal
+		uint32_t triangleIndex{}; //index into the source triangle list
+	};
 
+	//Object space triangle data, shared by every TriangleMesh instance that references it
+	struct MeshGeometry
+	{
 		std::vector<Vector3> positions{};
 		std::vector<Vector3> normals{};
 		std::vector<int> indices{};
-		unsigned char materialIndex{};
 
-		TriangleCullMode cullMode{TriangleCullMode::BackFaceCulling};
+		Vector3 minAABB{};
+		Vector3 maxAABB{};
 
-		Matrix rotationTransform{};
-		Matrix translationTransform{};
-		Matrix scaleTransform{};
-
-		Vector3 minAABB;
-		Vector3 maxAABB;
-		Vector3 transformedMaxAABB;
-		Vector3 transformedMinAABB;
-
-		std::vector<Vector3> transformedPositions{};
-		std::vector<Vector3> transformedNormals{};
-
-		void Translate(const Vector3& translation)
-		{
-			translationTransform = Matrix::CreateTranslation(translation);
-		}
-
-		void RotateY(float yaw)
-		{
-			rotationTransform = Matrix::CreateRotationY(-yaw); //inverted this to fix a mirroring issue
-		}
+		BVH bvh{}; //only rebuilt when the geometry changes
+		BVHBuildMethod bvhBuildMethod{ BVHBuildMethod::SAH };
+		//Single rays trace the copy of bvh this layout asks for, packets keep the binary tree for their frustum tests
+		BVHLayout bvhLayout{ BVHLayout::Binary };
+		QuantizedBVH quantizedBVH{};
+		WideBVH<4> wideBVH4{};
+		WideBVH<8> wideBVH8{};
+		std::vector<PrecomputedTriangle> triangles{}; //stored in BVH leaf order, leaves index them directly
+		std::vector<TriangleBlock> triangleBlocks{}; //same order packed per 8, every leaf starts at a block boundary
 
-		void Scale(const Vector3& scale)
-		{
-			scaleTransform = Matrix::CreateScale(scale);
-		}
+		bool arePositionsDirty{ false }; //set by whoever moves the vertices, Scene::UpdateAccelerationStructure refits the BVH
 
-		void AppendTriangle(const Triangle& triangle, bool ignoreTransformUpdate = false)
+		void AppendTriangle(const Triangle& triangle)
 		{
 			int startIndex = static_cast<int>(positions.size());
 
@@ -120,16 +140,12 @@ namespace dae
 			indices.push_back(++startIndex);
 
 			normals.push_back(triangle.normal);
-
-			//Not ideal, but making sure all vertices are updated
-			if(!ignoreTransformUpdate)
-				UpdateTransforms();
 		}
 
 		void CalculateNormals()
 		{
 			normals.clear();
-			for (int currentTriangle{ 0 }; currentTriangle < indices.size()-2; currentTriangle += 3)
+			for (size_t currentTriangle{ 0 }; currentTriangle + 2 < indices.size(); currentTriangle += 3)
 			{
 				const Vector3 v0{ positions[indices[currentTriangle]] };
 				const Vector3 v1{ positions[indices[currentTriangle + 1]] };
@@ -141,29 +157,27 @@ namespace dae
 			}
 		}
 
-		void UpdateTransforms()
+		bool IsBVHOutdated() const
 		{
-			//Calculate Final Transform 
-			const auto finalTransform = scaleTransform * rotationTransform * translationTransform;
+			return bvh.GetPrimitiveCount() != indices.size() / 3;
+		}
 
-			transformedPositions.clear();
-			transformedNormals.clear();
-			transformedNormals.reserve(normals.size());
-			transformedPositions.reserve(positions.size());
+		void UpdateBVH(ThreadPool* pThreadPool = nullptr);
 
-			//Transform Positions (positions > transformedPositions)
-			for (Vector3& currentPosition : positions)
-			{
-				transformedPositions.emplace_back(finalTransform.TransformPoint(currentPosition));
-			}
-			UpdateTransformedAABB(finalTransform);
+		//Builds the copy of bvh that bvhLayout needs and drops the others
+		void UpdateBVHLayout();
 
-			//Transform Normals (normals > transformedNormals)
-			for (Vector3& currentNormal : normals)
-			{
-				transformedNormals.emplace_back(finalTransform.TransformVector(currentNormal).Normalized());
-			}
-		}
+		//Refits the BVH to the moved vertices, falls back to a full build once the refit tree got too slow to trace
+		void RefitBVH(ThreadPool* pThreadPool = nullptr);
+
+		//Carries a refit of bvh over to the copy bvhLayout uses, the copies keep the topology they were built with
+		void RefitBVHLayout(ThreadPool* pThreadPool = nullptr);
+
+		//Every slot is rewritten, padding included, so refits reuse the arrays without clearing them first
+		void UpdatePrecomputedTriangles(ThreadPool* pThreadPool = nullptr);
+
+		//Triangle blocks precomputed per task of a parallel UpdatePrecomputedTriangles
+		static constexpr size_t PrecomputeChunkBlocks{ 512 };
 
 		void UpdateAABB()
 		{
@@ -178,9 +192,95 @@ namespace dae
 				}
 			}
 		}
+	};
+
+	//Instance of a MeshGeometry, only stores its transform so instances never copy or rewrite vertex data
+	struct TriangleMesh
+	{
+		TriangleMesh() = default;
+		TriangleMesh(const std::vector<Vector3>& _positions, const std::vector<int>& _indices, TriangleCullMode _cullMode):
+			cullMode(_cullMode)
+		{
+			pGeometry->positions = _positions;
+			pGeometry->indices = _indices;
+
+			//Calculate Normals
+			pGeometry->CalculateNormals();
+
+			//Update Transforms
+			UpdateTransforms();
+		}
+
+		TriangleMesh(const std::vector<Vector3>& _positions, const std::vector<int>& _indices, const std::vector<Vector3>& _normals, TriangleCullMode _cullMode) :
+			cullMode(_cullMode)
+		{
+			pGeometry->positions = _positions;
+			pGeometry->indices = _indices;
+			pGeometry->normals = _normals;
+
+			UpdateTransforms();
+		}
+
+		TriangleMesh(const std::shared_ptr<MeshGeometry>& _pGeometry, TriangleCullMode _cullMode) :
+			pGeometry(_pGeometry), cullMode(_cullMode)
+		{
+			UpdateTransforms();
+		}
+
+		std::shared_ptr<MeshGeometry> pGeometry{ std::make_shared<MeshGeometry>() };
+		MaterialHandle material{};
+
+		TriangleCullMode cullMode{TriangleCullMode::BackFaceCulling};
+
+		Matrix rotationTransform{};
+		Matrix translationTransform{};
+		Matrix scaleTransform{};
+
+		Matrix worldTransform{};
+		Matrix inverseTransform{}; //world to object space, used to transform rays
+		Matrix normalTransform{}; //inverse transpose, object to world space normals
+
+		Vector3 transformedMaxAABB;
+		Vector3 transformedMinAABB;
+
+		bool isDirty{ true }; //set by UpdateTransforms, cleared by Scene::ConsumeChanges
+
+		void Translate(const Vector3& translation)
+		{
+			translationTransform = Matrix::CreateTranslation(translation);
+		}
+
+		void RotateY(float yaw)
+		{
+			rotationTransform = Matrix::CreateRotationY(-yaw); //inverted this to fix a mirroring issue
+		}
+
+		void Scale(const Vector3& scale)
+		{
+			scaleTransform = Matrix::CreateScale(scale);
+		}
+
+		void AppendTriangle(const Triangle& triangle, bool ignoreTransformUpdate = false)
+		{
+			pGeometry->AppendTriangle(triangle);
+
+			if(!ignoreTransformUpdate)
+				UpdateTransforms();
+		}
+
+		void UpdateAABB()
+		{
+			pGeometry->UpdateAABB();
+		}
+
+		//O(1) per instance, only the matrices and the world bounds change
+		void UpdateTransforms();
 
 		void UpdateTransformedAABB(const Matrix& finalTransform)
 		{
+			const Vector3& minAABB{ pGeometry->minAABB };
+			const Vector3& maxAABB{ pGeometry->maxAABB };
+
 			Vector3 tMinAABB{ finalTransform.TransformPoint(minAABB) };
 			Vector3 tMaxAABB{ tMinAABB };
 
@@ -208,7 +308,7 @@ namespace dae
 			tMinAABB = Vector3::Min(tAABB, tMinAABB);
 			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
 
-			tAABB = finalTransform.TransformPoint(minAABB.x, maxAABB.y, minAABB.z);
+			tAABB = finalTransform.TransformPoint(minAABB.x, maxAABB.y, maxAABB.z);
 			tMinAABB = Vector3::Min(tAABB, tMinAABB);
 			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
 
@@ -250,9 +350,11 @@ namespace dae
 		Vector3 origin{};
 		Vector3 normal{};
 		float t = FLT_MAX;
+		float u{}; //barycentric coordinates, only set for triangle hits
+		float v{};
 
 		bool didHit{ false };
-		unsigned char materialIndex{ 0 };
+		MaterialHandle material{};
 	};
 #pragma endregion
 }
\ No newline at end of file
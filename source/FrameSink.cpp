@@ -0,0 +1,57 @@
+#include "FrameSink.h"
+
+#include <cstdio>
+#include <iostream>
+
+#include "SDL.h"
+#include "SDL_surface.h"
+
+#include "Profiler.h"
+
+using namespace dae;
+
+WindowSink::WindowSink(SDL_Window* pWindow) :
+	m_pWindow(pWindow)
+{
+}
+
+void WindowSink::Present(const uint32_t* pPixels, int width, int height)
+{
+	//The window surface can use any format, SDL converts while copying
+	SDL_Surface* pSurface{ SDL_GetWindowSurface(m_pWindow) };
+	{
+		PROFILE_ZONE("SDL_ConvertPixels");
+		SDL_ConvertPixels(width, height, SDL_PIXELFORMAT_ARGB8888, pPixels, width * static_cast<int>(sizeof(uint32_t)),
+			pSurface->format->format, pSurface->pixels, pSurface->pitch);
+	}
+	PROFILE_ZONE("SDL_UpdateWindowSurface");
+	SDL_UpdateWindowSurface(m_pWindow);
+}
+
+ImageFileSink::ImageFileSink(const std::string& prefix) :
+	m_Prefix(prefix)
+{
+}
+
+void ImageFileSink::Present(const uint32_t* pPixels, int width, int height)
+{
+	char suffix[16]{};
+	std::snprintf(suffix, sizeof(suffix), "_%04d.bmp", m_FrameIndex++);
+
+	const std::string path{ m_Prefix + suffix };
+	if (SaveImage(pPixels, width, height, path))
+		std::cout << "Could not save " << path << std::endl;
+}
+
+int dae::SaveImage(const uint32_t* pPixels, int width, int height, const std::string& path)
+{
+	//SDL only reads from the pixels while saving, the surface just wraps them
+	SDL_Surface* pSurface{ SDL_CreateRGBSurfaceWithFormatFrom(const_cast<uint32_t*>(pPixels), width, height, 32,
+		width * static_cast<int>(sizeof(uint32_t)), SDL_PIXELFORMAT_ARGB8888) };
+	if (!pSurface)
+		return -1;
+
+	const int result{ SDL_SaveBMP(pSurface, path.c_str()) };
+	SDL_FreeSurface(pSurface);
+	return result;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+struct SDL_Window;
+
+namespace dae
+{
+	//Receives every finished frame of the Renderer, pixels are packed as 0xAARRGGBB
+	class FrameSink
+	{
+	public:
+		FrameSink() = default;
+		virtual ~FrameSink() = default;
+
+		FrameSink(const FrameSink&) = delete;
+		FrameSink(FrameSink&&) noexcept = delete;
+		FrameSink& operator=(const FrameSink&) = delete;
+		FrameSink& operator=(FrameSink&&) noexcept = delete;
+
+		virtual void Present(const uint32_t* pPixels, int width, int height) = 0;
+	};
+
+	//Copies frames to the surface of an SDL window
+	class WindowSink final : public FrameSink
+	{
+	public:
+		explicit WindowSink(SDL_Window* pWindow);
+		~WindowSink() override = default;
+
+		WindowSink(const WindowSink&) = delete;
+		WindowSink(WindowSink&&) noexcept = delete;
+		WindowSink& operator=(const WindowSink&) = delete;
+		WindowSink& operator=(WindowSink&&) noexcept = delete;
+
+		void Present(const uint32_t* pPixels, int width, int height) override;
+
+	private:
+		SDL_Window* m_pWindow{};
+	};
+
+	//Writes every frame to its own numbered BMP file, <prefix>_0000.bmp, <prefix>_0001.bmp, ...
+	class ImageFileSink final : public FrameSink
+	{
+	public:
+		explicit ImageFileSink(const std::string& prefix);
+		~ImageFileSink() override = default;
+
+		ImageFileSink(const ImageFileSink&) = delete;
+		ImageFileSink(ImageFileSink&&) noexcept = delete;
+		ImageFileSink& operator=(const ImageFileSink&) = delete;
+		ImageFileSink& operator=(ImageFileSink&&) noexcept = delete;
+
+		void Present(const uint32_t* pPixels, int width, int height) override;
+
+	private:
+		std::string m_Prefix{};
+		int m_FrameIndex{};
+	};
+
+	/**
+	 * \brief Saves 0xAARRGGBB pixels as a BMP file, works without a window or SDL_Init
+	 * \return 0 on success, like SDL_SaveBMP
+	 */
+	int SaveImage(const uint32_t* pPixels, int width, int height, const std::string& path);
+}
@@ -0,0 +1,527 @@
+#include "LinearBVH.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cfloat>
+#include <memory>
+#include <utility>
+
+#include "BVH.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+using namespace dae;
+
+namespace
+{
+	//Smaller meshes are built on the calling thread, starting a pool for them would take longer than the build
+	constexpr uint32_t MinParallelTriangles{ 16384 };
+	constexpr int RadixBits{ 8 };
+	constexpr uint32_t NumRadixBuckets{ 1u << RadixBits };
+	constexpr int MaxTreeletLeaves{ 7 };
+
+	struct BuildInput
+	{
+		std::vector<Vector3> triangleMin{};
+		std::vector<Vector3> triangleMax{};
+		std::vector<uint64_t> codes{}; //sorted once the codes are computed
+		std::vector<uint32_t> primitiveIndices{}; //sorted along with the codes
+		uint32_t maxLeafSize{};
+	};
+
+	//Half the surface area of a box, the constant factor cancels out in the heuristic
+	float HalfArea(const Vector3& minAABB, const Vector3& maxAABB)
+	{
+		const Vector3 extent{ maxAABB - minAABB };
+		return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+	}
+
+	//Spreads the lowest 10 bits so two zero bits follow every bit
+	uint64_t ExpandBits10(uint32_t value)
+	{
+		value = (value * 0x00010001u) & 0xFF0000FFu;
+		value = (value * 0x00000101u) & 0x0F00F00Fu;
+		value = (value * 0x00000011u) & 0xC30C30C3u;
+		value = (value * 0x00000005u) & 0x49249249u;
+		return value;
+	}
+
+	//Spreads the lowest 21 bits so two zero bits follow every bit
+	uint64_t ExpandBits21(uint64_t value)
+	{
+		value &= 0x1FFFFF;
+		value = (value | value << 32) & 0x1F00000000FFFFull;
+		value = (value | value << 16) & 0x1F0000FF0000FFull;
+		value = (value | value << 8) & 0x100F00F00F00F00Full;
+		value = (value | value << 4) & 0x10C30C30C30C30C3ull;
+		value = (value | value << 2) & 0x1249249249249249ull;
+		return value;
+	}
+
+	//Runs function(chunk) for every chunk, on the pool if there is one
+	template<typename Function>
+	void ForEachChunk(ThreadPool* pThreadPool, uint32_t numChunks, Function&& function)
+	{
+		if (pThreadPool)
+		{
+			pThreadPool->ParallelFor(numChunks, [&](uint32_t chunk, uint32_t) { function(chunk); });
+			return;
+		}
+		for (uint32_t chunk{ 0 }; chunk < numChunks; ++chunk)
+		{
+			function(chunk);
+		}
+	}
+
+	std::pair<size_t, size_t> GetChunkRange(size_t count, uint32_t numChunks, uint32_t chunk)
+	{
+		const size_t chunkSize{ (count + numChunks - 1) / numChunks };
+		return { std::min(count, chunk * chunkSize), std::min(count, (chunk + 1) * chunkSize) };
+	}
+
+	//Quantizes every centroid to the grid over the centroid bounds and interleaves the cell coordinates
+	void ComputeMortonCodes(BuildInput& input, const std::vector<Vector3>& positions, const std::vector<int>& indices, int numCodeBits,
+	                        uint32_t numChunks, ThreadPool* pThreadPool)
+	{
+		PROFILE_ZONE("LinearBVH::ComputeMortonCodes");
+		const size_t triangleCount{ input.triangleMin.size() };
+		std::vector<Vector3> chunkMin(numChunks, Vector3{ FLT_MAX, FLT_MAX, FLT_MAX });
+		std::vector<Vector3> chunkMax(numChunks, Vector3{ -FLT_MAX, -FLT_MAX, -FLT_MAX });
+		ForEachChunk(pThreadPool, numChunks, [&](uint32_t chunk)
+			{
+				const auto [first, last] { GetChunkRange(triangleCount, numChunks, chunk) };
+				for (size_t triangle{ first }; triangle < last; ++triangle)
+				{
+					const Vector3& v0{ positions[indices[triangle * 3]] };
+					const Vector3& v1{ positions[indices[triangle * 3 + 1]] };
+					const Vector3& v2{ positions[indices[triangle * 3 + 2]] };
+					input.triangleMin[triangle] = Vector3::Min(v0, Vector3::Min(v1, v2));
+					input.triangleMax[triangle] = Vector3::Max(v0, Vector3::Max(v1, v2));
+
+					const Vector3 centroid{ (input.triangleMin[triangle] + input.triangleMax[triangle]) * .5f };
+					chunkMin[chunk] = Vector3::Min(chunkMin[chunk], centroid);
+					chunkMax[chunk] = Vector3::Max(chunkMax[chunk], centroid);
+				}
+			});
+
+		Vector3 centroidMin{ chunkMin[0] }, centroidMax{ chunkMax[0] };
+		for (uint32_t chunk{ 1 }; chunk < numChunks; ++chunk)
+		{
+			centroidMin = Vector3::Min(centroidMin, chunkMin[chunk]);
+			centroidMax = Vector3::Max(centroidMax, chunkMax[chunk]);
+		}
+
+		const int bitsPerAxis{ numCodeBits / 3 };
+		const float numCells{ static_cast<float>(1u << bitsPerAxis) };
+		const Vector3 extent{ centroidMax - centroidMin };
+		const Vector3 cellScale{
+			extent.x > 0.f ? numCells / extent.x : 0.f,
+			extent.y > 0.f ? numCells / extent.y : 0.f,
+			extent.z > 0.f ? numCells / extent.z : 0.f };
+
+		ForEachChunk(pThreadPool, numChunks, [&](uint32_t chunk)
+			{
+				const auto [first, last] { GetChunkRange(triangleCount, numChunks, chunk) };
+				for (size_t triangle{ first }; triangle < last; ++triangle)
+				{
+					const Vector3 centroid{ (input.triangleMin[triangle] + input.triangleMax[triangle]) * .5f };
+					uint32_t cells[3]{};
+					for (int axis{ 0 }; axis < 3; ++axis)
+					{
+						const float cell{ (centroid[axis] - centroidMin[axis]) * cellScale[axis] };
+						cells[axis] = static_cast<uint32_t>(std::min(cell, numCells - 1.f));
+					}
+
+					input.codes[triangle] = numCodeBits == 30 ?
+						ExpandBits10(cells[0]) << 2 | ExpandBits10(cells[1]) << 1 | ExpandBits10(cells[2]) :
+						ExpandBits21(cells[0]) << 2 | ExpandBits21(cells[1]) << 1 | ExpandBits21(cells[2]);
+					input.primitiveIndices[triangle] = static_cast<uint32_t>(triangle);
+				}
+			});
+	}
+
+	//Least significant digit first radix sort, every chunk counts and scatters its own part of the array
+	void RadixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, int numKeyBits, uint32_t numChunks, ThreadPool* pThreadPool)
+	{
+		PROFILE_ZONE("LinearBVH::RadixSort");
+		const size_t count{ keys.size() };
+		std::vector<uint64_t> sortedKeys(count);
+		std::vector<uint32_t> sortedValues(count);
+		std::vector<std::array<size_t, NumRadixBuckets>> offsets(numChunks);
+
+		for (int shift{ 0 }; shift < numKeyBits; shift += RadixBits)
+		{
+			ForEachChunk(pThreadPool, numChunks, [&](uint32_t chunk)
+				{
+					const auto [first, last] { GetChunkRange(count, numChunks, chunk) };
+					offsets[chunk].fill(0);
+					for (size_t i{ first }; i < last; ++i)
+					{
+						++offsets[chunk][(keys[i] >> shift) & (NumRadixBuckets - 1)];
+					}
+				});
+
+			//Bucket major prefix sum, earlier chunks go first within a bucket so the sort stays stable
+			size_t sum{ 0 };
+			bool isSingleBucket{ false };
+			for (uint32_t bucket{ 0 }; bucket < NumRadixBuckets; ++bucket)
+			{
+				const size_t bucketStart{ sum };
+				for (uint32_t chunk{ 0 }; chunk < numChunks; ++chunk)
+				{
+					const size_t bucketCount{ offsets[chunk][bucket] };
+					offsets[chunk][bucket] = sum;
+					sum += bucketCount;
+				}
+				isSingleBucket |= sum - bucketStart == count;
+			}
+			//Every key has the same digit, this pass would not move anything
+			if (isSingleBucket)
+				continue;
+
+			ForEachChunk(pThreadPool, numChunks, [&](uint32_t chunk)
+				{
+					const auto [first, last] { GetChunkRange(count, numChunks, chunk) };
+					for (size_t i{ first }; i < last; ++i)
+					{
+						const size_t destination{ offsets[chunk][(keys[i] >> shift) & (NumRadixBuckets - 1)]++ };
+						sortedKeys[destination] = keys[i];
+						sortedValues[destination] = values[i];
+					}
+				});
+			keys.swap(sortedKeys);
+			values.swap(sortedValues);
+		}
+	}
+
+	//First slot of the right child: where the highest bit that differs within the range flips, or the middle if all codes are equal
+	uint32_t FindSplit(const std::vector<uint64_t>& codes, uint32_t first, uint32_t count)
+	{
+		const uint64_t firstCode{ codes[first] };
+		const uint64_t lastCode{ codes[first + count - 1] };
+		if (firstCode == lastCode)
+			return first + count / 2;
+
+		//All codes in the range share the bits above the highest differing bit, so it flips exactly once
+		const int splitBit{ 63 - std::countl_zero(firstCode ^ lastCode) };
+		const auto splitCode{ std::partition_point(codes.begin() + first, codes.begin() + first + count,
+			[splitBit](uint64_t code) { return ((code >> splitBit) & 1) == 0; }) };
+		return static_cast<uint32_t>(splitCode - codes.begin());
+	}
+
+	void UpdateLeafBounds(const BuildInput& input, BVHNode& node)
+	{
+		node.minAABB = Vector3{ FLT_MAX, FLT_MAX, FLT_MAX };
+		node.maxAABB = Vector3{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (uint32_t i{ node.leftFirst }; i < node.leftFirst + node.primitiveCount; ++i)
+		{
+			node.minAABB = Vector3::Min(node.minAABB, input.triangleMin[input.primitiveIndices[i]]);
+			node.maxAABB = Vector3::Max(node.maxAABB, input.triangleMax[input.primitiveIndices[i]]);
+		}
+	}
+
+	//Splits the node into two children like BVH::Subdivide, ranges are kept in leftFirst and primitiveCount until the node is split
+	bool SplitNode(const BuildInput& input, std::vector<BVHNode>& nodes, uint32_t nodeIndex, int depth)
+	{
+		const BVHNode node{ nodes[nodeIndex] };
+		if (node.primitiveCount <= input.maxLeafSize || depth >= BVH::MaxDepth)
+			return false;
+
+		const uint32_t split{ FindSplit(input.codes, node.leftFirst, node.primitiveCount) };
+		const uint32_t leftChildIndex{ static_cast<uint32_t>(nodes.size()) };
+		nodes.push_back(BVHNode{ {}, node.leftFirst, {}, split - node.leftFirst });
+		nodes.push_back(BVHNode{ {}, split, {}, node.leftFirst + node.primitiveCount - split });
+		nodes[nodeIndex].leftFirst = leftChildIndex;
+		nodes[nodeIndex].primitiveCount = 0;
+		return true;
+	}
+
+	void EmitSubtree(const BuildInput& input, std::vector<BVHNode>& nodes, uint32_t nodeIndex, int depth)
+	{
+		if (!SplitNode(input, nodes, nodeIndex, depth))
+		{
+			UpdateLeafBounds(input, nodes[nodeIndex]);
+			return;
+		}
+
+		const uint32_t leftChildIndex{ nodes[nodeIndex].leftFirst };
+		EmitSubtree(input, nodes, leftChildIndex, depth + 1);
+		EmitSubtree(input, nodes, leftChildIndex + 1, depth + 1);
+
+		BVHNode& node{ nodes[nodeIndex] };
+		node.minAABB = Vector3::Min(nodes[leftChildIndex].minAABB, nodes[leftChildIndex + 1].minAABB);
+		node.maxAABB = Vector3::Max(nodes[leftChildIndex].maxAABB, nodes[leftChildIndex + 1].maxAABB);
+	}
+
+	/**
+	 * \brief Rearranges the treelet below rootIndex into the topology with the lowest SAH cost, the subtrees below it stay as they are
+	 * \param subtreeCosts summed SAH cost of every subtree, updated for the rearranged nodes
+	 */
+	void RestructureTreelet(std::vector<BVHNode>& nodes, std::vector<float>& subtreeCosts, uint32_t rootIndex)
+	{
+		//Grow the treelet by opening the largest subtree until it has enough leaves, the slots of every opened pair are reused
+		uint32_t leaves[MaxTreeletLeaves]{ nodes[rootIndex].leftFirst, nodes[rootIndex].leftFirst + 1 };
+		uint32_t pairs[MaxTreeletLeaves - 1]{ nodes[rootIndex].leftFirst };
+		int numLeaves{ 2 }, numPairs{ 1 };
+		while (numLeaves < MaxTreeletLeaves)
+		{
+			int largestLeaf{ -1 };
+			float largestArea{ -1.f };
+			for (int i{ 0 }; i < numLeaves; ++i)
+			{
+				const BVHNode& leaf{ nodes[leaves[i]] };
+				const float area{ HalfArea(leaf.minAABB, leaf.maxAABB) };
+				if (!leaf.IsLeaf() && area > largestArea)
+				{
+					largestLeaf = i;
+					largestArea = area;
+				}
+			}
+			if (largestLeaf < 0)
+				break;
+
+			const uint32_t openedPair{ nodes[leaves[largestLeaf]].leftFirst };
+			pairs[numPairs++] = openedPair;
+			leaves[largestLeaf] = openedPair;
+			leaves[numLeaves++] = openedPair + 1;
+		}
+		//Two leaves only have one topology
+		if (numLeaves < 3)
+			return;
+
+		//Lowest cost per subset of leaves, subsets are numbered by their leaf bits so every subset comes after its parts
+		const uint32_t numSubsets{ 1u << numLeaves };
+		Vector3 subsetMin[1u << MaxTreeletLeaves]{}, subsetMax[1u << MaxTreeletLeaves]{};
+		float subsetCost[1u << MaxTreeletLeaves]{};
+		uint32_t bestPartition[1u << MaxTreeletLeaves]{};
+		for (uint32_t subset{ 1 }; subset < numSubsets; ++subset)
+		{
+			const int lowestLeaf{ std::countr_zero(subset) };
+			const uint32_t rest{ subset & (subset - 1) };
+			const BVHNode& leaf{ nodes[leaves[lowestLeaf]] };
+			if (rest == 0)
+			{
+				subsetMin[subset] = leaf.minAABB;
+				subsetMax[subset] = leaf.maxAABB;
+				subsetCost[subset] = subtreeCosts[leaves[lowestLeaf]];
+				continue;
+			}
+			subsetMin[subset] = Vector3::Min(leaf.minAABB, subsetMin[rest]);
+			subsetMax[subset] = Vector3::Max(leaf.maxAABB, subsetMax[rest]);
+
+			//Only partitions that keep the lowest leaf on the left, the mirrored ones cost the same
+			const uint32_t lowestBit{ subset & (~subset + 1) };
+			float bestCost{ FLT_MAX };
+			for (uint32_t part{ (subset - 1) & subset }; part > 0; part = (part - 1) & subset)
+			{
+				if ((part & lowestBit) == 0)
+					continue;
+				const float cost{ subsetCost[part] + subsetCost[subset ^ part] };
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestPartition[subset] = part;
+				}
+			}
+			subsetCost[subset] = HalfArea(subsetMin[subset], subsetMax[subset]) + bestCost;
+		}
+
+		//The current topology is one of the candidates, so the search never makes things worse
+		const uint32_t allLeaves{ numSubsets - 1 };
+		if (subsetCost[allLeaves] >= subtreeCosts[rootIndex])
+			return;
+
+		BVHNode leafNodes[MaxTreeletLeaves]{};
+		float leafCosts[MaxTreeletLeaves]{};
+		for (int i{ 0 }; i < numLeaves; ++i)
+		{
+			leafNodes[i] = nodes[leaves[i]];
+			leafCosts[i] = subtreeCosts[leaves[i]];
+		}
+
+		int nextPair{ 0 };
+		const auto emit{ [&](const auto& self, uint32_t subset, uint32_t slot) -> void
+			{
+				if ((subset & (subset - 1)) == 0)
+				{
+					const int leaf{ std::countr_zero(subset) };
+					nodes[slot] = leafNodes[leaf];
+					subtreeCosts[slot] = leafCosts[leaf];
+					return;
+				}
+
+				const uint32_t pair{ pairs[nextPair++] };
+				nodes[slot] = BVHNode{ subsetMin[subset], pair, subsetMax[subset], 0 };
+				subtreeCosts[slot] = subsetCost[subset];
+				self(self, bestPartition[subset], pair);
+				self(self, subset ^ bestPartition[subset], pair + 1);
+			} };
+		emit(emit, allLeaves, rootIndex);
+	}
+
+	//Computes the summed SAH cost of the node from its children, then restructures the treelet below it
+	void RestructureNode(std::vector<BVHNode>& nodes, std::vector<float>& subtreeCosts, uint32_t nodeIndex)
+	{
+		const BVHNode& node{ nodes[nodeIndex] };
+		const float area{ HalfArea(node.minAABB, node.maxAABB) };
+		if (node.IsLeaf())
+		{
+			subtreeCosts[nodeIndex] = area * static_cast<float>(node.primitiveCount);
+			return;
+		}
+		subtreeCosts[nodeIndex] = area + subtreeCosts[node.leftFirst] + subtreeCosts[node.leftFirst + 1];
+		RestructureTreelet(nodes, subtreeCosts, nodeIndex);
+	}
+
+	//Bottom-up, so every treelet is formed from subtrees that were already optimized
+	void RestructureSubtree(std::vector<BVHNode>& nodes, std::vector<float>& subtreeCosts, uint32_t nodeIndex)
+	{
+		if (!nodes[nodeIndex].IsLeaf())
+		{
+			RestructureSubtree(nodes, subtreeCosts, nodes[nodeIndex].leftFirst);
+			RestructureSubtree(nodes, subtreeCosts, nodes[nodeIndex].leftFirst + 1);
+		}
+		RestructureNode(nodes, subtreeCosts, nodeIndex);
+	}
+
+	int GetDepth(const std::vector<BVHNode>& nodes)
+	{
+		int maxDepth{ 0 };
+		std::vector<std::pair<uint32_t, int>> stack{ { 0, 0 } };
+		while (!stack.empty())
+		{
+			const auto [nodeIndex, depth] { stack.back() };
+			stack.pop_back();
+			maxDepth = std::max(maxDepth, depth);
+			if (!nodes[nodeIndex].IsLeaf())
+			{
+				stack.emplace_back(nodes[nodeIndex].leftFirst, depth + 1);
+				stack.emplace_back(nodes[nodeIndex].leftFirst + 1, depth + 1);
+			}
+		}
+		return maxDepth;
+	}
+}
+
+void LinearBVH::Build(BVH& bvh, const std::vector<Vector3>& positions, const std::vector<int>& indices, uint32_t maxLeafSize,
+                      bool restructureTreelets, ThreadPool* pThreadPool)
+{
+	PROFILE_ZONE("LinearBVH::Build");
+	const uint32_t triangleCount{ static_cast<uint32_t>(indices.size() / 3) };
+	if (triangleCount == 0)
+	{
+		bvh.Clear();
+		return;
+	}
+
+	std::unique_ptr<ThreadPool> pOwnThreadPool{};
+	if (!pThreadPool && triangleCount >= MinParallelTriangles)
+	{
+		pOwnThreadPool = std::make_unique<ThreadPool>();
+		pThreadPool = pOwnThreadPool.get();
+	}
+	if (pThreadPool && (pThreadPool->GetThreadCount() == 1 || triangleCount < MinParallelTriangles))
+		pThreadPool = nullptr;
+	const uint32_t numThreads{ pThreadPool ? pThreadPool->GetThreadCount() : 1 };
+
+	BuildInput input{};
+	input.maxLeafSize = maxLeafSize;
+	input.triangleMin.resize(triangleCount);
+	input.triangleMax.resize(triangleCount);
+	input.codes.resize(triangleCount);
+	input.primitiveIndices.resize(triangleCount);
+
+	const int numCodeBits{ triangleCount <= Max30BitCodeTriangles ? 30 : 63 };
+	ComputeMortonCodes(input, positions, indices, numCodeBits, numThreads, pThreadPool);
+	RadixSort(input.codes, input.primitiveIndices, numCodeBits, numThreads, pThreadPool);
+
+	//Split the top of the tree on the calling thread until there are a few subtrees per thread, then emit those in parallel
+	std::vector<BVHNode> nodes{};
+	nodes.reserve(static_cast<size_t>(triangleCount) * 2 - 1);
+	nodes.push_back(BVHNode{ {}, 0, {}, triangleCount });
+
+	std::vector<uint32_t> topNodes{};
+	std::vector<std::pair<uint32_t, int>> subtreeRoots{ { 0, 0 } };
+	const size_t numWantedSubtrees{ pThreadPool ? static_cast<size_t>(numThreads) * 4 : 1 };
+	while (subtreeRoots.size() < numWantedSubtrees)
+	{
+		std::vector<std::pair<uint32_t, int>> nextRoots{};
+		for (const auto& [nodeIndex, depth] : subtreeRoots)
+		{
+			if (!SplitNode(input, nodes, nodeIndex, depth))
+			{
+				nextRoots.emplace_back(nodeIndex, depth);
+				continue;
+			}
+			topNodes.push_back(nodeIndex);
+			nextRoots.emplace_back(nodes[nodeIndex].leftFirst, depth + 1);
+			nextRoots.emplace_back(nodes[nodeIndex].leftFirst + 1, depth + 1);
+		}
+		if (nextRoots.size() == subtreeRoots.size())
+			break;
+		subtreeRoots = std::move(nextRoots);
+	}
+
+	std::vector<std::vector<BVHNode>> subtrees(subtreeRoots.size());
+	{
+		PROFILE_ZONE("LinearBVH::EmitSubtrees");
+		ForEachChunk(pThreadPool, static_cast<uint32_t>(subtreeRoots.size()), [&](uint32_t subtree)
+			{
+				const auto [rootIndex, depth] { subtreeRoots[subtree] };
+				std::vector<BVHNode>& subtreeNodes{ subtrees[subtree] };
+				subtreeNodes.reserve(static_cast<size_t>(nodes[rootIndex].primitiveCount) * 2 - 1);
+				subtreeNodes.push_back(nodes[rootIndex]);
+				EmitSubtree(input, subtreeNodes, 0, depth);
+			});
+	}
+
+	//Every subtree was emitted with its root at 0, its other nodes are appended and their child indices moved along
+	for (size_t subtree{ 0 }; subtree < subtrees.size(); ++subtree)
+	{
+		const std::vector<BVHNode>& subtreeNodes{ subtrees[subtree] };
+		const uint32_t offset{ static_cast<uint32_t>(nodes.size()) - 1 };
+		const auto relocate{ [offset](BVHNode node)
+			{
+				if (!node.IsLeaf())
+					node.leftFirst += offset;
+				return node;
+			} };
+		nodes[subtreeRoots[subtree].first] = relocate(subtreeNodes[0]);
+		for (size_t i{ 1 }; i < subtreeNodes.size(); ++i)
+		{
+			nodes.push_back(relocate(subtreeNodes[i]));
+		}
+	}
+	subtrees.clear();
+
+	//Breadth first order lists every parent before its children
+	for (size_t i{ topNodes.size() }; i-- > 0;)
+	{
+		BVHNode& node{ nodes[topNodes[i]] };
+		node.minAABB = Vector3::Min(nodes[node.leftFirst].minAABB, nodes[node.leftFirst + 1].minAABB);
+		node.maxAABB = Vector3::Max(nodes[node.leftFirst].maxAABB, nodes[node.leftFirst + 1].maxAABB);
+	}
+
+	if (restructureTreelets)
+	{
+		PROFILE_ZONE("LinearBVH::RestructureTreelets");
+		//Treelets rooted inside a subtree never leave it, so the subtrees are restructured in parallel before the nodes above them
+		const std::vector<BVHNode> unrestructuredNodes{ nodes };
+		std::vector<float> subtreeCosts(nodes.size());
+		ForEachChunk(pThreadPool, static_cast<uint32_t>(subtreeRoots.size()), [&](uint32_t subtree)
+			{
+				RestructureSubtree(nodes, subtreeCosts, subtreeRoots[subtree].first);
+			});
+		for (size_t i{ topNodes.size() }; i-- > 0;)
+		{
+			RestructureNode(nodes, subtreeCosts, topNodes[i]);
+		}
+
+		//Restructuring can deepen the tree, the traversal stacks only hold BVH::MaxDepth entries
+		if (GetDepth(nodes) > BVH::MaxDepth)
+			nodes = unrestructuredNodes;
+	}
+
+	bvh.Assign(std::move(nodes), std::move(input.primitiveIndices), triangleCount, maxLeafSize);
+}
@@ -0,0 +1,126 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace dae;
+
+MappedFile::MappedFile(const std::string& path)
+{
+#if defined(_WIN32)
+	m_FileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_FileHandle == INVALID_HANDLE_VALUE)
+	{
+		m_FileHandle = nullptr;
+		return;
+	}
+
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(m_FileHandle, &fileSize))
+	{
+		Close();
+		return;
+	}
+	m_Size = static_cast<size_t>(fileSize.QuadPart);
+
+	//Files without any bytes can't be mapped, they are still valid
+	if (m_Size > 0)
+	{
+		m_MappingHandle = CreateFileMappingA(m_FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_MappingHandle)
+			m_pData = static_cast<const char*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+		if (!m_pData)
+		{
+			Close();
+			return;
+		}
+	}
+#else
+	m_FileDescriptor = open(path.c_str(), O_RDONLY);
+	if (m_FileDescriptor == -1)
+		return;
+
+	struct stat fileStatus {};
+	if (fstat(m_FileDescriptor, &fileStatus) != 0)
+	{
+		Close();
+		return;
+	}
+	m_Size = static_cast<size_t>(fileStatus.st_size);
+
+	//Files without any bytes can't be mapped, they are still valid
+	if (m_Size > 0)
+	{
+		void* pData{ mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_FileDescriptor, 0) };
+		if (pData == MAP_FAILED)
+		{
+			Close();
+			return;
+		}
+		madvise(pData, m_Size, MADV_SEQUENTIAL);
+		m_pData = static_cast<const char*>(pData);
+	}
+#endif
+	m_IsOpen = true;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		std::swap(m_pData, other.m_pData);
+		std::swap(m_Size, other.m_Size);
+		std::swap(m_IsOpen, other.m_IsOpen);
+#if defined(_WIN32)
+		std::swap(m_FileHandle, other.m_FileHandle);
+		std::swap(m_MappingHandle, other.m_MappingHandle);
+#else
+		std::swap(m_FileDescriptor, other.m_FileDescriptor);
+#endif
+	}
+	return *this;
+}
+
+void MappedFile::Close()
+{
+#if defined(_WIN32)
+	if (m_pData)
+		UnmapViewOfFile(m_pData);
+	if (m_MappingHandle)
+		CloseHandle(m_MappingHandle);
+	if (m_FileHandle)
+		CloseHandle(m_FileHandle);
+	m_MappingHandle = nullptr;
+	m_FileHandle = nullptr;
+#else
+	if (m_pData)
+		munmap(const_cast<char*>(m_pData), m_Size);
+	if (m_FileDescriptor != -1)
+		close(m_FileDescriptor);
+	m_FileDescriptor = -1;
+#endif
+	m_pData = nullptr;
+	m_Size = 0;
+	m_IsOpen = false;
+}
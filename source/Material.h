@@ -1,133 +1,194 @@
 #pragma once
+#include <cstdint>
+#include <vector>
+
 #include "Math.h"
 #include "DataTypes.h"
 #include "BRDFs.h"
 
 namespace dae
 {
-#pragma region Material BASE
-	class Material
-	{
-	public:
-		Material() = default;
-		virtual ~Material() = default;
-
-		Material(const Material&) = delete;
-		Material(Material&&) noexcept = delete;
-		Material& operator=(const Material&) = delete;
-		Material& operator=(Material&&) noexcept = delete;
-
-		/**
-		 * \brief Function used to calculate the correct color for the specific material and its parameters
-		 * \param hitRecord current hitrecord
-		 * \param l light direction
-		 * \param v view direction
-		 * \return color
-		 */
-		virtual ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) = 0;
-	};
-#pragma endregion
+	//Materials are plain structs stored by value in one table per type, a MaterialHandle names the table and the slot
+	//Shading switches on the handle type instead of calling through a vtable, so every kernel below can be inlined
 
 #pragma region Material SOLID COLOR
 	//SOLID COLOR
 	//===========
-	class Material_SolidColor final : public Material
+	struct Material_SolidColor
 	{
-	public:
-		Material_SolidColor(const ColorRGB& color): m_Color(color)
-		{
-		}
+		ColorRGB color{ colors::White };
 
-		ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) override
+		ColorRGB Shade(const HitRecord&, const Vector3&, const Vector3&) const
 		{
-			return m_Color;
+			return color;
 		}
-
-	private:
-		ColorRGB m_Color{colors::White};
 	};
 #pragma endregion
 
 #pragma region Material LAMBERT
 	//LAMBERT
 	//=======
-	class Material_Lambert final : public Material
+	struct Material_Lambert
 	{
-	public:
-		Material_Lambert(const ColorRGB& diffuseColor, const float diffuseReflectance) :
-			m_DiffuseColor(diffuseColor), m_DiffuseReflectance(diffuseReflectance){}
-
-		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) override
+		Material_Lambert(const ColorRGB& diffuseColor, float diffuseReflectance) :
+			diffuse{ BRDF::Lambert(diffuseReflectance, diffuseColor) }
 		{
-			return BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor);
 		}
 
-	private:
-		ColorRGB m_DiffuseColor{colors::White};
-		float m_DiffuseReflectance{1.f}; //kd
+		ColorRGB diffuse{}; //constant BRDF, computed once from the color and kd
+
+		ColorRGB Shade(const HitRecord&, const Vector3&, const Vector3&) const
+		{
+			return diffuse;
+		}
 	};
 #pragma endregion
 
 #pragma region Material LAMBERT PHONG
 	//LAMBERT-PHONG
 	//=============
-	class Material_LambertPhong final : public Material
+	struct Material_LambertPhong
 	{
-	public:
-		Material_LambertPhong(const ColorRGB& diffuseColor, const float kd, const float ks, const float phongExponent):
-			m_DiffuseColor(diffuseColor), m_DiffuseReflectance(kd), m_SpecularReflectance(ks),
-			m_PhongExponent(phongExponent)
+		Material_LambertPhong(const ColorRGB& diffuseColor, float kd, float ks, float phongExponent) :
+			diffuse{ BRDF::Lambert(kd, diffuseColor) }, specularReflectance{ ks }, phongExponent{ phongExponent }
 		{
 		}
 
-		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) override
+		ColorRGB diffuse{}; //Lambert part, does not depend on the directions
+		float specularReflectance{ 0.5f }; //ks
+		float phongExponent{ 1.f };
+
+		ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const
 		{
-			return BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor) 
-				+ BRDF::Phong(m_SpecularReflectance, m_PhongExponent, l, -v, hitRecord.normal);
+			return diffuse + BRDF::Phong(specularReflectance, phongExponent, l, -v, hitRecord.normal);
 		}
-
-	private:
-		ColorRGB m_DiffuseColor{colors::White};
-		float m_DiffuseReflectance{0.5f}; //kd
-		float m_SpecularReflectance{0.5f}; //ks
-		float m_PhongExponent{1.f}; //Phong Exponent
 	};
 #pragma endregion
 
 #pragma region Material COOK TORRENCE
 	//COOK TORRENCE
-	class Material_CookTorrence final : public Material
+	//=============
+	struct Material_CookTorrence
 	{
-	public:
-		Material_CookTorrence(const ColorRGB& albedo, const bool metalness, const float roughness):
-			m_Albedo(albedo), m_Metalness(metalness), m_Roughness(roughness)
+		Material_CookTorrence(const ColorRGB& albedo, bool metalness, float roughness) :
+			albedo{ albedo }, roughness{ roughness }, metalness{ metalness }
 		{
 		}
 
-		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) override
+		ColorRGB albedo{ 0.955f, 0.637f, 0.538f }; //Copper
+		float roughness{ 0.1f }; // [1.0 > 0.0] >> [ROUGH > SMOOTH]
+		bool metalness{ true };
+
+		ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const
 		{
-			const Vector3 halfVector{ ((v + l) / (l + v).Magnitude()).Normalized()};
+			const Vector3 halfVector{ ((v + l) / (l + v).Magnitude()).Normalized() };
 			const Vector3 normal{ hitRecord.normal };
-			const ColorRGB f0 = (!m_Metalness) ? ColorRGB(0.04f, 0.04f, 0.04f) : m_Albedo;
+			const ColorRGB f0 = (!metalness) ? ColorRGB(0.04f, 0.04f, 0.04f) : albedo;
 
 			const ColorRGB f = BRDF::FresnelFunction_Schlick(halfVector, v, f0);
-			const float d = BRDF::NormalDistribution_GGX(normal, halfVector, m_Roughness);
-			const float g = BRDF::GeometryFunction_Smith(normal, v, l, m_Roughness);
+			const float d = BRDF::NormalDistribution_GGX(normal, halfVector, roughness);
+			const float g = BRDF::GeometryFunction_Smith(normal, v, l, roughness);
 
 			const float dots{ 4 * (Vector3::Dot(v, normal) * Vector3::Dot(l, normal)) };
 			const auto specular{ (d * f * g) * (1 / dots) };
 
-			const ColorRGB kd = (!m_Metalness) ? ColorRGB( 1.f, 1.f, 1.f ) - f : ColorRGB{ 0.f, 0.f, 0.f };
+			const ColorRGB kd = (!metalness) ? ColorRGB(1.f, 1.f, 1.f) - f : ColorRGB{ 0.f, 0.f, 0.f };
 
-			const auto diffuse = BRDF::Lambert(kd, m_Albedo);
+			const auto diffuse = BRDF::Lambert(kd, albedo);
 
 			return kd * diffuse + specular;
 		}
+	};
+#pragma endregion
+
+#pragma region MaterialTable
+	//Owns every material of a scene, one contiguous array per material type
+	class MaterialTable final
+	{
+	public:
+		MaterialHandle AddSolidColor(const ColorRGB& color)
+		{
+			return Add(m_SolidColors, MaterialType::SolidColor, Material_SolidColor{ color });
+		}
+		MaterialHandle AddLambert(const ColorRGB& diffuseColor, float diffuseReflectance)
+		{
+			return Add(m_Lamberts, MaterialType::Lambert, Material_Lambert{ diffuseColor, diffuseReflectance });
+		}
+		MaterialHandle AddLambertPhong(const ColorRGB& diffuseColor, float kd, float ks, float phongExponent)
+		{
+			return Add(m_LambertPhongs, MaterialType::LambertPhong, Material_LambertPhong{ diffuseColor, kd, ks, phongExponent });
+		}
+		MaterialHandle AddCookTorrence(const ColorRGB& albedo, bool metalness, float roughness)
+		{
+			return Add(m_CookTorrences, MaterialType::CookTorrence, Material_CookTorrence{ albedo, metalness, roughness });
+		}
+
+		/**
+		 * \brief BRDF of the material at a hit
+		 * \param l light direction
+		 * \param v view direction
+		 */
+		ColorRGB Shade(MaterialHandle handle, const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const
+		{
+			const uint32_t index{ handle.GetIndex() };
+			switch (handle.GetType())
+			{
+			case MaterialType::SolidColor:
+				return m_SolidColors[index].Shade(hitRecord, l, v);
+			case MaterialType::Lambert:
+				return m_Lamberts[index].Shade(hitRecord, l, v);
+			case MaterialType::LambertPhong:
+				return m_LambertPhongs[index].Shade(hitRecord, l, v);
+			case MaterialType::CookTorrence:
+				return m_CookTorrences[index].Shade(hitRecord, l, v);
+			}
+			return {};
+		}
+
+		//Solid colors and Lambert have the same BRDF for every light and view direction
+		static bool HasConstantBRDF(MaterialHandle handle)
+		{
+			return handle.GetType() == MaterialType::SolidColor || handle.GetType() == MaterialType::Lambert;
+		}
+		//BRDF of a material with HasConstantBRDF, which needs no directions
+		ColorRGB ShadeConstant(MaterialHandle handle) const
+		{
+			assert(HasConstantBRDF(handle) && "Material BRDF depends on the directions");
+			return handle.GetType() == MaterialType::SolidColor ? m_SolidColors[handle.GetIndex()].color : m_Lamberts[handle.GetIndex()].diffuse;
+		}
+
+		uint32_t GetCount() const
+		{
+			return static_cast<uint32_t>(m_SolidColors.size() + m_Lamberts.size() + m_LambertPhongs.size() + m_CookTorrences.size());
+		}
+		//Handle of the material at index in [0, GetCount()), counting through the tables in MaterialType order
+		MaterialHandle GetHandle(uint32_t index) const
+		{
+			const size_t counts[]{ m_SolidColors.size(), m_Lamberts.size(), m_LambertPhongs.size(), m_CookTorrences.size() };
+			uint32_t type{ 0 };
+			while (index >= counts[type])
+				index -= static_cast<uint32_t>(counts[type++]);
+			return { static_cast<MaterialType>(type), index };
+		}
+
+		const std::vector<Material_SolidColor>& GetSolidColors() const { return m_SolidColors; }
+		const std::vector<Material_Lambert>& GetLamberts() const { return m_Lamberts; }
+		const std::vector<Material_LambertPhong>& GetLambertPhongs() const { return m_LambertPhongs; }
+		const std::vector<Material_CookTorrence>& GetCookTorrences() const { return m_CookTorrences; }
 
 	private:
-		ColorRGB m_Albedo{0.955f, 0.637f, 0.538f}; //Copper
-		bool m_Metalness{ true };
-		float m_Roughness{0.1f}; // [1.0 > 0.0] >> [ROUGH > SMOOTH]
+		std::vector<Material_SolidColor> m_SolidColors{};
+		std::vector<Material_Lambert> m_Lamberts{};
+		std::vector<Material_LambertPhong> m_LambertPhongs{};
+		std::vector<Material_CookTorrence> m_CookTorrences{};
+
+		template<typename MaterialStruct>
+		static MaterialHandle Add(std::vector<MaterialStruct>& table, MaterialType type, const MaterialStruct& material)
+		{
+			assert(table.size() <= MaterialHandle::MaxIndex && "Material table is full");
+			table.push_back(material);
+			return { type, static_cast<uint32_t>(table.size() - 1) };
+		}
 	};
 #pragma endregion
 }
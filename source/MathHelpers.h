@@ -1,6 +1,14 @@
 #pragma once
+#include <cfloat>
 #include <cmath>
 
+//The math types are header only so every operation can be inlined into the hit tests, even without link time optimization
+#if defined(_MSC_VER)
+#define FORCE_INLINE __forceinline
+#else
+#define FORCE_INLINE inline __attribute__((always_inline))
+#endif
+
 namespace dae
 {
 	/* --- CONSTANTS --- */
@@ -13,12 +21,12 @@ namespace dae
 	constexpr auto TO_DEGREES = (180.0f / PI);
 	constexpr auto TO_RADIANS(PI / 180.0f);
 
-	inline float Square(float a)
+	FORCE_INLINE constexpr float Square(float a)
 	{
 		return a * a;
 	}
 
-	inline float Lerpf(float a, float b, float factor)
+	FORCE_INLINE constexpr float Lerpf(float a, float b, float factor)
 	{
 		return ((1 - factor) * a) + (factor * b);
 	}
@@ -1,4 +1,8 @@
 #pragma once
+#include <cassert>
+#include <cmath>
+
+#include "MathHelpers.h"
 #include "Vector3.h"
 #include "Vector4.h"
 
@@ -6,46 +10,224 @@ namespace dae {
 	struct Matrix
 	{
 		Matrix() = default;
-		Matrix(
+		constexpr Matrix(
 			const Vector3& xAxis,
 			const Vector3& yAxis,
 			const Vector3& zAxis,
-			const Vector3& t);
+			const Vector3& t) :
+			Matrix({ xAxis, 0 }, { yAxis, 0 }, { zAxis, 0 }, { t, 1 })
+		{
+		}
 
-		Matrix(
+		constexpr Matrix(
 			const Vector4& xAxis,
 			const Vector4& yAxis,
 			const Vector4& zAxis,
-			const Vector4& t);
-
-		Matrix(const Matrix& m);
-
-		Vector3 TransformVector(const Vector3& v) const;
-		Vector3 TransformVector(float x, float y, float z) const;
-		Vector3 TransformPoint(const Vector3& p) const;
-		Vector3 TransformPoint(float x, float y, float z) const;
-		const Matrix& Transpose();
-
-		Vector3 GetAxisX() const;
-		Vector3 GetAxisY() const;
-		Vector3 GetAxisZ() const;
-		Vector3 GetTranslation() const;
-
-		static Matrix CreateTranslation(float x, float y, float z);
-		static Matrix CreateTranslation(const Vector3& t);
-		static Matrix CreateRotationX(float pitch);
-		static Matrix CreateRotationY(float yaw);
-		static Matrix CreateRotationZ(float roll);
-		static Matrix CreateRotation(float pitch, float yaw, float roll);
-		static Matrix CreateRotation(const Vector3& r);
-		static Matrix CreateScale(float sx, float sy, float sz);
-		static Matrix CreateScale(const Vector3& s);
-		static Matrix Transpose(const Matrix& m);
-
-		Vector4& operator[](int index);
-		Vector4 operator[](int index) const;
-		Matrix operator*(const Matrix& m) const;
-		const Matrix& operator*=(const Matrix& m);
+			const Vector4& t) :
+			data{ xAxis, yAxis, zAxis, t }
+		{
+		}
+
+		constexpr Matrix(const Matrix& m) = default;
+		constexpr Matrix& operator=(const Matrix& m) = default;
+
+		FORCE_INLINE constexpr Vector3 TransformVector(const Vector3& v) const
+		{
+			return TransformVector(v.x, v.y, v.z);
+		}
+
+		FORCE_INLINE constexpr Vector3 TransformVector(float x, float y, float z) const
+		{
+			return Vector3{
+				data[0].x * x + data[1].x * y + data[2].x * z,
+				data[0].y * x + data[1].y * y + data[2].y * z,
+				data[0].z * x + data[1].z * y + data[2].z * z
+			};
+		}
+
+		FORCE_INLINE constexpr Vector3 TransformPoint(const Vector3& p) const
+		{
+			return TransformPoint(p.x, p.y, p.z);
+		}
+
+		FORCE_INLINE constexpr Vector3 TransformPoint(float x, float y, float z) const
+		{
+			return Vector3{
+				data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
+				data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
+				data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
+			};
+		}
+
+		constexpr const Matrix& Transpose()
+		{
+			Matrix result{};
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				for (int c{ 0 }; c < 4; ++c)
+				{
+					result[r][c] = data[c][r];
+				}
+			}
+
+			data[0] = result[0];
+			data[1] = result[1];
+			data[2] = result[2];
+			data[3] = result[3];
+
+			return *this;
+		}
+
+		constexpr const Matrix& Inverse()
+		{
+			//Affine inverse, assumes the last column is (0, 0, 0, 1)
+			const Vector3 xAxis{ data[0] };
+			const Vector3 yAxis{ data[1] };
+			const Vector3 zAxis{ data[2] };
+			const Vector3 translation{ data[3] };
+
+			const Vector3 yCrossZ{ Vector3::Cross(yAxis, zAxis) };
+			const Vector3 zCrossX{ Vector3::Cross(zAxis, xAxis) };
+			const Vector3 xCrossY{ Vector3::Cross(xAxis, yAxis) };
+			const float invDeterminant{ 1.f / Vector3::Dot(xAxis, yCrossZ) };
+
+			//Columns of the inverse 3x3 are the cross products divided by the determinant
+			data[0] = { yCrossZ.x * invDeterminant, zCrossX.x * invDeterminant, xCrossY.x * invDeterminant, 0.f };
+			data[1] = { yCrossZ.y * invDeterminant, zCrossX.y * invDeterminant, xCrossY.y * invDeterminant, 0.f };
+			data[2] = { yCrossZ.z * invDeterminant, zCrossX.z * invDeterminant, xCrossY.z * invDeterminant, 0.f };
+			data[3] = { -TransformVector(translation), 1.f };
+
+			return *this;
+		}
+
+		FORCE_INLINE constexpr Vector3 GetAxisX() const { return data[0]; }
+		FORCE_INLINE constexpr Vector3 GetAxisY() const { return data[1]; }
+		FORCE_INLINE constexpr Vector3 GetAxisZ() const { return data[2]; }
+		FORCE_INLINE constexpr Vector3 GetTranslation() const { return data[3]; }
+
+		static constexpr Matrix CreateTranslation(float x, float y, float z)
+		{
+			return CreateTranslation(Vector3{ x, y, z });
+		}
+
+		static constexpr Matrix CreateTranslation(const Vector3& t)
+		{
+			return { Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, t };
+		}
+
+		static Matrix CreateRotationX(float pitch)
+		{
+			return
+			{
+				Vector4{1.f,	0.f,			0.f,				0.f},
+				Vector4{0.f,	std::cos(pitch),-std::sin(pitch),	0.f},
+				Vector4{0.f,	std::sin(pitch),std::cos(pitch),	0.f},
+				Vector4{0.f,	0.f,			0.f,				1.f}
+			};
+		}
+
+		static Matrix CreateRotationY(float yaw)
+		{
+			return
+			{
+				Vector4{std::cos(yaw),	0.f, std::sin(yaw),	0.f},
+				Vector4{0.f,			1.f, 0.f,			0.f},
+				Vector4{-std::sin(yaw),	0.f, std::cos(yaw),	0.f},
+				Vector4{0.f,			0.f, 0.f,			1.f}
+			};
+		}
+
+		static Matrix CreateRotationZ(float roll)
+		{
+			return
+			{
+				Vector4{std::cos(roll),	-std::sin(roll),	0.f,	0.f},
+				Vector4{std::sin(roll),	std::cos(roll),		0.f,	0.f},
+				Vector4{0.f,			0.f,				1.f,	0.f},
+				Vector4{0.f,			0.f,				0.f,	1.f}
+			};
+		}
+
+		static Matrix CreateRotation(float pitch, float yaw, float roll)
+		{
+			return CreateRotation({ pitch, yaw, roll });
+		}
+
+		static Matrix CreateRotation(const Vector3& r)
+		{
+			const Matrix x{ CreateRotationX(r.x) };
+			const Matrix y{ CreateRotationY(r.y) };
+			const Matrix z{ CreateRotationZ(r.z) };
+			return x * y * z;
+		}
+
+		static constexpr Matrix CreateScale(float sx, float sy, float sz)
+		{
+			return
+			{
+				Vector4{sx,		0.f,	0.f,	0.f},
+				Vector4{0.f,	sy,		0.f,	0.f},
+				Vector4{0.f,	0.f,	sz,		0.f},
+				Vector4{0.f,	0.f,	0.f,	1.f}
+			};
+		}
+
+		static constexpr Matrix CreateScale(const Vector3& s)
+		{
+			return CreateScale(s.x, s.y, s.z);
+		}
+
+		static constexpr Matrix Transpose(const Matrix& m)
+		{
+			Matrix out{ m };
+			out.Transpose();
+
+			return out;
+		}
+
+		static constexpr Matrix Inverse(const Matrix& m)
+		{
+			Matrix out{ m };
+			out.Inverse();
+
+			return out;
+		}
+
+#pragma region Operator Overloads
+		FORCE_INLINE constexpr Vector4& operator[](int index)
+		{
+			assert(index <= 3 && index >= 0);
+			return data[index];
+		}
+
+		FORCE_INLINE constexpr Vector4 operator[](int index) const
+		{
+			assert(index <= 3 && index >= 0);
+			return data[index];
+		}
+
+		constexpr Matrix operator*(const Matrix& m) const
+		{
+			Matrix result{};
+			const Matrix transposed{ Transpose(m) };
+
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				for (int c{ 0 }; c < 4; ++c)
+				{
+					result[r][c] = Vector4::Dot(data[r], transposed[c]);
+				}
+			}
+
+			return result;
+		}
+
+		constexpr const Matrix& operator*=(const Matrix& m)
+		{
+			*this = *this * m;
+			return *this;
+		}
+#pragma endregion
 
 	private:
 
@@ -63,4 +245,4 @@ namespace dae {
 		// v2x v2y v2z v2w
 		// v3x v3y v3z v3w
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,262 @@
+#include "MeshCache.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+#include "DataTypes.h"
+#include "MappedFile.h"
+#include "Utils.h"
+
+using namespace dae;
+
+namespace
+{
+	constexpr char Magic[8]{ 'R', 'T', 'M', 'E', 'S', 'H', '\0', '\0' };
+	constexpr uint64_t SectionAlignment{ 64 };
+
+	enum class Section
+	{
+		Positions,
+		Normals,
+		Indices,
+		BVHNodes,
+		PrimitiveIndices,
+		Triangles,
+		TriangleBlocks,
+
+		//@END
+		Count
+	};
+	constexpr int NumSections{ static_cast<int>(Section::Count) };
+
+	struct SectionEntry
+	{
+		uint64_t offset; //from the start of the file, multiple of SectionAlignment
+		uint64_t count; //elements, not bytes
+	};
+
+	//The element sizes catch layout changes nobody remembered to bump the version for
+	struct CacheHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t headerSize;
+		uint32_t elementSizes[NumSections];
+		uint32_t triangleBlockSize;
+		uint32_t maxLeafSize;
+		uint32_t primitiveCount;
+		uint32_t padding;
+		uint64_t sourceSize;
+		int64_t sourceWriteTime;
+		Vector3 minAABB;
+		Vector3 maxAABB;
+		SectionEntry sections[NumSections];
+	};
+
+	static_assert(std::is_trivially_copyable_v<Vector3> && std::is_trivially_copyable_v<BVHNode> &&
+		std::is_trivially_copyable_v<PrecomputedTriangle> && std::is_trivially_copyable_v<TriangleBlock>,
+		"mesh cache arrays are written and read as raw bytes");
+
+	constexpr uint32_t ElementSizes[NumSections]{
+		sizeof(Vector3), sizeof(Vector3), sizeof(int), sizeof(BVHNode), sizeof(uint32_t), sizeof(PrecomputedTriangle), sizeof(TriangleBlock) };
+
+	uint64_t AlignOffset(uint64_t offset)
+	{
+		return (offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+	}
+
+	//Size and modification time of the source, a cache is only used while both match
+	bool GetSourceStamp(const std::string& objPath, uint64_t& size, int64_t& writeTime)
+	{
+		std::error_code error{};
+		size = std::filesystem::file_size(objPath, error);
+		if (error)
+			return false;
+		writeTime = static_cast<int64_t>(std::filesystem::last_write_time(objPath, error).time_since_epoch().count());
+		return !error;
+	}
+
+	template<typename T>
+	void WriteSection(std::ofstream& file, CacheHeader& header, Section section, const std::vector<T>& elements)
+	{
+		const uint64_t offset{ AlignOffset(static_cast<uint64_t>(file.tellp())) };
+		while (static_cast<uint64_t>(file.tellp()) < offset)
+			file.put('\0');
+
+		header.sections[static_cast<int>(section)] = { offset, elements.size() };
+		file.write(reinterpret_cast<const char*>(elements.data()), static_cast<std::streamsize>(elements.size() * sizeof(T)));
+	}
+
+	template<typename T>
+	bool ReadSection(const MappedFile& file, const CacheHeader& header, Section section, std::vector<T>& elements)
+	{
+		const SectionEntry& entry{ header.sections[static_cast<int>(section)] };
+		if (entry.offset % SectionAlignment != 0 || entry.offset > file.GetSize() ||
+			entry.count > (file.GetSize() - entry.offset) / sizeof(T))
+			return false;
+
+		elements.resize(entry.count);
+		if (entry.count > 0)
+			std::memcpy(elements.data(), file.GetData() + entry.offset, entry.count * sizeof(T));
+		return true;
+	}
+
+	//One pass over the read arrays, every index the traversal, refits or shading follow has to stay in range
+	bool IsGeometryValid(const MeshGeometry& geometry, const std::vector<BVHNode>& nodes, const std::vector<uint32_t>& primitiveIndices,
+	                     uint32_t primitiveCount)
+	{
+		for (const int index : geometry.indices)
+		{
+			if (index < 0 || static_cast<size_t>(index) >= geometry.positions.size())
+				return false;
+		}
+
+		for (size_t slot{ 0 }; slot < primitiveIndices.size(); ++slot)
+		{
+			const uint32_t primitiveIndex{ primitiveIndices[slot] };
+			if ((primitiveIndex >= primitiveCount && primitiveIndex != BVH::InvalidPrimitive) ||
+				geometry.triangles[slot].triangleIndex != primitiveIndex)
+				return false;
+		}
+
+		if (nodes.empty())
+			return primitiveCount == 0;
+
+		//Children always follow their parent, so depths are known before a node is reached and a cycle can't pass
+		std::vector<int> depths(nodes.size(), 0);
+		for (size_t nodeIndex{ 0 }; nodeIndex < nodes.size(); ++nodeIndex)
+		{
+			const BVHNode& node{ nodes[nodeIndex] };
+			if (node.IsLeaf())
+			{
+				if (node.leftFirst > primitiveIndices.size() || node.primitiveCount > primitiveIndices.size() - node.leftFirst)
+					return false;
+				continue;
+			}
+
+			if (node.leftFirst <= nodeIndex || node.leftFirst >= nodes.size() - 1 || depths[nodeIndex] >= BVH::MaxDepth)
+				return false;
+			depths[node.leftFirst] = depths[node.leftFirst + 1] = depths[nodeIndex] + 1;
+		}
+		return true;
+	}
+}
+
+std::string MeshCache::GetCachePath(const std::string& objPath)
+{
+	return objPath + ".rtmesh";
+}
+
+bool MeshCache::Write(const std::string& cachePath, const std::string& objPath, const MeshGeometry& geometry)
+{
+	CacheHeader header{};
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.headerSize = sizeof(CacheHeader);
+	std::memcpy(header.elementSizes, ElementSizes, sizeof(ElementSizes));
+	header.triangleBlockSize = TriangleBlockSize;
+	header.maxLeafSize = geometry.bvh.GetMaxLeafSize();
+	header.primitiveCount = geometry.bvh.GetPrimitiveCount();
+	header.minAABB = geometry.minAABB;
+	header.maxAABB = geometry.maxAABB;
+	if (!GetSourceStamp(objPath, header.sourceSize, header.sourceWriteTime))
+		return false;
+
+	//Written to a temporary file first, a crash halfway never leaves a damaged cache behind
+	const std::string temporaryPath{ cachePath + ".tmp" };
+	{
+		std::ofstream file{ temporaryPath, std::ios::binary | std::ios::trunc };
+		if (!file)
+			return false;
+
+		//The header is written again at the end, once the section offsets are known
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		WriteSection(file, header, Section::Positions, geometry.positions);
+		WriteSection(file, header, Section::Normals, geometry.normals);
+		WriteSection(file, header, Section::Indices, geometry.indices);
+		WriteSection(file, header, Section::BVHNodes, geometry.bvh.GetNodes());
+		WriteSection(file, header, Section::PrimitiveIndices, geometry.bvh.GetPrimitiveIndices());
+		WriteSection(file, header, Section::Triangles, geometry.triangles);
+		WriteSection(file, header, Section::TriangleBlocks, geometry.triangleBlocks);
+
+		file.seekp(0);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		if (!file)
+			return false;
+	}
+
+	std::error_code error{};
+	std::filesystem::rename(temporaryPath, cachePath, error);
+	return !error;
+}
+
+bool MeshCache::Read(const std::string& cachePath, const std::string& objPath, MeshGeometry& geometry)
+{
+	const MappedFile file{ cachePath };
+	if (!file.IsOpen() || file.GetSize() < sizeof(CacheHeader))
+		return false;
+
+	CacheHeader header{};
+	std::memcpy(&header, file.GetData(), sizeof(header));
+	if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version || header.headerSize != sizeof(CacheHeader) ||
+		std::memcmp(header.elementSizes, ElementSizes, sizeof(ElementSizes)) != 0 || header.triangleBlockSize != TriangleBlockSize)
+		return false;
+
+	uint64_t sourceSize{};
+	int64_t sourceWriteTime{};
+	if (GetSourceStamp(objPath, sourceSize, sourceWriteTime) && (sourceSize != header.sourceSize || sourceWriteTime != header.sourceWriteTime))
+		return false;
+
+	MeshGeometry cachedGeometry{};
+	std::vector<BVHNode> nodes{};
+	std::vector<uint32_t> primitiveIndices{};
+	if (!ReadSection(file, header, Section::Positions, cachedGeometry.positions) ||
+		!ReadSection(file, header, Section::Normals, cachedGeometry.normals) ||
+		!ReadSection(file, header, Section::Indices, cachedGeometry.indices) ||
+		!ReadSection(file, header, Section::BVHNodes, nodes) ||
+		!ReadSection(file, header, Section::PrimitiveIndices, primitiveIndices) ||
+		!ReadSection(file, header, Section::Triangles, cachedGeometry.triangles) ||
+		!ReadSection(file, header, Section::TriangleBlocks, cachedGeometry.triangleBlocks))
+		return false;
+
+	//Stale or damaged caches would make the traversal read out of bounds, the sizes are checked before the contents
+	if (header.primitiveCount != cachedGeometry.indices.size() / 3 || primitiveIndices.size() != cachedGeometry.triangles.size() ||
+		cachedGeometry.triangleBlocks.size() != (primitiveIndices.size() + TriangleBlockSize - 1) / TriangleBlockSize ||
+		!IsGeometryValid(cachedGeometry, nodes, primitiveIndices, header.primitiveCount))
+		return false;
+
+	cachedGeometry.bvh.Assign(std::move(nodes), std::move(primitiveIndices), header.primitiveCount, header.maxLeafSize);
+	cachedGeometry.minAABB = header.minAABB;
+	cachedGeometry.maxAABB = header.maxAABB;
+	geometry = std::move(cachedGeometry);
+	return true;
+}
+
+bool MeshCache::LoadOBJ(const std::string& objPath, MeshGeometry& geometry)
+{
+	const std::string cachePath{ GetCachePath(objPath) };
+
+	const auto start{ std::chrono::steady_clock::now() };
+	if (Read(cachePath, objPath, geometry))
+	{
+		const std::chrono::duration<double, std::milli> elapsed{ std::chrono::steady_clock::now() - start };
+		std::cout << "Loaded " << cachePath << ": " << geometry.indices.size() / 3 << " triangles in " << elapsed.count() << " ms" << std::endl;
+		return true;
+	}
+
+	MeshGeometry parsedGeometry{};
+	if (!Utils::ParseOBJ(objPath, parsedGeometry.positions, parsedGeometry.normals, parsedGeometry.indices))
+		return false;
+	parsedGeometry.UpdateBVH();
+
+	//A cache that can't be written (read only folder, ...) only costs the next startup the parse again
+	if (!Write(cachePath, objPath, parsedGeometry))
+		std::cout << "Could not write mesh cache " << cachePath << std::endl;
+
+	geometry = std::move(parsedGeometry);
+	return true;
+}
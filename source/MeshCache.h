@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace dae
+{
+	struct MeshGeometry;
+
+	//Versioned binary snapshot of a MeshGeometry: positions, normals, indices, the BVH and the precomputed triangles
+	//Every array is stored 64 byte aligned in its in-memory layout, reading it back is a bulk copy out of the mapped file instead of parsing and building
+	namespace MeshCache
+	{
+		//Increment whenever the layout of the file or of a stored struct changes, older caches are rebuilt
+		constexpr uint32_t Version{ 1 };
+
+		//objPath + ".rtmesh"
+		std::string GetCachePath(const std::string& objPath);
+
+		/**
+		 * \brief Writes a geometry with an up to date BVH to a cache file
+		 * \param objPath source file, its size and modification time are stored so a changed source invalidates the cache
+		 */
+		bool Write(const std::string& cachePath, const std::string& objPath, const MeshGeometry& geometry);
+		//Reads a cache file, fails if it has another version or layout, is damaged or its source changed since it was written
+		bool Read(const std::string& cachePath, const std::string& objPath, MeshGeometry& geometry);
+
+		/**
+		 * \brief Loads an OBJ through its cache, the first load parses the OBJ, builds the BVH and writes the cache next to it
+		 * \return false if neither the cache nor the OBJ could be loaded
+		 */
+		bool LoadOBJ(const std::string& objPath, MeshGeometry& geometry);
+	}
+}
@@ -0,0 +1,499 @@
+#include "MicroBenchmarks.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "Scene.h"
+#include "Utils.h"
+
+namespace dae
+{
+	namespace
+	{
+		//Rays from random points around the mesh towards random points inside its bounds
+		std::vector<Ray> GenerateRays(const Vector3& minAABB, const Vector3& maxAABB, int numRays)
+		{
+			std::mt19937 generator{ 1337 };
+			std::uniform_real_distribution<float> distribution{ 0.f, 1.f };
+
+			const Vector3 center{ (minAABB + maxAABB) * .5f };
+			const float radius{ (maxAABB - minAABB).Magnitude() * 2.f };
+
+			std::vector<Ray> rays(numRays);
+			for (Ray& ray : rays)
+			{
+				const Vector3 offset{ distribution(generator) - .5f, distribution(generator) - .5f, distribution(generator) - .5f };
+				const Vector3 target{
+					Lerpf(minAABB.x, maxAABB.x, distribution(generator)),
+					Lerpf(minAABB.y, maxAABB.y, distribution(generator)),
+					Lerpf(minAABB.z, maxAABB.z, distribution(generator)) };
+
+				ray.origin = center + offset.Normalized() * radius;
+				ray.direction = (target - ray.origin).Normalized();
+			}
+			return rays;
+		}
+
+		//Parses objPath into a mesh every triangle of which can be hit and generates the rays all mesh benchmarks trace against it
+		bool LoadBenchmarkMesh(const std::string& objPath, int numRays, TriangleMesh& mesh, std::vector<Ray>& rays)
+		{
+			mesh.cullMode = TriangleCullMode::NoCulling;
+			if (!Utils::ParseOBJ(objPath, mesh.pGeometry->positions, mesh.pGeometry->normals, mesh.pGeometry->indices))
+			{
+				std::cout << "Could not load " << objPath << std::endl;
+				return false;
+			}
+			mesh.UpdateTransforms();
+
+			rays = GenerateRays(mesh.pGeometry->minAABB, mesh.pGeometry->maxAABB, numRays);
+			return true;
+		}
+
+		template<typename Function>
+		double MeasureRaysPerSecond(int numRays, Function&& function)
+		{
+			const auto start{ std::chrono::high_resolution_clock::now() };
+			function();
+			const std::chrono::duration<double> elapsed{ std::chrono::high_resolution_clock::now() - start };
+			return numRays / elapsed.count();
+		}
+
+		void MeasurePrimaryRays(const char* sceneName, Scene& scene, int width, int height)
+		{
+			scene.Initialize();
+			scene.UpdateAccelerationStructure();
+
+			Camera& camera{ scene.GetCamera() };
+			const Matrix cameraToWorld{ camera.CalculateCameraToWorld() };
+			const float aspectRatio{ static_cast<float>(width) / static_cast<float>(height) };
+			const auto getDirection{ [&](int px, int py)
+				{
+					const float directionX{ (2.f * ((px + 0.5f) / width) - 1) * aspectRatio * camera.fovRadians };
+					const float directionY{ (1.f - 2.f * ((py + .5f) / height)) * camera.fovRadians };
+					return cameraToWorld.TransformVector(directionX, directionY, 1.f);
+				} };
+
+			const int numRays{ width * height };
+			int singleHits{ 0 };
+			const double singleRate{ MeasureRaysPerSecond(numRays, [&]()
+				{
+					for (int py{ 0 }; py < height; ++py)
+					{
+						for (int px{ 0 }; px < width; ++px)
+						{
+							HitRecord hitRecord{};
+							scene.GetClosestHit(Ray{ camera.origin, getDirection(px, py) }, hitRecord);
+							singleHits += hitRecord.didHit;
+						}
+					}
+				}) };
+
+			int packetHits{ 0 };
+			const double packetRate{ MeasureRaysPerSecond(numRays, [&]()
+				{
+					for (int tileY{ 0 }; tileY < height; tileY += RayPacketWidth)
+					{
+						for (int tileX{ 0 }; tileX < width; tileX += RayPacketWidth)
+						{
+							RayPacket packet;
+							packet.origin = camera.origin;
+							RayPacketMask mask{ 0 };
+							for (int lane{ 0 }; lane < RayPacketSize; ++lane)
+							{
+								const int px{ tileX + lane % RayPacketWidth };
+								const int py{ tileY + lane / RayPacketWidth };
+								packet.SetDirection(lane, getDirection(px, py));
+								packet.max[lane] = FLT_MAX;
+								if (px < width && py < height)
+									mask |= RayPacketMask{ 1 } << lane;
+							}
+							packet.UpdateFrustum();
+
+							HitRecord hitRecords[RayPacketSize]{};
+							scene.GetClosestHits(packet, mask, hitRecords);
+							for (const HitRecord& hitRecord : hitRecords)
+								packetHits += hitRecord.didHit;
+						}
+					}
+				}) };
+
+			std::cout << ">> " << sceneName << ": SINGLE RAYS = " << singleRate << " rays/s (" << singleHits << " hits), "
+				<< "PACKETS = " << packetRate << " rays/s (" << packetHits << " hits), x" << packetRate / singleRate << "\n";
+		}
+	}
+
+	void MicroBenchmarks::RunTriangleKernel(const std::string& objPath, int numRays)
+	{
+		TriangleMesh mesh{};
+		std::vector<Ray> rays{};
+		if (!LoadBenchmarkMesh(objPath, numRays, mesh, rays))
+			return;
+
+		const MeshGeometry& geometry{ *mesh.pGeometry };
+
+		//Brute force over every triangle, the way HitTest_TriangleMesh worked before the precomputed layout
+		int originalHits{ 0 };
+		const double originalRate{ MeasureRaysPerSecond(numRays, [&]()
+			{
+				for (const Ray& ray : rays)
+				{
+					Ray closestRay{ ray };
+					HitRecord hitRecord{};
+					for (size_t index{ 0 }; index + 2 < geometry.indices.size(); index += 3)
+					{
+						Triangle triangle{ geometry.positions[geometry.indices[index]], geometry.positions[geometry.indices[index + 1]], geometry.positions[geometry.indices[index + 2]] };
+						triangle.cullMode = mesh.cullMode;
+						if (GeometryUtils::HitTest_Triangle(triangle, closestRay, hitRecord))
+							closestRay.max = hitRecord.t;
+					}
+					originalHits += hitRecord.didHit;
+				}
+			}) };
+
+		//Same brute force loop with the Moller-Trumbore kernel, padding slots are zeroed and never hit
+		int precomputedHits{ 0 };
+		const double precomputedRate{ MeasureRaysPerSecond(numRays, [&]()
+			{
+				for (const Ray& ray : rays)
+				{
+					Ray closestRay{ ray };
+					float t{}, u{}, v{};
+					bool didHit{ false };
+					for (const PrecomputedTriangle& triangle : geometry.triangles)
+					{
+						if (GeometryUtils::HitTest_Triangle(triangle, mesh.cullMode, closestRay, t, u, v))
+						{
+							closestRay.max = t;
+							didHit = true;
+						}
+					}
+					precomputedHits += didHit;
+				}
+			}) };
+
+		//Full mesh test, BVH traversal included
+		int bvhHits{ 0 };
+		const double bvhRate{ MeasureRaysPerSecond(numRays, [&]()
+			{
+				for (const Ray& ray : rays)
+				{
+					HitRecord hitRecord{};
+					bvhHits += GeometryUtils::HitTest_TriangleMesh(mesh, ray, hitRecord);
+				}
+			}) };
+
+		std::cout << "**TRIANGLE KERNEL BENCHMARK** " << objPath << " (" << geometry.bvh.GetPrimitiveCount() << " triangles, " << numRays << " rays)\n";
+		std::cout << ">> ORIGINAL KERNEL = " << originalRate << " rays/s (" << originalHits << " hits)\n";
+		std::cout << ">> PRECOMPUTED KERNEL = " << precomputedRate << " rays/s (" << precomputedHits << " hits)\n";
+		std::cout << ">> " << TriangleSIMD::ToString(TriangleSIMD::GetActiveLevel()) << " BLOCK KERNEL + BVH = " << bvhRate << " rays/s (" << bvhHits << " hits)" << std::endl;
+	}
+
+	void MicroBenchmarks::RunTriangleBlockKernels(const std::string& objPath, int numRays)
+	{
+		TriangleMesh mesh{};
+		std::vector<Ray> rays{};
+		if (!LoadBenchmarkMesh(objPath, numRays, mesh, rays))
+			return;
+
+		const MeshGeometry& geometry{ *mesh.pGeometry };
+		const SIMDLevel previousLevel{ TriangleSIMD::GetActiveLevel() };
+
+		std::cout << "**TRIANGLE BLOCK BENCHMARK** " << objPath << " (" << geometry.bvh.GetPrimitiveCount() << " triangles in " << geometry.triangleBlocks.size() << " blocks, " << numRays << " rays)\n";
+		for (int level{ 0 }; level <= static_cast<int>(TriangleSIMD::GetSupportedLevel()); ++level)
+		{
+			const SIMDLevel simdLevel{ static_cast<SIMDLevel>(level) };
+			TriangleSIMD::SetActiveLevel(simdLevel);
+
+			//Brute force over every block, measures the kernel on its own
+			int blockHits{ 0 };
+			const double blockRate{ MeasureRaysPerSecond(numRays, [&]()
+				{
+					for (const Ray& ray : rays)
+					{
+						Ray closestRay{ ray };
+						float t{}, u{}, v{};
+						bool didHit{ false };
+						for (const TriangleBlock& block : geometry.triangleBlocks)
+						{
+							if (TriangleSIMD::IntersectBlock(simdLevel, block, mesh.cullMode, closestRay, t, u, v) != -1)
+							{
+								closestRay.max = t;
+								didHit = true;
+							}
+						}
+						blockHits += didHit;
+					}
+				}) };
+
+			//Full mesh test, BVH traversal included
+			int bvhHits{ 0 };
+			const double bvhRate{ MeasureRaysPerSecond(numRays, [&]()
+				{
+					for (const Ray& ray : rays)
+					{
+						HitRecord hitRecord{};
+						bvhHits += GeometryUtils::HitTest_TriangleMesh(mesh, ray, hitRecord);
+					}
+				}) };
+
+			std::cout << ">> " << TriangleSIMD::ToString(simdLevel) << " BLOCKS = " << blockRate << " rays/s (" << blockHits << " hits), "
+				<< "BLOCKS + BVH = " << bvhRate << " rays/s (" << bvhHits << " hits)\n";
+		}
+		std::cout << std::flush;
+
+		TriangleSIMD::SetActiveLevel(previousLevel);
+	}
+
+	void MicroBenchmarks::RunRaySphere(int numPackets, int numSpheres)
+	{
+		std::mt19937 generator{ 1337 };
+		std::uniform_real_distribution<float> distribution{ -1.f, 1.f };
+		const auto randomVector{ [&]() { return Vector3{ distribution(generator), distribution(generator), distribution(generator) }; } };
+
+		std::vector<Sphere> spheres(numSpheres);
+		for (Sphere& sphere : spheres)
+		{
+			sphere.origin = randomVector() * 10.f;
+			sphere.radius = 1.25f + distribution(generator) * .75f;
+		}
+
+		//Every packet starts at one point outside the spheres and aims its lanes at random points between them
+		std::vector<RayPacket> packets(numPackets);
+		for (RayPacket& packet : packets)
+		{
+			packet.origin = randomVector().Normalized() * 30.f;
+			for (int lane{ 0 }; lane < RayPacketSize; ++lane)
+			{
+				packet.SetDirection(lane, (randomVector() * 10.f - packet.origin).Normalized());
+				packet.max[lane] = FLT_MAX;
+			}
+		}
+
+		const int numTests{ numPackets * RayPacketSize * numSpheres };
+
+		//One ray at a time, the way the single ray traversal calls the sphere test
+		int singleHits{ 0 };
+		const double singleRate{ MeasureRaysPerSecond(numTests, [&]()
+			{
+				for (const RayPacket& packet : packets)
+				{
+					for (int lane{ 0 }; lane < RayPacketSize; ++lane)
+					{
+						Ray ray{ packet.GetRay(lane) };
+						HitRecord hitRecord{};
+						for (const Sphere& sphere : spheres)
+						{
+							if (GeometryUtils::HitTest_Sphere(sphere, ray, hitRecord))
+								ray.max = hitRecord.t;
+						}
+						singleHits += hitRecord.didHit;
+					}
+				}
+			}) };
+
+		//Whole packets, Vector3x8 lanes
+		int packetHits{ 0 };
+		const double packetRate{ MeasureRaysPerSecond(numTests, [&]()
+			{
+				for (RayPacket packet : packets)
+				{
+					HitRecord hitRecords[RayPacketSize]{};
+					for (const Sphere& sphere : spheres)
+					{
+						GeometryUtils::HitTest_Sphere(sphere, packet, ~RayPacketMask{ 0 }, hitRecords);
+					}
+					for (const HitRecord& hitRecord : hitRecords)
+						packetHits += hitRecord.didHit;
+				}
+			}) };
+
+		std::cout << "**RAY-SPHERE BENCHMARK** " << numSpheres << " spheres, " << numPackets * RayPacketSize << " rays\n";
+		std::cout << ">> SINGLE RAYS = " << singleRate << " tests/s (" << singleHits << " hits)\n";
+		std::cout << ">> PACKETS = " << packetRate << " tests/s (" << packetHits << " hits), x" << packetRate / singleRate << std::endl;
+	}
+
+	void MicroBenchmarks::RunPrimaryRays(int width, int height)
+	{
+		std::cout << "**PRIMARY RAY BENCHMARK** " << width << "x" << height << ", " << RayPacketWidth << "x" << RayPacketWidth << " packets\n";
+
+		const std::unique_ptr<Scene> pReferenceScene{ CreateScene("Reference") };
+		if (pReferenceScene)
+			MeasurePrimaryRays("REFERENCE SCENE", *pReferenceScene, width, height);
+
+		const std::unique_ptr<Scene> pBunnyScene{ CreateScene("Bunny") };
+		if (pBunnyScene)
+			MeasurePrimaryRays("BUNNY SCENE", *pBunnyScene, width, height);
+
+		std::cout << std::flush;
+	}
+
+	void MicroBenchmarks::RunBVHBuilders(const std::string& objPath, int numRays)
+	{
+		TriangleMesh mesh{};
+		std::vector<Ray> rays{};
+		if (!LoadBenchmarkMesh(objPath, numRays, mesh, rays))
+			return;
+
+		MeshGeometry& geometry{ *mesh.pGeometry };
+		std::cout << "**BVH BUILDER BENCHMARK** " << objPath << " (" << geometry.indices.size() / 3 << " triangles, " << numRays << " rays)\n";
+
+		constexpr std::pair<BVHBuildMethod, const char*> buildMethods[]{
+			{ BVHBuildMethod::SAH, "SAH" },
+			{ BVHBuildMethod::Linear, "LBVH" },
+			{ BVHBuildMethod::LinearTreelets, "LBVH + TREELETS" } };
+		double sahBuildTime{}, sahRate{};
+		for (const auto& [buildMethod, name] : buildMethods)
+		{
+			//Small meshes build in well under a millisecond, repeat the build until the time is measurable
+			geometry.bvhBuildMethod = buildMethod;
+			int numBuilds{ 0 };
+			const auto start{ std::chrono::high_resolution_clock::now() };
+			std::chrono::duration<double, std::milli> elapsed{};
+			do
+			{
+				geometry.UpdateBVH();
+				++numBuilds;
+				elapsed = std::chrono::high_resolution_clock::now() - start;
+			} while (elapsed.count() < 200.0);
+			const double buildTime{ elapsed.count() / numBuilds };
+			mesh.UpdateTransforms();
+
+			int hits{ 0 };
+			const double rate{ MeasureRaysPerSecond(numRays, [&]()
+				{
+					for (const Ray& ray : rays)
+					{
+						HitRecord hitRecord{};
+						hits += GeometryUtils::HitTest_TriangleMesh(mesh, ray, hitRecord);
+					}
+				}) };
+
+			if (buildMethod == BVHBuildMethod::SAH)
+			{
+				sahBuildTime = buildTime;
+				sahRate = rate;
+			}
+			std::cout << ">> " << name << ": BUILD = " << buildTime << " ms (x" << sahBuildTime / buildTime << "), "
+				<< geometry.bvh.GetNodes().size() << " nodes, SAH cost " << geometry.bvh.GetSAHCost() << ", "
+				<< "TRACE = " << rate << " rays/s (x" << rate / sahRate << ", " << hits << " hits)\n";
+		}
+		std::cout << std::flush;
+	}
+
+	void MicroBenchmarks::RunQuantizedBVH(const std::string& objPath, int numRays)
+	{
+		TriangleMesh mesh{};
+		std::vector<Ray> rays{};
+		if (!LoadBenchmarkMesh(objPath, numRays, mesh, rays))
+			return;
+
+		MeshGeometry& geometry{ *mesh.pGeometry };
+		const double numTriangles{ static_cast<double>(geometry.indices.size() / 3) };
+		std::cout << "**QUANTIZED BVH BENCHMARK** " << objPath << " (" << geometry.indices.size() / 3 << " triangles, " << numRays << " rays)\n";
+
+		//Both layouts share the primitive slots, those are reported on their own
+		const double slotBytes{ static_cast<double>(geometry.bvh.GetSlotCount() * sizeof(uint32_t)) / numTriangles };
+		std::cout << ">> PRIMITIVE SLOTS = " << slotBytes << " bytes per triangle, shared by both layouts\n";
+
+		double floatRate{};
+		for (const bool useQuantizedBVH : { false, true })
+		{
+			geometry.bvhLayout = useQuantizedBVH ? BVHLayout::Quantized : BVHLayout::Binary;
+			geometry.UpdateBVHLayout();
+			const size_t nodeBytes{ useQuantizedBVH ? geometry.quantizedBVH.GetMemoryUsage() : geometry.bvh.GetNodes().size() * sizeof(BVHNode) };
+
+			int hits{ 0 };
+			const double rate{ MeasureRaysPerSecond(numRays, [&]()
+				{
+					for (const Ray& ray : rays)
+					{
+						HitRecord hitRecord{};
+						hits += GeometryUtils::HitTest_TriangleMesh(mesh, ray, hitRecord);
+					}
+				}) };
+			if (!useQuantizedBVH)
+				floatRate = rate;
+
+			std::cout << ">> " << (useQuantizedBVH ? "QUANTIZED" : "FULL PRECISION") << ": NODES = " << nodeBytes / 1024.0 << " KB, "
+				<< nodeBytes / numTriangles << " bytes per triangle, TRACE = " << rate << " rays/s (x" << rate / floatRate << ", " << hits << " hits)\n";
+		}
+		std::cout << std::flush;
+	}
+
+	void MicroBenchmarks::RunWideBVH(const std::string& objPath, int numRays)
+	{
+		TriangleMesh mesh{};
+		std::vector<Ray> rays{};
+		if (!LoadBenchmarkMesh(objPath, numRays, mesh, rays))
+			return;
+
+		MeshGeometry& geometry{ *mesh.pGeometry };
+		std::cout << "**WIDE BVH BENCHMARK** " << objPath << " (" << geometry.indices.size() / 3 << " triangles, " << numRays << " rays)\n";
+
+		//Shadow rays leave the surface points the camera rays hit towards random points in the bounds, so no two go the same way
+		std::vector<Ray> shadowRays{};
+		shadowRays.reserve(numRays);
+		std::mt19937 generator{ 7331 };
+		std::uniform_real_distribution<float> distribution{ 0.f, 1.f };
+		for (const Ray& ray : rays)
+		{
+			HitRecord hitRecord{};
+			if (!GeometryUtils::HitTest_TriangleMesh(mesh, ray, hitRecord))
+				continue;
+
+			const Vector3 target{
+				Lerpf(geometry.minAABB.x, geometry.maxAABB.x, distribution(generator)),
+				Lerpf(geometry.minAABB.y, geometry.maxAABB.y, distribution(generator)),
+				Lerpf(geometry.minAABB.z, geometry.maxAABB.z, distribution(generator)) };
+			Ray shadowRay{};
+			shadowRay.origin = hitRecord.origin;
+			shadowRay.direction = (target - hitRecord.origin).Normalized();
+			shadowRay.min = .001f;
+			shadowRay.max = (target - hitRecord.origin).Magnitude();
+			shadowRay.castsShadow = true;
+			shadowRays.push_back(shadowRay);
+		}
+
+		double binaryClosestRate{}, binaryShadowRate{};
+		for (const BVHLayout layout : { BVHLayout::Binary, BVHLayout::Wide4, BVHLayout::Wide8 })
+		{
+			geometry.bvhLayout = layout;
+			geometry.UpdateBVHLayout();
+			const size_t nodeBytes{ layout == BVHLayout::Wide4 ? geometry.wideBVH4.GetMemoryUsage() :
+				layout == BVHLayout::Wide8 ? geometry.wideBVH8.GetMemoryUsage() : geometry.bvh.GetNodes().size() * sizeof(BVHNode) };
+
+			int hits{ 0 };
+			const double closestRate{ MeasureRaysPerSecond(numRays, [&]()
+				{
+					for (const Ray& ray : rays)
+					{
+						HitRecord hitRecord{};
+						hits += GeometryUtils::HitTest_TriangleMesh(mesh, ray, hitRecord);
+					}
+				}) };
+			int occluded{ 0 };
+			const double shadowRate{ MeasureRaysPerSecond(static_cast<int>(shadowRays.size()), [&]()
+				{
+					for (const Ray& ray : shadowRays)
+						occluded += GeometryUtils::HitTest_TriangleMesh(mesh, ray);
+				}) };
+			if (layout == BVHLayout::Binary)
+			{
+				binaryClosestRate = closestRate;
+				binaryShadowRate = shadowRate;
+			}
+
+			const char* name{ layout == BVHLayout::Wide4 ? "BVH4" : layout == BVHLayout::Wide8 ? "BVH8" : "BINARY" };
+			std::cout << ">> " << name << ": NODES = " << nodeBytes / 1024.0 << " KB, CLOSEST HIT = " << closestRate << " rays/s (x"
+				<< closestRate / binaryClosestRate << ", " << hits << " hits), SHADOW = " << shadowRate << " rays/s (x"
+				<< shadowRate / binaryShadowRate << ", " << occluded << " occluded)\n";
+		}
+		geometry.bvhLayout = BVHLayout::Binary;
+		geometry.UpdateBVHLayout();
+		std::cout << std::flush;
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+
+namespace dae
+{
+	//Standalone throughput measurements of the intersection kernels, results are printed to the console
+	namespace MicroBenchmarks
+	{
+		/**
+		 * \brief Compares the original triangle test against the precomputed Moller-Trumbore kernel
+		 * \param objPath mesh used for the measurement
+		 * \param numRays number of random rays shot at the mesh
+		 */
+		void RunTriangleKernel(const std::string& objPath = "Resources/lowpoly_bunny2.obj", int numRays = 20000);
+		/**
+		 * \brief Measures the 8-wide triangle block kernel at every SIMD level the CPU supports
+		 * \param objPath mesh used for the measurement
+		 * \param numRays number of random rays shot at the mesh
+		 */
+		void RunTriangleBlockKernels(const std::string& objPath = "Resources/lowpoly_bunny2.obj", int numRays = 20000);
+		/**
+		 * \brief Compares the single ray sphere test against the 8-wide packet test, counted in ray-sphere tests per second
+		 * \param numPackets number of random 8x8 ray packets, the single ray test traces the same rays one by one
+		 * \param numSpheres number of random spheres every ray is tested against
+		 */
+		void RunRaySphere(int numPackets = 512, int numSpheres = 64);
+		/**
+		 * \brief Compares single camera rays against 8x8 ray packets for primary visibility only, on one thread
+		 * \param width horizontal resolution of the traced image
+		 * \param height vertical resolution of the traced image
+		 */
+		void RunPrimaryRays(int width = 640, int height = 480);
+		/**
+		 * \brief Compares the SAH builder against the linear builder with and without treelet restructuring
+		 * Reports build time, SAH cost and closest hit rays per second through the finished mesh for each builder
+		 * \param objPath mesh used for the measurement
+		 * \param numRays number of random rays shot at the mesh
+		 */
+		void RunBVHBuilders(const std::string& objPath = "Resources/lowpoly_bunny2.obj", int numRays = 200000);
+		/**
+		 * \brief Compares the quantized BVH node layout against the full precision one
+		 * Reports the node bytes per triangle of both layouts and closest hit rays per second through the mesh
+		 * \param objPath mesh used for the measurement
+		 * \param numRays number of random rays shot at the mesh
+		 */
+		void RunQuantizedBVH(const std::string& objPath = "Resources/lowpoly_bunny2.obj", int numRays = 200000);
+		/**
+		 * \brief Compares single ray traversal of the binary BVH against its BVH4 and BVH8 collapses
+		 * Reports closest hit rays per second and any hit rays per second for incoherent shadow rays leaving the mesh surface
+		 * \param objPath mesh used for the measurement
+		 * \param numRays number of random rays shot at the mesh, their hits are the origins of the shadow rays
+		 */
+		void RunWideBVH(const std::string& objPath = "Resources/lowpoly_bunny2.obj", int numRays = 200000);
+	}
+}
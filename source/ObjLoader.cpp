@@ -0,0 +1,353 @@
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+using namespace dae;
+
+namespace
+{
+	//Chunks smaller than this are not worth a task of their own
+	constexpr size_t MinChunkSize{ 256 * 1024 };
+	constexpr uint32_t ChunksPerThread{ 4 };
+
+	//Index of one face corner, indices that were negative in the file are still relative to the start of their chunk
+	struct ObjCorner
+	{
+		int position;
+		int texCoord; //-1 if absent
+		int normal; //-1 if absent
+		uint8_t relativeMask; //bit 0, 1, 2: position, texCoord, normal is chunk relative
+	};
+
+	struct ObjChunk
+	{
+		const char* pBegin{};
+		const char* pEnd{};
+
+		std::vector<Vector3> positions{};
+		std::vector<Vector3> texCoords{};
+		std::vector<Vector3> normals{};
+		std::vector<ObjCorner> corners{}; //three per triangle
+
+		//Offsets of this chunk in the merged arrays
+		size_t firstPosition{}, firstTexCoord{}, firstNormal{}, firstCorner{};
+
+		const char* pErrorLine{}; //first malformed line, nullptr if the chunk parsed fine
+	};
+
+	bool IsSpace(char character)
+	{
+		return character == ' ' || character == '\t' || character == '\r';
+	}
+
+	const char* SkipSpaces(const char* pCurrent, const char* pEnd)
+	{
+		while (pCurrent < pEnd && IsSpace(*pCurrent))
+			++pCurrent;
+		return pCurrent;
+	}
+
+	bool ParseFloat(const char*& pCurrent, const char* pEnd, float& value)
+	{
+		pCurrent = SkipSpaces(pCurrent, pEnd);
+		//from_chars does not accept a leading plus sign
+		if (pCurrent < pEnd && *pCurrent == '+')
+			++pCurrent;
+
+		const std::from_chars_result result{ std::from_chars(pCurrent, pEnd, value) };
+		if (result.ec != std::errc{})
+			return false;
+		pCurrent = result.ptr;
+		return true;
+	}
+
+	//Parses the three components of v, vn or vt, optional trailing components default to 0
+	bool ParseVector(const char* pCurrent, const char* pEnd, int numRequired, Vector3& vector)
+	{
+		float components[3]{};
+		for (int i{ 0 }; i < 3; ++i)
+		{
+			if (i >= numRequired && SkipSpaces(pCurrent, pEnd) == pEnd)
+				break;
+			if (!ParseFloat(pCurrent, pEnd, components[i]))
+				return false;
+		}
+		vector = { components[0], components[1], components[2] };
+		return true;
+	}
+
+	//Turns a one based, possibly negative OBJ index into a zero based one, negative ones stay relative to the chunk
+	bool ResolveIndex(int fileIndex, size_t localCount, int& index, bool& isRelative)
+	{
+		if (fileIndex > 0)
+		{
+			index = fileIndex - 1;
+			isRelative = false;
+			return true;
+		}
+		if (fileIndex < 0)
+		{
+			index = static_cast<int>(localCount) + fileIndex;
+			isRelative = true;
+			return true;
+		}
+		return false;
+	}
+
+	bool ParseCorner(const char*& pCurrent, const char* pEnd, const ObjChunk& chunk, ObjCorner& corner)
+	{
+		corner = { -1, -1, -1, 0 };
+		const size_t localCounts[3]{ chunk.positions.size(), chunk.texCoords.size(), chunk.normals.size() };
+		int* pIndices[3]{ &corner.position, &corner.texCoord, &corner.normal };
+
+		//v, v/vt, v//vn or v/vt/vn
+		for (int component{ 0 }; component < 3; ++component)
+		{
+			if (component > 0)
+			{
+				if (pCurrent >= pEnd || *pCurrent != '/')
+					break;
+				++pCurrent;
+				if (pCurrent < pEnd && *pCurrent == '/')
+					continue;
+			}
+
+			int fileIndex{};
+			const std::from_chars_result result{ std::from_chars(pCurrent, pEnd, fileIndex) };
+			if (result.ec != std::errc{})
+				return false;
+			pCurrent = result.ptr;
+
+			bool isRelative{};
+			if (!ResolveIndex(fileIndex, localCounts[component], *pIndices[component], isRelative))
+				return false;
+			if (isRelative)
+				corner.relativeMask |= static_cast<uint8_t>(1 << component);
+		}
+		return pCurrent >= pEnd || IsSpace(*pCurrent);
+	}
+
+	bool ParseFace(const char* pCurrent, const char* pEnd, ObjChunk& chunk, std::vector<ObjCorner>& polygon)
+	{
+		polygon.clear();
+		while ((pCurrent = SkipSpaces(pCurrent, pEnd)) < pEnd)
+		{
+			ObjCorner corner{};
+			if (!ParseCorner(pCurrent, pEnd, chunk, corner))
+				return false;
+			polygon.push_back(corner);
+		}
+		if (polygon.size() < 3)
+			return false;
+
+		//Fan triangulation, exact for the convex polygons exporters write
+		for (size_t i{ 1 }; i + 1 < polygon.size(); ++i)
+		{
+			chunk.corners.push_back(polygon[0]);
+			chunk.corners.push_back(polygon[i]);
+			chunk.corners.push_back(polygon[i + 1]);
+		}
+		return true;
+	}
+
+	bool ParseLine(const char* pCurrent, const char* pEnd, ObjChunk& chunk, std::vector<ObjCorner>& polygon)
+	{
+		pCurrent = SkipSpaces(pCurrent, pEnd);
+		const size_t length{ static_cast<size_t>(pEnd - pCurrent) };
+		if (length >= 2 && pCurrent[0] == 'v' && IsSpace(pCurrent[1]))
+		{
+			Vector3 position{};
+			if (!ParseVector(pCurrent + 2, pEnd, 3, position))
+				return false;
+			chunk.positions.push_back(position);
+		}
+		else if (length >= 3 && pCurrent[0] == 'v' && pCurrent[1] == 't' && IsSpace(pCurrent[2]))
+		{
+			Vector3 texCoord{};
+			if (!ParseVector(pCurrent + 3, pEnd, 1, texCoord))
+				return false;
+			chunk.texCoords.push_back(texCoord);
+		}
+		else if (length >= 3 && pCurrent[0] == 'v' && pCurrent[1] == 'n' && IsSpace(pCurrent[2]))
+		{
+			Vector3 normal{};
+			if (!ParseVector(pCurrent + 3, pEnd, 3, normal))
+				return false;
+			chunk.normals.push_back(normal);
+		}
+		else if (length >= 2 && pCurrent[0] == 'f' && IsSpace(pCurrent[1]))
+		{
+			return ParseFace(pCurrent + 2, pEnd, chunk, polygon);
+		}
+		return true;
+	}
+
+	void ParseChunk(ObjChunk& chunk)
+	{
+		std::vector<ObjCorner> polygon{};
+		const char* pCurrent{ chunk.pBegin };
+		while (pCurrent < chunk.pEnd)
+		{
+			const char* pLineEnd{ static_cast<const char*>(std::memchr(pCurrent, '\n', chunk.pEnd - pCurrent)) };
+			if (!pLineEnd)
+				pLineEnd = chunk.pEnd;
+
+			if (!ParseLine(pCurrent, pLineEnd, chunk, polygon))
+			{
+				chunk.pErrorLine = pCurrent;
+				return;
+			}
+			pCurrent = pLineEnd + 1;
+		}
+	}
+
+	//Splits the file in chunks that start right after a line break
+	std::vector<ObjChunk> SplitChunks(const char* pData, size_t size, uint32_t numThreads)
+	{
+		const size_t numChunks{ std::clamp<size_t>(size / MinChunkSize, 1, static_cast<size_t>(numThreads) * ChunksPerThread) };
+
+		std::vector<ObjChunk> chunks(numChunks);
+		const char* pEnd{ pData + size };
+		const char* pBegin{ pData };
+		for (size_t i{ 0 }; i < numChunks; ++i)
+		{
+			const char* pSplit{ i + 1 == numChunks ? pEnd : std::max(pBegin, pData + size * (i + 1) / numChunks) };
+			if (pSplit < pEnd)
+			{
+				const char* pLineEnd{ static_cast<const char*>(std::memchr(pSplit, '\n', pEnd - pSplit)) };
+				pSplit = pLineEnd ? pLineEnd + 1 : pEnd;
+			}
+
+			chunks[i].pBegin = pBegin;
+			chunks[i].pEnd = pSplit;
+			pBegin = pSplit;
+		}
+		return chunks;
+	}
+
+	bool CopyChunk(const ObjChunk& chunk, ObjData& data)
+	{
+		std::copy(chunk.positions.begin(), chunk.positions.end(), data.positions.begin() + chunk.firstPosition);
+		std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), data.texCoords.begin() + chunk.firstTexCoord);
+		std::copy(chunk.normals.begin(), chunk.normals.end(), data.normals.begin() + chunk.firstNormal);
+
+		const int offsets[3]{ static_cast<int>(chunk.firstPosition), static_cast<int>(chunk.firstTexCoord), static_cast<int>(chunk.firstNormal) };
+		const int counts[3]{ static_cast<int>(data.positions.size()), static_cast<int>(data.texCoords.size()), static_cast<int>(data.normals.size()) };
+		std::vector<int>* pIndexArrays[3]{ &data.indices, &data.texCoordIndices, &data.normalIndices };
+
+		for (size_t i{ 0 }; i < chunk.corners.size(); ++i)
+		{
+			const ObjCorner& corner{ chunk.corners[i] };
+			const int cornerIndices[3]{ corner.position, corner.texCoord, corner.normal };
+			for (int component{ 0 }; component < 3; ++component)
+			{
+				int index{ cornerIndices[component] };
+				if (corner.relativeMask & (1 << component))
+					index += offsets[component];
+
+				//Positions are required, the others are optional
+				const bool isAbsent{ component > 0 && index == -1 && !(corner.relativeMask & (1 << component)) };
+				if (!isAbsent && (index < 0 || index >= counts[component]))
+					return false;
+
+				std::vector<int>& indexArray{ *pIndexArrays[component] };
+				if (!indexArray.empty())
+					indexArray[chunk.firstCorner + i] = isAbsent ? -1 : index;
+			}
+		}
+		return true;
+	}
+}
+
+bool ObjLoader::Load(const std::string& path, ObjData& data, uint32_t numThreads)
+{
+	const auto start{ std::chrono::steady_clock::now() };
+
+	const MappedFile file{ path };
+	if (!file.IsOpen())
+	{
+		std::cout << "Could not open " << path << std::endl;
+		return false;
+	}
+
+	if (numThreads == 0)
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<ObjChunk> chunks{ SplitChunks(file.GetData(), file.GetSize(), numThreads) };
+	const uint32_t numChunks{ static_cast<uint32_t>(chunks.size()) };
+
+	//Small files fit in one chunk, starting worker threads for them would take longer than parsing
+	const std::unique_ptr<ThreadPool> pThreadPool{ numChunks > 1 ? std::make_unique<ThreadPool>(std::min(numThreads, numChunks)) : nullptr };
+	const auto forEachChunk{ [&](const ThreadPool::Task& task)
+		{
+			if (pThreadPool)
+				pThreadPool->ParallelFor(numChunks, task);
+			else
+				task(0, 0);
+		} };
+
+	forEachChunk([&](uint32_t chunkIndex, uint32_t)
+		{
+			ParseChunk(chunks[chunkIndex]);
+		});
+
+	//Prefix sums give every chunk its place in the merged arrays
+	size_t numPositions{}, numTexCoords{}, numNormals{}, numCorners{};
+	for (ObjChunk& chunk : chunks)
+	{
+		if (chunk.pErrorLine)
+		{
+			const char* pLineEnd{ std::find(chunk.pErrorLine, chunk.pEnd, '\n') };
+			std::cout << "Malformed line in " << path << ": " << std::string(chunk.pErrorLine, pLineEnd) << std::endl;
+			return false;
+		}
+
+		chunk.firstPosition = numPositions;
+		chunk.firstTexCoord = numTexCoords;
+		chunk.firstNormal = numNormals;
+		chunk.firstCorner = numCorners;
+		numPositions += chunk.positions.size();
+		numTexCoords += chunk.texCoords.size();
+		numNormals += chunk.normals.size();
+		numCorners += chunk.corners.size();
+	}
+
+	data = {};
+	data.positions.resize(numPositions);
+	data.texCoords.resize(numTexCoords);
+	data.normals.resize(numNormals);
+	data.indices.resize(numCorners);
+	if (numTexCoords > 0)
+		data.texCoordIndices.resize(numCorners);
+	if (numNormals > 0)
+		data.normalIndices.resize(numCorners);
+
+	std::atomic<bool> isValid{ true };
+	forEachChunk([&](uint32_t chunkIndex, uint32_t)
+		{
+			if (!CopyChunk(chunks[chunkIndex], data))
+				isValid = false;
+		});
+	if (!isValid)
+	{
+		std::cout << "Index out of range in " << path << std::endl;
+		data = {};
+		return false;
+	}
+
+	const std::chrono::duration<double> elapsed{ std::chrono::steady_clock::now() - start };
+	const double megabytes{ static_cast<double>(file.GetSize()) / (1024.0 * 1024.0) };
+	std::cout << "Loaded " << path << ": " << numPositions << " vertices, " << numCorners / 3 << " triangles, "
+		<< megabytes << " MB in " << elapsed.count() * 1000.0 << " ms (" << megabytes / elapsed.count() << " MB/s, "
+		<< numChunks << (numChunks == 1 ? " chunk)" : " chunks)") << std::endl;
+	return true;
+}
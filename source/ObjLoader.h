@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Vector3.h"
+
+namespace dae
+{
+	//Triangulated contents of an OBJ file, every triangle corner has its own position, texture coordinate and normal index
+	struct ObjData
+	{
+		std::vector<Vector3> positions{};
+		std::vector<Vector3> texCoords{}; //u, v, w
+		std::vector<Vector3> normals{}; //vertex normals as written in the file, not normalized
+
+		//Three entries per triangle, zero based
+		std::vector<int> indices{};
+		//Same layout as indices, -1 for corners without one, empty if the file has no vt/vn at all
+		std::vector<int> texCoordIndices{};
+		std::vector<int> normalIndices{};
+	};
+
+	namespace ObjLoader
+	{
+		/**
+		 * \brief Memory maps an OBJ file and parses it in line aligned chunks on multiple threads
+		 * Supports v, vt, vn and f with the v, v/vt, v//vn and v/vt/vn forms, negative (relative) indices and polygons, which are fan triangulated
+		 * Other statements (o, g, s, usemtl, ...) are skipped
+		 * \param numThreads parsing threads, 0 uses one per hardware thread
+		 * \return false if the file can't be read or contains a malformed line or an index out of range
+		 */
+		bool Load(const std::string& path, ObjData& data, uint32_t numThreads = 0);
+	}
+}
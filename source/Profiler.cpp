@@ -0,0 +1,141 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace dae;
+
+namespace
+{
+	struct ZoneEvent
+	{
+		const char* name;
+		int64_t start;
+		int64_t end;
+	};
+
+	struct ThreadEvents
+	{
+		std::string threadName{};
+		uint32_t threadId{};
+		std::vector<ZoneEvent> events{};
+		uint64_t numWritten{}; //only touched by the owning thread while capturing, wraps around events
+	};
+
+	std::atomic<bool> g_IsCapturing{ false };
+	int64_t g_CaptureStart{};
+
+	//Buffers stay alive until the program exits, even when their thread is gone, so the trace can still be written
+	std::mutex g_ThreadsMutex{};
+	std::vector<std::unique_ptr<ThreadEvents>> g_Threads{};
+
+	thread_local ThreadEvents* t_pThreadEvents{ nullptr };
+
+	ThreadEvents& GetThreadEvents()
+	{
+		if (!t_pThreadEvents)
+		{
+			std::lock_guard lock{ g_ThreadsMutex };
+			auto pThreadEvents{ std::make_unique<ThreadEvents>() };
+			pThreadEvents->threadId = static_cast<uint32_t>(g_Threads.size());
+			pThreadEvents->threadName = "Thread " + std::to_string(pThreadEvents->threadId);
+			t_pThreadEvents = pThreadEvents.get();
+			g_Threads.push_back(std::move(pThreadEvents));
+		}
+		return *t_pThreadEvents;
+	}
+
+	void WriteEscaped(std::ofstream& file, const std::string& text)
+	{
+		for (const char character : text)
+		{
+			if (character == '"' || character == '\\')
+				file << '\\';
+			file << character;
+		}
+	}
+}
+
+void Profiler::BeginCapture()
+{
+	std::lock_guard lock{ g_ThreadsMutex };
+	for (const auto& pThreadEvents : g_Threads)
+	{
+		pThreadEvents->numWritten = 0;
+	}
+	g_CaptureStart = GetTimestamp();
+	g_IsCapturing.store(true, std::memory_order_release);
+}
+
+void Profiler::EndCapture()
+{
+	g_IsCapturing.store(false, std::memory_order_release);
+}
+
+bool Profiler::IsCapturing()
+{
+	return g_IsCapturing.load(std::memory_order_relaxed);
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+	ThreadEvents& threadEvents{ GetThreadEvents() };
+	std::lock_guard lock{ g_ThreadsMutex };
+	threadEvents.threadName = name;
+}
+
+int64_t Profiler::GetTimestamp()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::RecordZone(const char* name, int64_t start, int64_t end)
+{
+	ThreadEvents& threadEvents{ GetThreadEvents() };
+	if (threadEvents.events.empty())
+		threadEvents.events.resize(RingBufferSize);
+
+	threadEvents.events[threadEvents.numWritten % RingBufferSize] = { name, start, end };
+	++threadEvents.numWritten;
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path)
+{
+	std::ofstream file{ path };
+	if (!file)
+		return false;
+
+	std::lock_guard lock{ g_ThreadsMutex };
+
+	//Complete ("X") events with microsecond timestamps relative to the start of the capture, the viewer nests them by time
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+	bool isFirstEvent{ true };
+	for (const auto& pThreadEvents : g_Threads)
+	{
+		file << (isFirstEvent ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << pThreadEvents->threadId
+			<< ",\"args\":{\"name\":\"";
+		WriteEscaped(file, pThreadEvents->threadName);
+		file << "\"}}";
+		isFirstEvent = false;
+
+		const uint64_t numEvents{ std::min<uint64_t>(pThreadEvents->numWritten, RingBufferSize) };
+		for (uint64_t i{ pThreadEvents->numWritten - numEvents }; i < pThreadEvents->numWritten; ++i)
+		{
+			const ZoneEvent& event{ pThreadEvents->events[i % RingBufferSize] };
+			file << ",\n{\"name\":\"";
+			WriteEscaped(file, event.name);
+			file << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << pThreadEvents->threadId
+				<< ",\"ts\":" << static_cast<double>(event.start - g_CaptureStart) / 1000.0
+				<< ",\"dur\":" << static_cast<double>(event.end - event.start) / 1000.0 << "}";
+		}
+	}
+	file << "\n]}\n";
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+//Set to 0 to compile every profiling zone out of the build
+#ifndef RAYTRACER_PROFILING
+#define RAYTRACER_PROFILING 1
+#endif
+
+namespace dae
+{
+	//Records nested, named time ranges per thread and exports them in the Chrome trace_event format (chrome://tracing, Perfetto)
+	//Every thread writes to its own ring buffer, so zones never contend with each other, only the oldest events of a long capture get overwritten
+	namespace Profiler
+	{
+		//Events a single thread keeps before the oldest ones are overwritten
+		constexpr uint32_t RingBufferSize{ 1u << 17 };
+
+		/**
+		 * \brief Clears all recorded events and starts recording zones
+		 * Call it between frames, while no other thread is inside a zone
+		 */
+		void BeginCapture();
+		//Stops recording, zones that are still open get recorded when they end
+		void EndCapture();
+		bool IsCapturing();
+
+		//Name shown for the calling thread in the trace
+		void SetThreadName(const std::string& name);
+
+		/**
+		 * \brief Writes the events of the last capture as Chrome trace_event JSON
+		 * \return false if the file could not be written
+		 */
+		bool WriteChromeTrace(const std::string& path);
+
+		int64_t GetTimestamp();
+		void RecordZone(const char* name, int64_t start, int64_t end);
+	}
+
+	//Records the time between construction and destruction when a capture is running
+	class ProfileZone final
+	{
+	public:
+		//name has to outlive the capture, use string literals
+		explicit ProfileZone(const char* name) :
+			m_Name{ name },
+			m_Start{ Profiler::IsCapturing() ? Profiler::GetTimestamp() : 0 }
+		{
+		}
+
+		~ProfileZone()
+		{
+			if (m_Start != 0)
+				Profiler::RecordZone(m_Name, m_Start, Profiler::GetTimestamp());
+		}
+
+		ProfileZone(const ProfileZone&) = delete;
+		ProfileZone(ProfileZone&&) noexcept = delete;
+		ProfileZone& operator=(const ProfileZone&) = delete;
+		ProfileZone& operator=(ProfileZone&&) noexcept = delete;
+
+	private:
+		const char* m_Name;
+		int64_t m_Start;
+	};
+}
+
+#if RAYTRACER_PROFILING
+#define PROFILE_ZONE_CONCAT_INNER(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT_INNER(a, b)
+//Profiles the rest of the enclosing scope
+#define PROFILE_ZONE(name) const dae::ProfileZone PROFILE_ZONE_CONCAT(profileZone, __LINE__){ name }
+#else
+#define PROFILE_ZONE(name)
+#endif
@@ -0,0 +1,194 @@
+#include "QuantizedBVH.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+#include "BVH.h"
+#include "ThreadPool.h"
+
+using namespace dae;
+
+namespace
+{
+	//Smallest step that still reaches maxValue from frameMin in 255 steps, checked with the same float math the traversal uses
+	int8_t FindExponent(float frameMin, float maxValue)
+	{
+		const float extent{ maxValue - frameMin };
+		int exponent{ QuantizedBVH::MinExponent };
+		if (extent > 0.f)
+			exponent = std::clamp(std::ilogb(extent / 255.f), QuantizedBVH::MinExponent, QuantizedBVH::MaxExponent);
+		while (exponent < QuantizedBVH::MaxExponent && frameMin + 255 * QuantizedBVH::ExponentToScale(static_cast<int8_t>(exponent)) < maxValue)
+			++exponent;
+		return static_cast<int8_t>(exponent);
+	}
+
+	//Rounds down, then steps back while the dequantized value would still cut into the box
+	uint8_t QuantizeMin(float value, float frameMin, float scale)
+	{
+		int step{ std::clamp(static_cast<int>(std::floor((value - frameMin) / scale)), 0, 255) };
+		while (step > 0 && frameMin + step * scale > value)
+			--step;
+		return static_cast<uint8_t>(step);
+	}
+
+	//Rounds up, then steps forward while the dequantized value would still cut into the box
+	uint8_t QuantizeMax(float value, float frameMin, float scale)
+	{
+		int step{ std::clamp(static_cast<int>(std::ceil((value - frameMin) / scale)), 0, 255) };
+		while (step < 255 && frameMin + step * scale < value)
+			++step;
+		return static_cast<uint8_t>(step);
+	}
+
+	//Quantizes the bounds of bvhChild in the frame of its parent, inner children also get the frame of their own children
+	//Returns the rounded minimum, the origin of that frame
+	Vector3 QuantizeChild(const BVHNode& bvhChild, const Vector3& frameMin, const Vector3& scale, QuantizedBVHChild& child)
+	{
+		child.minX = QuantizeMin(bvhChild.minAABB.x, frameMin.x, scale.x);
+		child.minY = QuantizeMin(bvhChild.minAABB.y, frameMin.y, scale.y);
+		child.minZ = QuantizeMin(bvhChild.minAABB.z, frameMin.z, scale.z);
+		child.maxX = QuantizeMax(bvhChild.maxAABB.x, frameMin.x, scale.x);
+		child.maxY = QuantizeMax(bvhChild.maxAABB.y, frameMin.y, scale.y);
+		child.maxZ = QuantizeMax(bvhChild.maxAABB.z, frameMin.z, scale.z);
+
+		//The frame of the grandchildren starts at the rounded minimum, the traversal only knows that one
+		Vector3 childMin{}, childMax{};
+		QuantizedBVH::GetChildAABB(child, frameMin, scale, childMin, childMax);
+		if (!bvhChild.IsLeaf())
+		{
+			child.exponentX = FindExponent(childMin.x, bvhChild.maxAABB.x);
+			child.exponentY = FindExponent(childMin.y, bvhChild.maxAABB.y);
+			child.exponentZ = FindExponent(childMin.z, bvhChild.maxAABB.z);
+		}
+		return childMin;
+	}
+}
+
+bool QuantizedBVH::Build(const BVH& bvh)
+{
+	Clear();
+	const std::vector<BVHNode>& bvhNodes{ bvh.GetNodes() };
+	if (bvhNodes.empty())
+		return true;
+
+	const BVHNode& root{ bvhNodes[0] };
+	SetRootFrame(root);
+	m_RootPrimitiveCount = root.primitiveCount;
+	m_RootLeftFirst = root.leftFirst;
+
+	//Every inner node of the BVH becomes one quantized node holding its children
+	m_Nodes.reserve(bvhNodes.size() / 2);
+	if (!root.IsLeaf() && !BuildNode(bvh, 0, m_RootMinAABB, m_RootScale, m_RootLeftFirst))
+	{
+		Clear();
+		return false;
+	}
+	if (root.primitiveCount > std::numeric_limits<uint16_t>::max())
+	{
+		Clear();
+		return false;
+	}
+
+	m_IsEmpty = false;
+	return true;
+}
+
+bool QuantizedBVH::BuildNode(const BVH& bvh, uint32_t bvhNodeIndex, const Vector3& frameMin, const Vector3& scale, uint32_t& nodeIndex)
+{
+	const std::vector<BVHNode>& bvhNodes{ bvh.GetNodes() };
+	nodeIndex = static_cast<uint32_t>(m_Nodes.size());
+	m_Nodes.emplace_back();
+
+	for (uint32_t childIndex{ 0 }; childIndex < 2; ++childIndex)
+	{
+		const uint32_t bvhChildIndex{ bvhNodes[bvhNodeIndex].leftFirst + childIndex };
+		const BVHNode& bvhChild{ bvhNodes[bvhChildIndex] };
+		if (bvhChild.primitiveCount > std::numeric_limits<uint16_t>::max())
+			return false;
+
+		QuantizedBVHChild child{};
+		const Vector3 childMin{ QuantizeChild(bvhChild, frameMin, scale, child) };
+		child.primitiveCount = static_cast<uint16_t>(bvhChild.primitiveCount);
+		child.leftFirst = bvhChild.leftFirst;
+
+		if (!bvhChild.IsLeaf() && !BuildNode(bvh, bvhChildIndex, childMin, GetChildScale(child), child.leftFirst))
+			return false;
+		m_Nodes[nodeIndex].children[childIndex] = child;
+	}
+	return true;
+}
+
+void QuantizedBVH::Refit(const BVH& bvh, ThreadPool* pThreadPool)
+{
+	if (m_IsEmpty)
+		return;
+
+	const BVHNode& root{ bvh.GetNodes()[0] };
+	SetRootFrame(root);
+	if (root.IsLeaf())
+		return;
+
+	if (!pThreadPool || pThreadPool->GetThreadCount() == 1 || m_Nodes.size() < BVH::MinParallelRefitNodes)
+	{
+		RefitNode(bvh, 0, m_RootMinAABB, m_RootScale, m_RootLeftFirst, 0, nullptr);
+		return;
+	}
+
+	//Frames flow from parents to children, so the top levels are requantized first and hand their subtrees to the pool
+	const int splitDepth{ static_cast<int>(std::bit_width(pThreadPool->GetThreadCount() * 4)) };
+	std::vector<RefitTask> subtrees{};
+	RefitNode(bvh, 0, m_RootMinAABB, m_RootScale, m_RootLeftFirst, splitDepth, &subtrees);
+	pThreadPool->ParallelFor(static_cast<uint32_t>(subtrees.size()), [&](uint32_t subtree, uint32_t)
+		{
+			const RefitTask& task{ subtrees[subtree] };
+			RefitNode(bvh, task.bvhNodeIndex, task.frameMin, task.scale, task.nodeIndex, 0, nullptr);
+		});
+}
+
+void QuantizedBVH::RefitNode(const BVH& bvh, uint32_t bvhNodeIndex, const Vector3& frameMin, const Vector3& scale, uint32_t nodeIndex,
+                             int splitDepth, std::vector<RefitTask>* pSubtrees)
+{
+	const std::vector<BVHNode>& bvhNodes{ bvh.GetNodes() };
+	for (uint32_t childIndex{ 0 }; childIndex < 2; ++childIndex)
+	{
+		const uint32_t bvhChildIndex{ bvhNodes[bvhNodeIndex].leftFirst + childIndex };
+		const BVHNode& bvhChild{ bvhNodes[bvhChildIndex] };
+		QuantizedBVHChild& child{ m_Nodes[nodeIndex].children[childIndex] };
+		const Vector3 childMin{ QuantizeChild(bvhChild, frameMin, scale, child) };
+		if (bvhChild.IsLeaf())
+			continue;
+
+		if (pSubtrees && splitDepth <= 1)
+			pSubtrees->push_back({ bvhChildIndex, child.leftFirst, childMin, GetChildScale(child) });
+		else
+			RefitNode(bvh, bvhChildIndex, childMin, GetChildScale(child), child.leftFirst, splitDepth - 1, pSubtrees);
+	}
+}
+
+void QuantizedBVH::SetRootFrame(const BVHNode& root)
+{
+	m_RootMinAABB = root.minAABB;
+	m_RootMaxAABB = root.maxAABB;
+	m_RootScale = Vector3{
+		ExponentToScale(FindExponent(root.minAABB.x, root.maxAABB.x)),
+		ExponentToScale(FindExponent(root.minAABB.y, root.maxAABB.y)),
+		ExponentToScale(FindExponent(root.minAABB.z, root.maxAABB.z)) };
+}
+
+void QuantizedBVH::Clear()
+{
+	m_Nodes.clear();
+	m_RootMinAABB = {};
+	m_RootMaxAABB = {};
+	m_RootScale = {};
+	m_RootLeftFirst = 0;
+	m_RootPrimitiveCount = 0;
+	m_IsEmpty = true;
+}
+
+size_t QuantizedBVH::GetMemoryUsage() const
+{
+	return m_Nodes.size() * sizeof(QuantizedBVHNode) + sizeof(Vector3) * 3 + sizeof(uint32_t) * 2;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include "Vector3.h"
+
+namespace dae
+{
+	class BVH;
+	struct BVHNode;
+	class ThreadPool;
+
+	//Child of a quantized node, 16 bytes so the two children of a node share one 32 byte line
+	struct QuantizedBVHChild
+	{
+		uint8_t minX, minY, minZ; //bounds in steps of the parent frame, rounded outwards so no hit is ever lost
+		uint8_t maxX, maxY, maxZ;
+		int8_t exponentX, exponentY, exponentZ; //frame of this child's own children: its dequantized minimum plus steps of 2^exponent
+		uint8_t padding;
+		uint16_t primitiveCount; //0 for inner nodes
+		uint32_t leftFirst; //inner: index of the node holding its children, leaf: index of the first primitive slot
+
+		bool IsLeaf() const { return primitiveCount > 0; }
+	};
+
+	//Both children of a binary BVH node, the node's own box is stored in its parent
+	struct alignas(32) QuantizedBVHNode
+	{
+		QuantizedBVHChild children[2];
+	};
+	static_assert(sizeof(QuantizedBVHNode) == 32);
+
+	/**
+	 * \brief Compressed copy of a BVH, child bounds are stored as 8 bit offsets in a frame spanned by their parent
+	 * Frames use power of two steps, so dequantizing is exact and the traversal reproduces the bounds the build rounded
+	 * Takes about half the memory of the BVH it was built from, the primitive slots are shared with it
+	 */
+	class QuantizedBVH final
+	{
+	public:
+		QuantizedBVH() = default;
+		~QuantizedBVH() = default;
+
+		//(Re)builds from bvh, false and empty if a leaf holds more primitives than a child can store
+		bool Build(const BVH& bvh);
+		/**
+		 * \brief Requantizes every child from a refit bvh in place, the binary topology must be unchanged since Build
+		 * \param pThreadPool if set, large trees requantize their lower subtrees in parallel
+		 */
+		void Refit(const BVH& bvh, ThreadPool* pThreadPool = nullptr);
+		void Clear();
+
+		bool IsEmpty() const { return m_IsEmpty; }
+		const std::vector<QuantizedBVHNode>& GetNodes() const { return m_Nodes; }
+		//Bytes of node data, the root box included
+		size_t GetMemoryUsage() const;
+
+		//The root keeps full precision and is the first frame
+		const Vector3& GetRootMinAABB() const { return m_RootMinAABB; }
+		const Vector3& GetRootMaxAABB() const { return m_RootMaxAABB; }
+		//Step of the root frame, 2^exponent per axis
+		const Vector3& GetRootScale() const { return m_RootScale; }
+		uint32_t GetRootLeftFirst() const { return m_RootLeftFirst; }
+		uint32_t GetRootPrimitiveCount() const { return m_RootPrimitiveCount; }
+
+		//Dequantized bounds of child, scale is the step of the frame it was quantized in
+		static void GetChildAABB(const QuantizedBVHChild& child, const Vector3& frameMin, const Vector3& scale, Vector3& minAABB, Vector3& maxAABB)
+		{
+			minAABB = Vector3{ frameMin.x + child.minX * scale.x, frameMin.y + child.minY * scale.y, frameMin.z + child.minZ * scale.z };
+			maxAABB = Vector3{ frameMin.x + child.maxX * scale.x, frameMin.y + child.maxY * scale.y, frameMin.z + child.maxZ * scale.z };
+		}
+		//Step of the frame child spans for its own children
+		static Vector3 GetChildScale(const QuantizedBVHChild& child)
+		{
+			return Vector3{ ExponentToScale(child.exponentX), ExponentToScale(child.exponentY), ExponentToScale(child.exponentZ) };
+		}
+		static float ExponentToScale(int8_t exponent)
+		{
+			return std::bit_cast<float>(static_cast<uint32_t>(exponent + 127) << 23);
+		}
+
+		static constexpr int MinExponent{ -100 }; //keeps the steps of flat frames out of the denormal range
+		static constexpr int MaxExponent{ 100 };
+
+	private:
+		std::vector<QuantizedBVHNode> m_Nodes{};
+		Vector3 m_RootMinAABB{};
+		Vector3 m_RootMaxAABB{};
+		Vector3 m_RootScale{};
+		uint32_t m_RootLeftFirst{};
+		uint32_t m_RootPrimitiveCount{};
+		bool m_IsEmpty{ true };
+
+		//Subtree a parallel Refit hands to the pool, with the frame its parent quantized it in
+		struct RefitTask
+		{
+			uint32_t bvhNodeIndex;
+			uint32_t nodeIndex;
+			Vector3 frameMin;
+			Vector3 scale;
+		};
+
+		bool BuildNode(const BVH& bvh, uint32_t bvhNodeIndex, const Vector3& frameMin, const Vector3& scale, uint32_t& nodeIndex);
+		//Requantizes the children of nodeIndex, inner children splitDepth levels down are queued in pSubtrees instead of refit when it is set
+		void RefitNode(const BVH& bvh, uint32_t bvhNodeIndex, const Vector3& frameMin, const Vector3& scale, uint32_t nodeIndex,
+		               int splitDepth, std::vector<RefitTask>* pSubtrees);
+		void SetRootFrame(const BVHNode& root);
+	};
+}
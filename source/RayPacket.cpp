@@ -0,0 +1,133 @@
+#include "RayPacket.h"
+
+#include <algorithm>
+
+#include "DataTypes.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define RAY_PACKET_SSE
+#include <immintrin.h>
+#endif
+
+namespace dae
+{
+	void RayPacket::SetDirection(int lane, const Vector3& direction)
+	{
+		directionX[lane] = direction.x;
+		directionY[lane] = direction.y;
+		directionZ[lane] = direction.z;
+		invDirectionX[lane] = 1.f / direction.x;
+		invDirectionY[lane] = 1.f / direction.y;
+		invDirectionZ[lane] = 1.f / direction.z;
+	}
+
+	Ray RayPacket::GetRay(int lane) const
+	{
+		Ray ray{ origin, GetDirection(lane) };
+		ray.min = min;
+		ray.max = max[lane];
+		return ray;
+	}
+
+	void RayPacket::UpdateFrustum()
+	{
+		const Vector3 corners[4]{
+			GetDirection(0),
+			GetDirection(RayPacketWidth - 1),
+			GetDirection(RayPacketSize - 1),
+			GetDirection(RayPacketSize - RayPacketWidth) };
+
+		centerDirection = corners[0] + corners[1] + corners[2] + corners[3];
+		for (int i{ 0 }; i < 4; ++i)
+		{
+			frustumNormals[i] = Vector3::Cross(corners[i], corners[(i + 1) % 4]);
+			if (Vector3::Dot(frustumNormals[i], centerDirection) < 0.f)
+				frustumNormals[i] = -frustumNormals[i];
+		}
+	}
+
+	void RayPacket::Transform(const Matrix& matrix, RayPacket& transformedPacket) const
+	{
+		transformedPacket.origin = matrix.TransformPoint(origin);
+		transformedPacket.min = min;
+		for (int lane{ 0 }; lane < RayPacketSize; ++lane)
+		{
+			transformedPacket.SetDirection(lane, matrix.TransformVector(directionX[lane], directionY[lane], directionZ[lane]));
+			transformedPacket.max[lane] = max[lane];
+		}
+		transformedPacket.UpdateFrustum();
+	}
+
+	bool RayPacket::FrustumTest_AABB(const Vector3& minAABB, const Vector3& maxAABB) const
+	{
+		for (const Vector3& normal : frustumNormals)
+		{
+			//Corner of the box furthest along the plane normal, if even that one is behind the plane the whole box is
+			const Vector3 corner{
+				normal.x > 0.f ? maxAABB.x : minAABB.x,
+				normal.y > 0.f ? maxAABB.y : minAABB.y,
+				normal.z > 0.f ? maxAABB.z : minAABB.z };
+			if (Vector3::Dot(normal, corner - origin) < 0.f)
+				return false;
+		}
+		return true;
+	}
+
+	RayPacketMask RayPacket::SlabTest_AABB(const Vector3& minAABB, const Vector3& maxAABB, RayPacketMask mask) const
+	{
+		RayPacketMask hitMask{ 0 };
+#if defined(RAY_PACKET_SSE)
+		const __m128 originX{ _mm_set1_ps(origin.x) };
+		const __m128 originY{ _mm_set1_ps(origin.y) };
+		const __m128 originZ{ _mm_set1_ps(origin.z) };
+		const __m128 minX{ _mm_sub_ps(_mm_set1_ps(minAABB.x), originX) };
+		const __m128 minY{ _mm_sub_ps(_mm_set1_ps(minAABB.y), originY) };
+		const __m128 minZ{ _mm_sub_ps(_mm_set1_ps(minAABB.z), originZ) };
+		const __m128 maxX{ _mm_sub_ps(_mm_set1_ps(maxAABB.x), originX) };
+		const __m128 maxY{ _mm_sub_ps(_mm_set1_ps(maxAABB.y), originY) };
+		const __m128 maxZ{ _mm_sub_ps(_mm_set1_ps(maxAABB.z), originZ) };
+		const __m128 rayMin{ _mm_set1_ps(min) };
+
+		for (int lane{ 0 }; lane < RayPacketSize; lane += 4)
+		{
+			if (((mask >> lane) & 0xF) == 0)
+				continue;
+
+			const __m128 invX{ _mm_load_ps(invDirectionX + lane) };
+			const __m128 invY{ _mm_load_ps(invDirectionY + lane) };
+			const __m128 invZ{ _mm_load_ps(invDirectionZ + lane) };
+
+			const __m128 tX1{ _mm_mul_ps(minX, invX) };
+			const __m128 tX2{ _mm_mul_ps(maxX, invX) };
+			const __m128 tY1{ _mm_mul_ps(minY, invY) };
+			const __m128 tY2{ _mm_mul_ps(maxY, invY) };
+			const __m128 tZ1{ _mm_mul_ps(minZ, invZ) };
+			const __m128 tZ2{ _mm_mul_ps(maxZ, invZ) };
+
+			const __m128 tMin{ _mm_max_ps(_mm_max_ps(_mm_min_ps(tX1, tX2), _mm_min_ps(tY1, tY2)), _mm_min_ps(tZ1, tZ2)) };
+			const __m128 tMax{ _mm_min_ps(_mm_min_ps(_mm_max_ps(tX1, tX2), _mm_max_ps(tY1, tY2)), _mm_max_ps(tZ1, tZ2)) };
+
+			__m128 hit{ _mm_cmpge_ps(tMax, tMin) };
+			hit = _mm_and_ps(hit, _mm_cmpgt_ps(tMax, rayMin));
+			hit = _mm_and_ps(hit, _mm_cmplt_ps(tMin, _mm_load_ps(max + lane)));
+			hitMask |= static_cast<RayPacketMask>(_mm_movemask_ps(hit)) << lane;
+		}
+#else
+		for (int lane{ 0 }; lane < RayPacketSize; ++lane)
+		{
+			const float tX1{ (minAABB.x - origin.x) * invDirectionX[lane] };
+			const float tX2{ (maxAABB.x - origin.x) * invDirectionX[lane] };
+			const float tY1{ (minAABB.y - origin.y) * invDirectionY[lane] };
+			const float tY2{ (maxAABB.y - origin.y) * invDirectionY[lane] };
+			const float tZ1{ (minAABB.z - origin.z) * invDirectionZ[lane] };
+			const float tZ2{ (maxAABB.z - origin.z) * invDirectionZ[lane] };
+
+			const float tMin{ std::max(std::max(std::min(tX1, tX2), std::min(tY1, tY2)), std::min(tZ1, tZ2)) };
+			const float tMax{ std::min(std::min(std::max(tX1, tX2), std::max(tY1, tY2)), std::max(tZ1, tZ2)) };
+			if (tMax >= tMin && tMax > min && tMin < max[lane])
+				hitMask |= RayPacketMask{ 1 } << lane;
+		}
+#endif
+		return hitMask & mask;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+
+#include "Vector3.h"
+
+namespace dae
+{
+	struct Ray;
+	struct Matrix;
+
+	constexpr int RayPacketWidth{ 8 }; //a packet covers an 8x8 pixel tile
+	constexpr int RayPacketSize{ RayPacketWidth * RayPacketWidth };
+	//Packets with fewer active rays than this in a subtree continue as single rays
+	constexpr int RayPacketDivergenceThreshold{ 8 };
+
+	using RayPacketMask = uint64_t; //one bit per lane
+
+	//Structure of arrays packet of coherent rays that share one origin, like the primary rays of a camera tile
+	//The shared origin makes the frustum spanned by the corner rays an exact bound of every ray in the packet
+	struct alignas(32) RayPacket
+	{
+		Vector3 origin{};
+		float min{ 0.0001f };
+
+		float directionX[RayPacketSize]{};
+		float directionY[RayPacketSize]{};
+		float directionZ[RayPacketSize]{};
+		float invDirectionX[RayPacketSize]{};
+		float invDirectionY[RayPacketSize]{};
+		float invDirectionZ[RayPacketSize]{};
+		float max[RayPacketSize]{};
+
+		Vector3 frustumNormals[4]{}; //inward facing side planes through the origin
+		Vector3 centerDirection{};
+
+		void SetDirection(int lane, const Vector3& direction);
+		Vector3 GetDirection(int lane) const { return { directionX[lane], directionY[lane], directionZ[lane] }; }
+		Ray GetRay(int lane) const;
+
+		//Recalculates the frustum from the corner lanes, call once all directions are set
+		void UpdateFrustum();
+		//Writes this packet with every lane transformed by matrix into transformedPacket, t values stay the same
+		void Transform(const Matrix& matrix, RayPacket& transformedPacket) const;
+
+		//False if the box lies completely outside the packet frustum
+		bool FrustumTest_AABB(const Vector3& minAABB, const Vector3& maxAABB) const;
+		//Lanes of mask whose ray enters the box before its max
+		RayPacketMask SlabTest_AABB(const Vector3& minAABB, const Vector3& maxAABB, RayPacketMask mask) const;
+	};
+}
@@ -0,0 +1,61 @@
+#include "RayStats.h"
+
+#include <deque>
+#include <mutex>
+
+using namespace dae;
+
+namespace
+{
+	//A deque never moves its elements, so the per-thread pointers stay valid while other threads register
+	std::mutex g_ThreadsMutex{};
+	std::deque<ThreadRayCounters> g_ThreadCounters{};
+}
+
+ThreadRayCounters* RayStats::RegisterThread()
+{
+	std::lock_guard lock{ g_ThreadsMutex };
+	return &g_ThreadCounters.emplace_back();
+}
+
+RayStatistics RayStats::GetThreadTotals()
+{
+	RayStatistics statistics{};
+	if (!t_pThreadCounters)
+		return statistics;
+
+	for (int i{ 0 }; i < NumRayCounters; ++i)
+	{
+		statistics.counts[i] = t_pThreadCounters->counts[i].load(std::memory_order_relaxed);
+	}
+	return statistics;
+}
+
+RayStatistics RayStats::GetTotals()
+{
+	RayStatistics statistics{};
+	std::lock_guard lock{ g_ThreadsMutex };
+	for (const ThreadRayCounters& threadCounters : g_ThreadCounters)
+	{
+		for (int i{ 0 }; i < NumRayCounters; ++i)
+		{
+			statistics.counts[i] += threadCounters.counts[i].load(std::memory_order_relaxed);
+		}
+	}
+	return statistics;
+}
+
+const char* RayStats::ToString(RayCounter counter)
+{
+	switch (counter)
+	{
+	case RayCounter::ClosestHitRays: return "closest hit rays";
+	case RayCounter::AnyHitRays: return "any hit rays";
+	case RayCounter::OccluderCacheHits: return "occluder cache hits";
+	case RayCounter::BVHNodeVisits: return "BVH node visits";
+	case RayCounter::TriangleTests: return "triangle tests";
+	case RayCounter::SphereTests: return "sphere tests";
+	case RayCounter::PlaneTests: return "plane tests";
+	default: return "unknown";
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace dae
+{
+	enum class RayCounter
+	{
+		ClosestHitRays, //Scene::GetClosestHit(s), one per ray
+		AnyHitRays, //Scene::DoesHit and Scene::IsOccluded, shadow rays
+		OccluderCacheHits, //shadow rays blocked by the cached occluder of their light, no traversal needed
+		BVHNodeVisits, //top and bottom level nodes, a packet visiting a node counts once
+		TriangleTests, //every lane of a tested triangle block, padding included
+		SphereTests,
+		PlaneTests,
+
+		//@END
+		Count
+	};
+	constexpr int NumRayCounters{ static_cast<int>(RayCounter::Count) };
+
+	//Snapshot of all counters, either summed over every thread or of a single thread
+	struct RayStatistics
+	{
+		uint64_t counts[NumRayCounters]{};
+
+		uint64_t operator[](RayCounter counter) const { return counts[static_cast<int>(counter)]; }
+
+		RayStatistics operator-(const RayStatistics& other) const
+		{
+			RayStatistics result{};
+			for (int i{ 0 }; i < NumRayCounters; ++i)
+			{
+				result.counts[i] = counts[i] - other.counts[i];
+			}
+			return result;
+		}
+
+		uint64_t GetRayCount() const
+		{
+			return (*this)[RayCounter::ClosestHitRays] + (*this)[RayCounter::AnyHitRays];
+		}
+
+		//Node visits plus primitive tests, the work the traversal did
+		uint64_t GetTraversalCost() const
+		{
+			return (*this)[RayCounter::BVHNodeVisits] + (*this)[RayCounter::TriangleTests] +
+				(*this)[RayCounter::SphereTests] + (*this)[RayCounter::PlaneTests];
+		}
+	};
+
+	//Counters of one thread, padded to a cache line so threads never write to the same line
+	struct alignas(64) ThreadRayCounters
+	{
+		//Only the owning thread writes, atomics just make reading them from the aggregating thread well defined
+		std::atomic<uint64_t> counts[NumRayCounters]{};
+	};
+
+	//Lock free ray statistics, every thread counts into its own ThreadRayCounters and the totals are only summed up when asked for
+	namespace RayStats
+	{
+		ThreadRayCounters* RegisterThread();
+
+		inline thread_local ThreadRayCounters* t_pThreadCounters{ nullptr };
+
+		inline void Add(RayCounter counter, uint64_t amount = 1)
+		{
+			if (!t_pThreadCounters)
+				t_pThreadCounters = RegisterThread();
+
+			//No other thread writes this counter, so a plain load and store is enough, no locked read-modify-write
+			std::atomic<uint64_t>& count{ t_pThreadCounters->counts[static_cast<int>(counter)] };
+			count.store(count.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+		}
+
+		//Counters of the calling thread since it started counting
+		RayStatistics GetThreadTotals();
+		//Counters of all threads summed up, counters only ever grow so the difference of two totals covers the work in between
+		RayStatistics GetTotals();
+
+		const char* ToString(RayCounter counter);
+	}
+}
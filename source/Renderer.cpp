@@ -1,173 +1,541 @@
-//External includes
-// ReSharper disable CppUnusedIncludeDirective
-#include "SDL.h"
-#include "SDL_surface.h"
-
 //Project includes
 #include "Renderer.h"
+#include "FrameSink.h"
 #include "Math.h"
 #include "Matrix.h"
 #include "Material.h"
 #include "Scene.h"
 #include "Utils.h"
+#include "RayPacket.h"
+
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "WavefrontShading.h"
 
-#include <thread>
-#include <mutex>
+#include <algorithm>
 #include <iostream>
-#include <ppl.h>
-#include <future>
 
 using namespace dae;
 
-//#define ASYNC
-#define PARALLEL_FOR
+namespace
+{
+	//Halton sequence element, index 0 gives 0
+	float RadicalInverse(uint32_t index, uint32_t base)
+	{
+		float result{ 0.f };
+		float digitWeight{ 1.f / base };
+		for (; index > 0; index /= base)
+		{
+			result += static_cast<float>(index % base) * digitWeight;
+			digitWeight /= base;
+		}
+		return result;
+	}
+
+	//Last occluder of every light for the calling thread, threads render whole tiles so consecutive shadow rays come from neighbouring pixels
+	std::vector<OccluderCache>& GetThreadOccluders(size_t numLights)
+	{
+		thread_local std::vector<OccluderCache> occluders{};
+		occluders.resize(numLights);
+		return occluders;
+	}
+}
 
-Renderer::Renderer(SDL_Window* pWindow) :
-	m_pWindow(pWindow),
-	m_pBuffer(SDL_GetWindowSurface(pWindow))
+Renderer::Renderer(int width, int height) :
+	m_Buffer(static_cast<size_t>(width) * static_cast<size_t>(height)),
+	m_AccumulationBuffer(static_cast<size_t>(width) * static_cast<size_t>(height) * 3),
+	m_CostBuffer(static_cast<size_t>(width) * static_cast<size_t>(height)),
+	m_Width(width),
+	m_Height(height)
 {
 	//Initialize
-	SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
-	m_pBufferPixels = static_cast<uint32_t*>(m_pBuffer->pixels);
+	m_pBufferPixels = m_Buffer.data();
+	m_pAccumulationRed = m_AccumulationBuffer.data();
+	m_pAccumulationGreen = m_pAccumulationRed + m_Buffer.size();
+	m_pAccumulationBlue = m_pAccumulationGreen + m_Buffer.size();
+	m_pCostPixels = m_CostBuffer.data();
 	m_AspectRatio = static_cast<float>(m_Width) / static_cast<float>(m_Height);
+
+	m_pThreadPool = std::make_unique<ThreadPool>();
+	m_pShadePixel = SelectShadePixel(m_CurrentLightingMode, m_ShadowsEnabled, MaterialSet::Any);
 }
 
-void Renderer::Render(Scene* pScene) const
+Renderer::~Renderer() = default;
+
+void Renderer::Render(Scene* pScene)
 {
-	Camera& camera = pScene->GetCamera();
-	Matrix cameraToWorld{ camera.CalculateCameraToWorld() };
+	PROFILE_ZONE("Renderer::Render");
+	const RayStatistics startStatistics{ RayStats::GetTotals() };
+
+	{
+		PROFILE_ZONE("Scene::UpdateAccelerationStructure");
+		pScene->UpdateAccelerationStructure(m_pThreadPool.get());
+	}
 
-	auto& materials = pScene->GetMaterials();
-	auto& lights = pScene->GetLights();
+	//Samples only add up while nothing that shows in the image has changed, any change restarts from one sample
+	const bool hasSceneChanged{ pScene->ConsumeChanges() };
+	if (!m_ProgressiveEnabled || hasSceneChanged || !m_IsAccumulationValid || m_CurrentLightingMode == LightingMode::TraversalCost)
+		m_NumAccumulatedSamples = 0;
+	m_IsAccumulationValid = true;
 
+	//A converged image is not traced any further, it is still resolved so tone mapping changes show up
+	if (m_NumAccumulatedSamples >= MaxProgressiveSamples)
+	{
+		m_FrameStatistics = {};
+		PROFILE_ZONE("Renderer::ResolveBuffer");
+		ResolveBuffer();
+	}
+	else
+	{
+		//The first sample goes through the pixel centers, later ones are spread over the pixel by a Halton sequence
+		m_SampleOffsetX = m_NumAccumulatedSamples == 0 ? .5f : RadicalInverse(m_NumAccumulatedSamples, 2);
+		m_SampleOffsetY = m_NumAccumulatedSamples == 0 ? .5f : RadicalInverse(m_NumAccumulatedSamples, 3);
 
-	const uint32_t numPixels{ static_cast<uint32_t>(m_Width) * static_cast<uint32_t>(m_Height) };
+		Camera& camera = pScene->GetCamera();
+		Matrix cameraToWorld{ camera.CalculateCameraToWorld() };
 
-#if defined(ASYNC)
-	const uint32_t numCores{ std::thread::hardware_concurrency() };
-	std::vector<std::future<void>> async_futures{};
+		auto& materials = pScene->GetMaterials();
+		auto& lights = pScene->GetLights();
+		m_pShadePixel = SelectShadePixel(m_CurrentLightingMode, m_ShadowsEnabled, pScene->UsesOnlyConstantBRDFs() ? MaterialSet::Constant : MaterialSet::Any);
 
-	const uint32_t numPixelPerTask{ numPixels / numCores };
-	uint32_t numAssignedPixels{ numPixels % numCores };
-	uint32_t currentPixelIndex{ 0 };
+		//Screen tiles are handed out by the work stealing pool, so clusters of expensive pixels get spread over all threads
+		const uint32_t numTilesX{ static_cast<uint32_t>((m_Width + m_TileSize - 1) / m_TileSize) };
+		const uint32_t numTilesY{ static_cast<uint32_t>((m_Height + m_TileSize - 1) / m_TileSize) };
+		m_pThreadPool->ParallelFor(numTilesX * numTilesY, [&](uint32_t tileIndex, uint32_t)
+			{
+				PROFILE_ZONE("Tile");
+				const int tileX{ static_cast<int>(tileIndex % numTilesX) * m_TileSize };
+				const int tileY{ static_cast<int>(tileIndex / numTilesX) * m_TileSize };
+				RenderTile(pScene, tileX, tileY, camera, cameraToWorld, lights, materials);
+			});
+		m_FrameStatistics = RayStats::GetTotals() - startStatistics;
+		++m_NumAccumulatedSamples;
 
-	for (uint32_t coreId{ 0 }; coreId < numCores; ++coreId)
+		if (m_CurrentLightingMode == LightingMode::TraversalCost)
+		{
+			ShadeTraversalCost();
+		}
+		else
+		{
+			PROFILE_ZONE("Renderer::ResolveBuffer");
+			ResolveBuffer();
+		}
+	}
+
+	//@END
+	//Present
+	if (m_pFrameSink)
 	{
-		uint32_t taskSize{ numPixelPerTask };
-		if (numAssignedPixels > 0)
+		PROFILE_ZONE("FrameSink::Present");
+		m_pFrameSink->Present(m_pBufferPixels, m_Width, m_Height);
+	}
+}
+
+bool Renderer::SaveBufferToImage(const std::string& path) const
+{
+	return SaveImage(m_pBufferPixels, m_Width, m_Height, path);
+}
+
+void Renderer::RenderPixel(const Scene* pScene, const int pixelIndex, const float aspectRatio, const Camera& camera,
+                           const Matrix cameraToWorld, const std::vector<Light>& lights, const MaterialTable& materials) const
+{
+	const int px{ pixelIndex % m_Width };
+	const int py{ pixelIndex / m_Width };
+	
+	const float directionX{ (2.f * ((px + m_SampleOffsetX) / m_Width) - 1) * aspectRatio * camera.fovRadians };
+	const float directionY{ (1.f - 2.f * ((py + m_SampleOffsetY) / m_Height)) * camera.fovRadians };
+	
+	const Vector3 rayDirection{ cameraToWorld.TransformVector(directionX, directionY, 1.f) };
+	const Ray hitRay{ camera.origin, rayDirection };
+	HitRecord hitRecord{};
+	
+	const uint64_t startCost{ RayStats::GetThreadTotals().GetTraversalCost() };
+	pScene->GetClosestHit(hitRay, hitRecord);
+	(this->*m_pShadePixel)(pScene, px, py, rayDirection, hitRecord, lights, materials);
+
+	//The counters of this thread only grow by the work done for this pixel in between
+	if (m_CurrentLightingMode == LightingMode::TraversalCost)
+		m_pCostPixels[pixelIndex] = static_cast<uint32_t>(RayStats::GetThreadTotals().GetTraversalCost() - startCost);
+}
+
+void Renderer::RenderTile(const Scene* pScene, int tileX, int tileY, const Camera& camera,
+                          const Matrix cameraToWorld, const std::vector<Light>& lights, const MaterialTable& materials) const
+{
+	if (m_WavefrontShadingEnabled && m_CurrentLightingMode == LightingMode::Combined)
+	{
+		RenderTileWavefront(pScene, tileX, tileY, camera, cameraToWorld, lights, materials);
+		return;
+	}
+
+	const int endX{ std::min(tileX + m_TileSize, m_Width) };
+	const int endY{ std::min(tileY + m_TileSize, m_Height) };
+
+	//Packets share their node visits, the heatmap needs the cost of every ray on its own
+	if (m_PacketTracingEnabled && m_CurrentLightingMode != LightingMode::TraversalCost)
+	{
+		//The tile size is a multiple of the packet width, so packets never cross a tile border
+		for (int py{ tileY }; py < endY; py += RayPacketWidth)
 		{
-			++taskSize;
-			--numAssignedPixels;
+			for (int px{ tileX }; px < endX; px += RayPacketWidth)
+			{
+				RenderPacket(pScene, px, py, camera, cameraToWorld, lights, materials);
+			}
 		}
+		return;
+	}
+
+	for (int py{ tileY }; py < endY; ++py)
+	{
+		for (int px{ tileX }; px < endX; ++px)
+		{
+			RenderPixel(pScene, px + py * m_Width, m_AspectRatio, camera, cameraToWorld, lights, materials);
+		}
+	}
+}
+
+void Renderer::RenderPacket(const Scene* pScene, int packetX, int packetY, const Camera& camera,
+                            const Matrix cameraToWorld, const std::vector<Light>& lights, const MaterialTable& materials) const
+{
+	RayPacket packet;
+	const RayPacketMask mask{ GeneratePrimaryPacket(packetX, packetY, camera, cameraToWorld, packet) };
+
+	HitRecord hitRecords[RayPacketSize]{};
+	{
+		PROFILE_ZONE("Trace");
+		pScene->GetClosestHits(packet, mask, hitRecords);
+	}
+
+	PROFILE_ZONE("Shade");
+	for (RayPacketMask remaining{ mask }; remaining != 0; remaining &= remaining - 1)
+	{
+		const int lane{ std::countr_zero(remaining) };
+		(this->*m_pShadePixel)(pScene, packetX + lane % RayPacketWidth, packetY + lane / RayPacketWidth, packet.GetDirection(lane), hitRecords[lane], lights, materials);
+	}
+}
+
+void Renderer::RenderTileWavefront(const Scene* pScene, int tileX, int tileY, const Camera& camera,
+                                   const Matrix cameraToWorld, const std::vector<Light>& lights, const MaterialTable& materials) const
+{
+	const int tileWidth{ std::min(m_TileSize, m_Width - tileX) };
+	const int tileHeight{ std::min(m_TileSize, m_Height - tileY) };
+	const int numPixels{ tileWidth * tileHeight };
+
+	//Reused by every tile this thread renders
+	thread_local std::vector<HitRecord> hitRecords{};
+	thread_local std::vector<Vector3> viewDirections{};
+	thread_local std::vector<ColorRGB> colors{};
+	thread_local ShadingQueue shadingQueue{};
+	hitRecords.assign(numPixels, HitRecord{});
+	viewDirections.resize(numPixels);
+	colors.assign(numPixels, ColorRGB{});
+	shadingQueue.Clear();
 
-		async_futures.push_back(
-			std::async(std::launch::async, [=, this]
+	//Stage 1: primary rays of the whole tile
+	{
+		PROFILE_ZONE("Trace");
+		if (m_PacketTracingEnabled)
+		{
+			HitRecord packetHits[RayPacketSize];
+			for (int packetY{ 0 }; packetY < tileHeight; packetY += RayPacketWidth)
+			{
+				for (int packetX{ 0 }; packetX < tileWidth; packetX += RayPacketWidth)
 				{
-					const uint32_t endPixelIndex{ currentPixelIndex + taskSize };
-					for (uint32_t pixelIndex{ currentPixelIndex }; pixelIndex < endPixelIndex; ++pixelIndex)
+					RayPacket packet;
+					const RayPacketMask mask{ GeneratePrimaryPacket(tileX + packetX, tileY + packetY, camera, cameraToWorld, packet) };
+					std::fill(std::begin(packetHits), std::end(packetHits), HitRecord{});
+					pScene->GetClosestHits(packet, mask, packetHits);
+
+					for (RayPacketMask remaining{ mask }; remaining != 0; remaining &= remaining - 1)
 					{
-						RenderPixel(pScene, pixelIndex, aspectRatio, camera, cameraToWorld, lights, materials);
+						const int lane{ std::countr_zero(remaining) };
+						const int pixel{ packetX + lane % RayPacketWidth + (packetY + lane / RayPacketWidth) * tileWidth };
+						hitRecords[pixel] = packetHits[lane];
+						viewDirections[pixel] = -packet.GetDirection(lane).Normalized();
 					}
-				})
-		);
+				}
+			}
+		}
+		else
+		{
+			for (int pixel{ 0 }; pixel < numPixels; ++pixel)
+			{
+				const int px{ tileX + pixel % tileWidth };
+				const int py{ tileY + pixel / tileWidth };
+				const float directionX{ (2.f * ((px + m_SampleOffsetX) / m_Width) - 1) * m_AspectRatio * camera.fovRadians };
+				const float directionY{ (1.f - 2.f * ((py + m_SampleOffsetY) / m_Height)) * camera.fovRadians };
+				const Vector3 rayDirection{ cameraToWorld.TransformVector(directionX, directionY, 1.f) };
 
-		currentPixelIndex += taskSize;
+				pScene->GetClosestHit(Ray{ camera.origin, rayDirection }, hitRecords[pixel]);
+				viewDirections[pixel] = -rayDirection.Normalized();
+			}
+		}
 	}
 
-	//wait until all tasks are finished
-	for (const std::future<void>& f : async_futures)
+	//Stage 2: shadow rays, every light that reaches a hit is queued under the material type of the hit
 	{
-		f.wait();
+		PROFILE_ZONE("Shadows");
+		std::vector<OccluderCache>& occluders{ GetThreadOccluders(lights.size()) };
+		for (int pixel{ 0 }; pixel < numPixels; ++pixel)
+		{
+			const HitRecord& hitRecord{ hitRecords[pixel] };
+			if (!hitRecord.didHit)
+				continue;
+
+			for (size_t lightIndex{ 0 }; lightIndex < lights.size(); ++lightIndex)
+			{
+				const Light& currentLight{ lights[lightIndex] };
+				ShadingSample sample{};
+				float lambertCos{};
+				const bool isLit{ m_ShadowsEnabled ?
+					IsLit<true>(pScene, hitRecord, currentLight, occluders[lightIndex], sample.l, lambertCos) :
+					IsLit<false>(pScene, hitRecord, currentLight, occluders[lightIndex], sample.l, lambertCos) };
+				if (!isLit)
+					continue;
+
+				sample.v = viewDirections[pixel];
+				sample.normal = hitRecord.normal;
+				sample.irradiance = LightUtils::GetRadiance(currentLight, hitRecord.origin) * lambertCos;
+				sample.colorIndex = static_cast<uint32_t>(pixel);
+				shadingQueue.Add(hitRecord.material, sample);
+			}
+		}
 	}
 
-#elif defined(PARALLEL_FOR)
-	concurrency::parallel_for(0u, numPixels, [=, this](int pixelIndex)
-		{
-			RenderPixel(pScene, pixelIndex, m_AspectRatio, camera, cameraToWorld, lights, materials);
-		});
-#else
-	for (uint32_t i{ 0 }; i < numPixels; ++i)
+	//Stage 3: one BRDF kernel per material type
 	{
-		RenderPixel(pScene, i, aspectRatio, camera, cameraToWorld, lights, materials);
+		PROFILE_ZONE("Shade");
+		shadingQueue.Shade(materials, colors.data());
 	}
 
-#endif
+	for (int pixel{ 0 }; pixel < numPixels; ++pixel)
+	{
+		WritePixel(tileX + pixel % tileWidth + (tileY + pixel / tileWidth) * m_Width, colors[pixel]);
+	}
+}
 
-	//@END
-	//Update SDL Surface
-	SDL_UpdateWindowSurface(m_pWindow);
+RayPacketMask Renderer::GeneratePrimaryPacket(int packetX, int packetY, const Camera& camera, const Matrix& cameraToWorld, RayPacket& packet) const
+{
+	//Primary rays all start at the camera, lanes outside the screen are still generated so the corner rays bound the frustum
+	packet.origin = camera.origin;
+	RayPacketMask mask{ 0 };
+	for (int lane{ 0 }; lane < RayPacketSize; ++lane)
+	{
+		const int px{ packetX + lane % RayPacketWidth };
+		const int py{ packetY + lane / RayPacketWidth };
+
+		const float directionX{ (2.f * ((px + m_SampleOffsetX) / m_Width) - 1) * m_AspectRatio * camera.fovRadians };
+		const float directionY{ (1.f - 2.f * ((py + m_SampleOffsetY) / m_Height)) * camera.fovRadians };
+		packet.SetDirection(lane, cameraToWorld.TransformVector(directionX, directionY, 1.f));
+		packet.max[lane] = FLT_MAX;
+
+		if (px < m_Width && py < m_Height)
+			mask |= RayPacketMask{ 1 } << lane;
+	}
+	packet.UpdateFrustum();
+	return mask;
 }
 
-bool Renderer::SaveBufferToImage() const
+template<bool Shadows>
+bool Renderer::IsLit(const Scene* pScene, const HitRecord& hitRecord, const Light& light, OccluderCache& occluder,
+                     Vector3& directionToLight, float& lambertCos) const
 {
-	return SDL_SaveBMP(m_pBuffer, "RayTracing_Buffer.bmp");
+	const Vector3 toLight{ LightUtils::GetDirectionToLight(light, hitRecord.origin) };
+	const Vector3 directionNormalized{ toLight.Normalized() };
+	Ray rayToLight{ hitRecord.origin, directionNormalized };
+	rayToLight.min = 0.01f;
+	rayToLight.max = toLight.Magnitude();
+	rayToLight.castsShadow = true;
+
+	if constexpr (Shadows)
+	{
+		if (pScene->IsOccluded(rayToLight, occluder))
+			return false;
+	}
+
+	lambertCos = Vector3::Dot(hitRecord.normal, directionNormalized);
+	if (lambertCos < 0)
+		return false;
+
+	directionToLight = directionNormalized;
+	return true;
 }
 
-void Renderer::RenderPixel(const Scene* pScene, const int pixelIndex, const float aspectRatio, const Camera& camera,
-                           const Matrix cameraToWorld, const std::vector<Light>& lights, const std::vector<Material*>& materials) const
+Renderer::ShadePixelFunction Renderer::SelectShadePixel(LightingMode lightingMode, bool shadowsEnabled, MaterialSet materialSet)
 {
-	const int px{ pixelIndex % m_Width };
-	const int py{ pixelIndex / m_Width };
-	
-	const float directionX{ (2.f * ((px + 0.5f) / m_Width) - 1) * aspectRatio * camera.fovRadians };
-	const float directionY{ (1.f - 2.f * ((py + .5f) / m_Height)) * camera.fovRadians };
-	
-	const Vector3 rayDirection{ cameraToWorld.TransformVector(directionX, directionY, 1.f) };
-	const Ray hitRay{ camera.origin, rayDirection };
-	HitRecord hitRecord{};
-	
-	pScene->GetClosestHit(hitRay, hitRecord);
-	
+	const auto select{ [=]<LightingMode Mode>() -> ShadePixelFunction
+		{
+			//Only the modes that evaluate the BRDF get a constant material variant
+			if constexpr (Mode == LightingMode::BRDF || Mode == LightingMode::Combined)
+			{
+				if (materialSet == MaterialSet::Constant)
+				{
+					return shadowsEnabled ?
+						&Renderer::ShadePixel<Mode, true, MaterialSet::Constant> :
+						&Renderer::ShadePixel<Mode, false, MaterialSet::Constant>;
+				}
+			}
+			return shadowsEnabled ?
+				&Renderer::ShadePixel<Mode, true, MaterialSet::Any> :
+				&Renderer::ShadePixel<Mode, false, MaterialSet::Any>;
+		} };
+
+	switch (lightingMode)
+	{
+	case LightingMode::ObservedArea:
+		return select.template operator()<LightingMode::ObservedArea>();
+	case LightingMode::Radiance:
+		return select.template operator()<LightingMode::Radiance>();
+	case LightingMode::BRDF:
+		return select.template operator()<LightingMode::BRDF>();
+	case LightingMode::Combined:
+		return select.template operator()<LightingMode::Combined>();
+	case LightingMode::TraversalCost:
+		return select.template operator()<LightingMode::TraversalCost>();
+	}
+	return nullptr;
+}
+
+template<Renderer::LightingMode Mode, bool Shadows, Renderer::MaterialSet Materials>
+void Renderer::ShadePixel(const Scene* pScene, int px, int py, const Vector3& rayDirection, const HitRecord& hitRecord,
+                          const std::vector<Light>& lights, const MaterialTable& materials) const
+{
+	constexpr bool needsBRDF{ Mode == LightingMode::BRDF || Mode == LightingMode::Combined };
+
 	ColorRGB finalColor{};
 	if (hitRecord.didHit)
 	{
-		Ray rayToLight{};
-		for (const auto& currentLight : lights)
+		//A constant BRDF is looked up once per pixel, otherwise only the view direction is shared by all lights
+		ColorRGB constantBRDF{};
+		Vector3 viewDirection{};
+		if constexpr (needsBRDF && Materials == MaterialSet::Constant)
+			constantBRDF = materials.ShadeConstant(hitRecord.material);
+		else if constexpr (needsBRDF)
+			viewDirection = -rayDirection.Normalized();
+
+		std::vector<OccluderCache>& occluders{ GetThreadOccluders(lights.size()) };
+		for (size_t lightIndex{ 0 }; lightIndex < lights.size(); ++lightIndex)
 		{
-			Vector3 directionToLight{ LightUtils::GetDirectionToLight(currentLight, hitRecord.origin) };
-			Vector3 directionNormalized{ directionToLight.Normalized() };
-			rayToLight = { hitRecord.origin, directionNormalized };
-			rayToLight.min = 0.01f;
-			rayToLight.max = directionToLight.Magnitude();
-			rayToLight.castsShadow = true;
-	
-			if (m_ShadowsEnabled && pScene->DoesHit(rayToLight))
-				continue;
-	
-			const float lambertCos{ Vector3::Dot(hitRecord.normal, directionNormalized) };
-			if (lambertCos < 0)
+			const Light& currentLight{ lights[lightIndex] };
+			Vector3 directionNormalized{};
+			float lambertCos{};
+			if (!IsLit<Shadows>(pScene, hitRecord, currentLight, occluders[lightIndex], directionNormalized, lambertCos))
 				continue;
-	
-			switch (m_CurrentLightingMode)
+
+			if constexpr (Mode == LightingMode::ObservedArea)
+			{
+				finalColor += ColorRGB({ 1.f, 1.f, 1.f }) * lambertCos;
+			}
+			else if constexpr (Mode == LightingMode::Radiance)
 			{
-			case LightingMode::ObservedArea:
-				finalColor += ColorRGB({1.f, 1.f, 1.f}) * lambertCos;
-				break;
-			case LightingMode::Radiance:
 				finalColor += LightUtils::GetRadiance(currentLight, hitRecord.origin);
-				break;
-			case LightingMode::BRDF:
-				finalColor += materials[hitRecord.materialIndex]->Shade(hitRecord, directionNormalized, -rayDirection.Normalized());
-				break;
-			case LightingMode::Combined:
-				finalColor += LightUtils::GetRadiance(currentLight, hitRecord.origin) * lambertCos *
-					materials[hitRecord.materialIndex]->Shade(hitRecord, directionNormalized, -rayDirection.Normalized());
-				break;
 			}
+			else if constexpr (needsBRDF)
+			{
+				ColorRGB brdf{ constantBRDF };
+				if constexpr (Materials == MaterialSet::Any)
+					brdf = materials.Shade(hitRecord.material, hitRecord, directionNormalized, viewDirection);
+
+				if constexpr (Mode == LightingMode::BRDF)
+					finalColor += brdf;
+				else
+					finalColor += LightUtils::GetRadiance(currentLight, hitRecord.origin) * lambertCos * brdf;
+			}
+			//TraversalCost: only the shadow rays matter, ShadeTraversalCost colors the pixel afterwards
 		}
 	}
-	
-	//Update Color in Buffer
-	finalColor.MaxToOne();
-	
-	m_pBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBuffer->format,
-		static_cast<uint8_t>(finalColor.r * 255),
-		static_cast<uint8_t>(finalColor.g * 255),
-		static_cast<uint8_t>(finalColor.b * 255));
+
+	WritePixel(px + (py * m_Width), finalColor);
+}
+
+void Renderer::WritePixel(int pixelIndex, const ColorRGB& color) const
+{
+	if (m_NumAccumulatedSamples == 0)
+	{
+		m_pAccumulationRed[pixelIndex] = color.r;
+		m_pAccumulationGreen[pixelIndex] = color.g;
+		m_pAccumulationBlue[pixelIndex] = color.b;
+	}
+	else
+	{
+		m_pAccumulationRed[pixelIndex] += color.r;
+		m_pAccumulationGreen[pixelIndex] += color.g;
+		m_pAccumulationBlue[pixelIndex] += color.b;
+	}
+}
+
+void Renderer::ResolveBuffer()
+{
+	//Chunks of whole rows, big enough that scheduling them costs nothing next to the pass itself
+	constexpr int rowsPerChunk{ 16 };
+	const uint32_t numChunks{ static_cast<uint32_t>((m_Height + rowsPerChunk - 1) / rowsPerChunk) };
+	const float sampleScale{ 1.f / static_cast<float>(m_NumAccumulatedSamples) };
+	m_pThreadPool->ParallelFor(numChunks, [&](uint32_t chunkIndex, uint32_t)
+		{
+			const size_t firstPixel{ static_cast<size_t>(chunkIndex) * rowsPerChunk * m_Width };
+			const size_t numPixels{ std::min(static_cast<size_t>(rowsPerChunk * m_Width), m_Buffer.size() - firstPixel) };
+			ToneMapping::Resolve(m_pAccumulationRed + firstPixel, m_pAccumulationGreen + firstPixel, m_pAccumulationBlue + firstPixel,
+				numPixels, sampleScale, m_ToneMapping, m_pBufferPixels + firstPixel);
+		});
+}
+
+void Renderer::ShadeTraversalCost()
+{
+	const uint32_t maxCost{ std::max(1u, *std::max_element(m_CostBuffer.begin(), m_CostBuffer.end())) };
+
+	//Blue - cyan - green - yellow - red
+	const ColorRGB ramp[]{ { 0.f, 0.f, 1.f }, { 0.f, 1.f, 1.f }, { 0.f, 1.f, 0.f }, { 1.f, 1.f, 0.f }, { 1.f, 0.f, 0.f } };
+	constexpr int numSegments{ static_cast<int>(std::size(ramp)) - 1 };
+
+	for (size_t i{ 0 }; i < m_CostBuffer.size(); ++i)
+	{
+		const float position{ static_cast<float>(m_CostBuffer[i]) / static_cast<float>(maxCost) * numSegments };
+		const int segment{ std::min(static_cast<int>(position), numSegments - 1) };
+		const float weight{ position - static_cast<float>(segment) };
+		const ColorRGB color{ ramp[segment] * (1.f - weight) + ramp[segment + 1] * weight };
+
+		m_pBufferPixels[i] = 0xFF000000u |
+			static_cast<uint32_t>(static_cast<uint8_t>(color.r * 255)) << 16 |
+			static_cast<uint32_t>(static_cast<uint8_t>(color.g * 255)) << 8 |
+			static_cast<uint32_t>(static_cast<uint8_t>(color.b * 255));
+	}
+}
+
+void Renderer::SetThreadCount(uint32_t numThreads)
+{
+	m_pThreadPool = std::make_unique<ThreadPool>(numThreads);
+}
+
+uint32_t Renderer::GetThreadCount() const
+{
+	return m_pThreadPool->GetThreadCount();
+}
+
+void Renderer::SetTileSize(int tileSize)
+{
+	//Rounded up to whole ray packets
+	const int numPackets{ std::max(1, (tileSize + RayPacketWidth - 1) / RayPacketWidth) };
+	m_TileSize = numPackets * RayPacketWidth;
+}
+
+void Renderer::CycleToneMapper()
+{
+	switch (m_ToneMapping.toneMapper)
+	{
+	case ToneMapper::Clamp:
+		m_ToneMapping.toneMapper = ToneMapper::Reinhard;
+		break;
+	case ToneMapper::Reinhard:
+		m_ToneMapping.toneMapper = ToneMapper::ACES;
+		break;
+	case ToneMapper::ACES:
+		m_ToneMapping.toneMapper = ToneMapper::Clamp;
+		break;
+	}
 }
 
 void Renderer::CycleLightingMode()
 {
+	m_IsAccumulationValid = false;
 	switch (m_CurrentLightingMode)
 	{
 	case LightingMode::ObservedArea:
@@ -180,6 +548,9 @@ void Renderer::CycleLightingMode()
 		m_CurrentLightingMode = LightingMode::Combined;
 		break;
 	case LightingMode::Combined:
+		m_CurrentLightingMode = LightingMode::TraversalCost;
+		break;
+	case LightingMode::TraversalCost:
 		m_CurrentLightingMode = LightingMode::ObservedArea;
 		break;
 	default:
@@ -1,39 +1,80 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
-struct SDL_Window;
-struct SDL_Surface;
+#include "RayPacket.h"
+#include "RayStats.h"
+#include "ToneMapping.h"
 
 namespace dae
 {
 	class Scene;
 	struct Camera;
 	struct Light;
-	class Material;
+	class MaterialTable;
 	struct Matrix;
+	struct Vector3;
+	struct HitRecord;
+	struct OccluderCache;
+	struct ColorRGB;
+	class ThreadPool;
+	class FrameSink;
 
 	class Renderer final
 	{
 	public:
-		Renderer(SDL_Window* pWindow);
-		~Renderer() = default;
+		Renderer(int width, int height);
+		~Renderer();
 
 		Renderer(const Renderer&) = delete;
 		Renderer(Renderer&&) noexcept = delete;
 		Renderer& operator=(const Renderer&) = delete;
 		Renderer& operator=(Renderer&&) noexcept = delete;
 
-		void Render(Scene* pScene) const;
-		bool SaveBufferToImage() const;
+		//Renders a frame into the framebuffer and hands it to the frame sink, if there is one
+		void Render(Scene* pScene);
+		//Returns 0 on success, like SDL_SaveBMP
+		bool SaveBufferToImage(const std::string& path = "RayTracing_Buffer.bmp") const;
+
+		//Optional output for finished frames (window, image files, ...), the sink is not owned
+		void SetFrameSink(FrameSink* pFrameSink) { m_pFrameSink = pFrameSink; }
+		//Framebuffer of the last frame, one 0xAARRGGBB pixel per entry, row by row
+		const std::vector<uint32_t>& GetBuffer() const { return m_Buffer; }
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
+		//Rays, node visits and primitive tests of the last Render, summed over all threads
+		const RayStatistics& GetFrameStatistics() const { return m_FrameStatistics; }
 		void RenderPixel(const Scene* pScene, int pixelIndex, float aspectRatio, const Camera& camera,
-		                 Matrix cameraToWorld, const std::vector<Light>& lights, const std::vector<Material*>& materials) const;
+		                 Matrix cameraToWorld, const std::vector<Light>& lights, const MaterialTable& materials) const;
+		//Renders the screen tile starting at pixel (tileX, tileY), one task of the thread pool
+		void RenderTile(const Scene* pScene, int tileX, int tileY, const Camera& camera,
+		                Matrix cameraToWorld, const std::vector<Light>& lights, const MaterialTable& materials) const;
+		//Renders the 8x8 pixels starting at (packetX, packetY), their primary rays are traced together as one RayPacket
+		void RenderPacket(const Scene* pScene, int packetX, int packetY, const Camera& camera,
+		                  Matrix cameraToWorld, const std::vector<Light>& lights, const MaterialTable& materials) const;
+		/**
+		 * \brief Renders a tile in stages instead of pixel by pixel: trace all primary rays of the tile, trace the shadow rays
+		 * and queue every lit light sample by material type, then evaluate each material type with one batched BRDF kernel
+		 * Only used for LightingMode::Combined, the result matches ShadePixel within float rounding
+		 */
+		void RenderTileWavefront(const Scene* pScene, int tileX, int tileY, const Camera& camera,
+		                         Matrix cameraToWorld, const std::vector<Light>& lights, const MaterialTable& materials) const;
+
+		//Recreates the worker pool, 0 uses one thread per hardware thread
+		void SetThreadCount(uint32_t numThreads);
+		uint32_t GetThreadCount() const;
+		//Width and height of the tiles the screen is split into, rounded up to a multiple of the ray packet width
+		void SetTileSize(int tileSize);
+		int GetTileSize() const { return m_TileSize; }
 
 		void CycleLightingMode();
 		void ToggleShadows()
 		{
 			m_ShadowsEnabled = !m_ShadowsEnabled;
+			m_IsAccumulationValid = false;
 		}
 
 		void ToggleEditMode()
@@ -41,6 +82,35 @@ namespace dae
 			m_EditMode = !m_EditMode;
 		}
 
+		void TogglePacketTracing()
+		{
+			m_PacketTracingEnabled = !m_PacketTracingEnabled;
+		}
+
+		void ToggleWavefrontShading()
+		{
+			m_WavefrontShadingEnabled = !m_WavefrontShadingEnabled;
+			m_IsAccumulationValid = false;
+		}
+
+		//While the camera and scene stay unchanged every frame adds one jittered sample per pixel to the accumulation buffer
+		void ToggleProgressive()
+		{
+			m_ProgressiveEnabled = !m_ProgressiveEnabled;
+			m_IsAccumulationValid = false;
+		}
+		bool IsProgressive() const { return m_ProgressiveEnabled; }
+		//Samples per pixel in the current image
+		uint32_t GetSampleCount() const { return m_NumAccumulatedSamples; }
+
+		void CycleToneMapper();
+		void ToggleSRGB()
+		{
+			m_ToneMapping.encodeSRGB = !m_ToneMapping.encodeSRGB;
+		}
+		void SetToneMapping(const ToneMappingSettings& settings) { m_ToneMapping = settings; }
+		const ToneMappingSettings& GetToneMapping() const { return m_ToneMapping; }
+
 		void AddSphere(float x, float y, Scene* pScene) const;
 		void SelectGeometry(float x, float y, Scene* pScene) const;
 
@@ -50,19 +120,80 @@ namespace dae
 			ObservedArea,
 			Radiance,
 			BRDF,
-			Combined
+			Combined,
+			TraversalCost //heatmap of the node visits and primitive tests per pixel, primary and shadow rays included
+		};
+
+		//Material types a frame has to shade, decides which BRDF code a ShadePixel kernel contains
+		enum class MaterialSet
+		{
+			Constant, //only solid colors and Lambert, the BRDF does not depend on the light or view direction
+			Any
 		};
 
+		using ShadePixelFunction = void (Renderer::*)(const Scene* pScene, int px, int py, const Vector3& rayDirection, const HitRecord& hitRecord,
+		                                              const std::vector<Light>& lights, const MaterialTable& materials) const;
+
+		//Turns the cost buffer into a blue to red heatmap, scaled to the most expensive pixel of the frame
+		void ShadeTraversalCost();
+		//ShadePixel instantiation for the settings of a frame
+		static ShadePixelFunction SelectShadePixel(LightingMode lightingMode, bool shadowsEnabled, MaterialSet materialSet);
+		//One instantiation per lighting mode, shadow setting and material set, so the per light loop has no branches on the settings
+		template<LightingMode Mode, bool Shadows, MaterialSet Materials>
+		void ShadePixel(const Scene* pScene, int px, int py, const Vector3& rayDirection, const HitRecord& hitRecord,
+		                const std::vector<Light>& lights, const MaterialTable& materials) const;
+		//Primary rays of the 8x8 pixels starting at (packetX, packetY), returns the mask of the lanes inside the screen
+		RayPacketMask GeneratePrimaryPacket(int packetX, int packetY, const Camera& camera, const Matrix& cameraToWorld, RayPacket& packet) const;
+		/**
+		 * \brief Shadow test and Lambert cosine of a light at a hit
+		 * \tparam Shadows false skips the shadow ray, only the Lambert cosine decides
+		 * \param occluder last occluder of this light on the calling thread, see Scene::IsOccluded
+		 * \param directionToLight normalized, only written when the light reaches the hit
+		 * \return false if the light is occluded or behind the surface
+		 */
+		template<bool Shadows>
+		bool IsLit(const Scene* pScene, const HitRecord& hitRecord, const Light& light, OccluderCache& occluder,
+		           Vector3& directionToLight, float& lambertCos) const;
+		//Stores the linear color of the first sample, or adds later ones, ResolveBuffer averages and packs them
+		void WritePixel(int pixelIndex, const ColorRGB& color) const;
+		//Averages, tone maps and packs the accumulation buffer into the framebuffer, in parallel chunks of rows
+		void ResolveBuffer();
+
 		LightingMode m_CurrentLightingMode{ LightingMode::Combined };
-		bool m_ShadowsEnabled{ true }, m_EditMode{ false };
+		bool m_ShadowsEnabled{ true }, m_EditMode{ false }, m_PacketTracingEnabled{ true }, m_WavefrontShadingEnabled{ true };
+		//Chosen once per frame in Render
+		ShadePixelFunction m_pShadePixel{};
+
+		//Progressive accumulation stops here, the converged image is shown without tracing
+		static constexpr uint32_t MaxProgressiveSamples{ 1024 };
+		bool m_ProgressiveEnabled{ false };
+		bool m_IsAccumulationValid{ false }; //cleared by settings that change the image
+		uint32_t m_NumAccumulatedSamples{ 0 };
+		//Position of the frame's primary rays inside their pixel
+		float m_SampleOffsetX{ .5f };
+		float m_SampleOffsetY{ .5f };
 
-		SDL_Window* m_pWindow{};
+		FrameSink* m_pFrameSink{};
 
-		SDL_Surface* m_pBuffer{};
+		std::vector<uint32_t> m_Buffer{};
 		uint32_t* m_pBufferPixels{};
+		//Linear HDR colors of the frame, one plane per channel so the resolve pass loads whole registers
+		std::vector<float> m_AccumulationBuffer{};
+		float* m_pAccumulationRed{};
+		float* m_pAccumulationGreen{};
+		float* m_pAccumulationBlue{};
+		ToneMappingSettings m_ToneMapping{};
+		//Traversal cost per pixel, only written in LightingMode::TraversalCost
+		std::vector<uint32_t> m_CostBuffer{};
+		uint32_t* m_pCostPixels{};
+
+		RayStatistics m_FrameStatistics{};
 
 		int m_Width{};
 		int m_Height{};
 		float m_AspectRatio{};
+
+		std::unique_ptr<ThreadPool> m_pThreadPool{};
+		int m_TileSize{ 16 };
 	};
 }
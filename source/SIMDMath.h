@@ -0,0 +1,248 @@
+#pragma once
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+#include "MathHelpers.h"
+#include "Vector3.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define SIMDMATH_SSE
+#include <immintrin.h>
+#endif
+//Unlike the triangle kernels there is no runtime dispatch here, Float8 is one AVX register only when the build targets AVX
+#if defined(SIMDMATH_SSE) && defined(__AVX__)
+#define SIMDMATH_AVX
+#endif
+
+namespace dae
+{
+	//Wide math for packet code: FloatN holds N lanes, comparisons return a lane mask with every bit set for true lanes
+	//and Select picks per lane between two values with such a mask, so branches turn into blends
+
+#pragma region Float4
+	struct Float4
+	{
+		static constexpr int Width{ 4 };
+
+#if defined(SIMDMATH_SSE)
+		__m128 v;
+
+		Float4() = default;
+		FORCE_INLINE Float4(__m128 value) : v{ value } {}
+		FORCE_INLINE explicit Float4(float value) : v{ _mm_set1_ps(value) } {}
+
+		FORCE_INLINE static Float4 Load(const float* pValues) { return _mm_loadu_ps(pValues); }
+		FORCE_INLINE void Store(float* pValues) const { _mm_storeu_ps(pValues, v); }
+		//One bit per lane, lane 0 in bit 0
+		FORCE_INLINE int MoveMask() const { return _mm_movemask_ps(v); }
+
+		FORCE_INLINE Float4 operator+(const Float4& f) const { return _mm_add_ps(v, f.v); }
+		FORCE_INLINE Float4 operator-(const Float4& f) const { return _mm_sub_ps(v, f.v); }
+		FORCE_INLINE Float4 operator*(const Float4& f) const { return _mm_mul_ps(v, f.v); }
+		FORCE_INLINE Float4 operator/(const Float4& f) const { return _mm_div_ps(v, f.v); }
+		FORCE_INLINE Float4 operator-() const { return _mm_xor_ps(v, _mm_set1_ps(-0.f)); }
+		FORCE_INLINE Float4 operator&(const Float4& f) const { return _mm_and_ps(v, f.v); }
+		FORCE_INLINE Float4 operator|(const Float4& f) const { return _mm_or_ps(v, f.v); }
+
+		FORCE_INLINE Float4 operator<(const Float4& f) const { return _mm_cmplt_ps(v, f.v); }
+		FORCE_INLINE Float4 operator<=(const Float4& f) const { return _mm_cmple_ps(v, f.v); }
+		FORCE_INLINE Float4 operator>(const Float4& f) const { return _mm_cmpgt_ps(v, f.v); }
+		FORCE_INLINE Float4 operator>=(const Float4& f) const { return _mm_cmpge_ps(v, f.v); }
+
+		FORCE_INLINE static Float4 Sqrt(const Float4& f) { return _mm_sqrt_ps(f.v); }
+		FORCE_INLINE static Float4 Min(const Float4& a, const Float4& b) { return _mm_min_ps(a.v, b.v); }
+		FORCE_INLINE static Float4 Max(const Float4& a, const Float4& b) { return _mm_max_ps(a.v, b.v); }
+		//mask ? a : b per lane
+		FORCE_INLINE static Float4 Select(const Float4& mask, const Float4& a, const Float4& b)
+		{
+			return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v));
+		}
+#else
+		float v[Width];
+
+		Float4() = default;
+		explicit Float4(float value) : v{ value, value, value, value } {}
+
+		static Float4 Load(const float* pValues) { return Apply([&](int i) { return pValues[i]; }); }
+		void Store(float* pValues) const { for (int i{ 0 }; i < Width; ++i) pValues[i] = v[i]; }
+		int MoveMask() const
+		{
+			int mask{ 0 };
+			for (int i{ 0 }; i < Width; ++i)
+				mask |= (std::signbit(v[i]) ? 1 : 0) << i;
+			return mask;
+		}
+
+		Float4 operator+(const Float4& f) const { return Apply([&](int i) { return v[i] + f.v[i]; }); }
+		Float4 operator-(const Float4& f) const { return Apply([&](int i) { return v[i] - f.v[i]; }); }
+		Float4 operator*(const Float4& f) const { return Apply([&](int i) { return v[i] * f.v[i]; }); }
+		Float4 operator/(const Float4& f) const { return Apply([&](int i) { return v[i] / f.v[i]; }); }
+		Float4 operator-() const { return Apply([&](int i) { return -v[i]; }); }
+		Float4 operator&(const Float4& f) const { return Apply([&](int i) { return FromBits(ToBits(v[i]) & ToBits(f.v[i])); }); }
+		Float4 operator|(const Float4& f) const { return Apply([&](int i) { return FromBits(ToBits(v[i]) | ToBits(f.v[i])); }); }
+
+		Float4 operator<(const Float4& f) const { return Apply([&](int i) { return ToMask(v[i] < f.v[i]); }); }
+		Float4 operator<=(const Float4& f) const { return Apply([&](int i) { return ToMask(v[i] <= f.v[i]); }); }
+		Float4 operator>(const Float4& f) const { return Apply([&](int i) { return ToMask(v[i] > f.v[i]); }); }
+		Float4 operator>=(const Float4& f) const { return Apply([&](int i) { return ToMask(v[i] >= f.v[i]); }); }
+
+		static Float4 Sqrt(const Float4& f) { return Apply([&](int i) { return std::sqrt(f.v[i]); }); }
+		static Float4 Min(const Float4& a, const Float4& b) { return Apply([&](int i) { return a.v[i] < b.v[i] ? a.v[i] : b.v[i]; }); }
+		static Float4 Max(const Float4& a, const Float4& b) { return Apply([&](int i) { return a.v[i] > b.v[i] ? a.v[i] : b.v[i]; }); }
+		static Float4 Select(const Float4& mask, const Float4& a, const Float4& b)
+		{
+			return Apply([&](int i) { return ToBits(mask.v[i]) ? a.v[i] : b.v[i]; });
+		}
+
+	private:
+		template<typename Function>
+		static Float4 Apply(Function&& function)
+		{
+			Float4 result;
+			for (int i{ 0 }; i < Width; ++i)
+				result.v[i] = function(i);
+			return result;
+		}
+		static uint32_t ToBits(float value) { return std::bit_cast<uint32_t>(value); }
+		static float FromBits(uint32_t bits) { return std::bit_cast<float>(bits); }
+		static float ToMask(bool value) { return FromBits(value ? ~0u : 0u); }
+#endif
+	};
+#pragma endregion
+
+#pragma region Float8
+	struct Float8
+	{
+		static constexpr int Width{ 8 };
+
+#if defined(SIMDMATH_AVX)
+		__m256 v;
+
+		Float8() = default;
+		FORCE_INLINE Float8(__m256 value) : v{ value } {}
+		FORCE_INLINE explicit Float8(float value) : v{ _mm256_set1_ps(value) } {}
+
+		FORCE_INLINE static Float8 Load(const float* pValues) { return _mm256_loadu_ps(pValues); }
+		FORCE_INLINE void Store(float* pValues) const { _mm256_storeu_ps(pValues, v); }
+		FORCE_INLINE int MoveMask() const { return _mm256_movemask_ps(v); }
+
+		FORCE_INLINE Float8 operator+(const Float8& f) const { return _mm256_add_ps(v, f.v); }
+		FORCE_INLINE Float8 operator-(const Float8& f) const { return _mm256_sub_ps(v, f.v); }
+		FORCE_INLINE Float8 operator*(const Float8& f) const { return _mm256_mul_ps(v, f.v); }
+		FORCE_INLINE Float8 operator/(const Float8& f) const { return _mm256_div_ps(v, f.v); }
+		FORCE_INLINE Float8 operator-() const { return _mm256_xor_ps(v, _mm256_set1_ps(-0.f)); }
+		FORCE_INLINE Float8 operator&(const Float8& f) const { return _mm256_and_ps(v, f.v); }
+		FORCE_INLINE Float8 operator|(const Float8& f) const { return _mm256_or_ps(v, f.v); }
+
+		FORCE_INLINE Float8 operator<(const Float8& f) const { return _mm256_cmp_ps(v, f.v, _CMP_LT_OQ); }
+		FORCE_INLINE Float8 operator<=(const Float8& f) const { return _mm256_cmp_ps(v, f.v, _CMP_LE_OQ); }
+		FORCE_INLINE Float8 operator>(const Float8& f) const { return _mm256_cmp_ps(v, f.v, _CMP_GT_OQ); }
+		FORCE_INLINE Float8 operator>=(const Float8& f) const { return _mm256_cmp_ps(v, f.v, _CMP_GE_OQ); }
+
+		FORCE_INLINE static Float8 Sqrt(const Float8& f) { return _mm256_sqrt_ps(f.v); }
+		FORCE_INLINE static Float8 Min(const Float8& a, const Float8& b) { return _mm256_min_ps(a.v, b.v); }
+		FORCE_INLINE static Float8 Max(const Float8& a, const Float8& b) { return _mm256_max_ps(a.v, b.v); }
+		FORCE_INLINE static Float8 Select(const Float8& mask, const Float8& a, const Float8& b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+#else
+		//Two 4-wide halves, lanes 0-3 in low
+		Float4 low;
+		Float4 high;
+
+		Float8() = default;
+		FORCE_INLINE Float8(const Float4& lowHalf, const Float4& highHalf) : low{ lowHalf }, high{ highHalf } {}
+		FORCE_INLINE explicit Float8(float value) : low{ value }, high{ value } {}
+
+		FORCE_INLINE static Float8 Load(const float* pValues) { return { Float4::Load(pValues), Float4::Load(pValues + 4) }; }
+		FORCE_INLINE void Store(float* pValues) const { low.Store(pValues); high.Store(pValues + 4); }
+		FORCE_INLINE int MoveMask() const { return low.MoveMask() | high.MoveMask() << 4; }
+
+		FORCE_INLINE Float8 operator+(const Float8& f) const { return { low + f.low, high + f.high }; }
+		FORCE_INLINE Float8 operator-(const Float8& f) const { return { low - f.low, high - f.high }; }
+		FORCE_INLINE Float8 operator*(const Float8& f) const { return { low * f.low, high * f.high }; }
+		FORCE_INLINE Float8 operator/(const Float8& f) const { return { low / f.low, high / f.high }; }
+		FORCE_INLINE Float8 operator-() const { return { -low, -high }; }
+		FORCE_INLINE Float8 operator&(const Float8& f) const { return { low & f.low, high & f.high }; }
+		FORCE_INLINE Float8 operator|(const Float8& f) const { return { low | f.low, high | f.high }; }
+
+		FORCE_INLINE Float8 operator<(const Float8& f) const { return { low < f.low, high < f.high }; }
+		FORCE_INLINE Float8 operator<=(const Float8& f) const { return { low <= f.low, high <= f.high }; }
+		FORCE_INLINE Float8 operator>(const Float8& f) const { return { low > f.low, high > f.high }; }
+		FORCE_INLINE Float8 operator>=(const Float8& f) const { return { low >= f.low, high >= f.high }; }
+
+		FORCE_INLINE static Float8 Sqrt(const Float8& f) { return { Float4::Sqrt(f.low), Float4::Sqrt(f.high) }; }
+		FORCE_INLINE static Float8 Min(const Float8& a, const Float8& b) { return { Float4::Min(a.low, b.low), Float4::Min(a.high, b.high) }; }
+		FORCE_INLINE static Float8 Max(const Float8& a, const Float8& b) { return { Float4::Max(a.low, b.low), Float4::Max(a.high, b.high) }; }
+		FORCE_INLINE static Float8 Select(const Float8& mask, const Float8& a, const Float8& b)
+		{
+			return { Float4::Select(mask.low, a.low, b.low), Float4::Select(mask.high, a.high, b.high) };
+		}
+#endif
+	};
+#pragma endregion
+
+#pragma region Vector3xN
+	//N vectors in structure of arrays form, one FloatN per component
+	template<typename FloatN>
+	struct Vector3xN
+	{
+		FloatN x;
+		FloatN y;
+		FloatN z;
+
+		Vector3xN() = default;
+		FORCE_INLINE Vector3xN(const FloatN& _x, const FloatN& _y, const FloatN& _z) : x{ _x }, y{ _y }, z{ _z } {}
+		//Same vector in every lane
+		FORCE_INLINE explicit Vector3xN(const Vector3& v) : x{ v.x }, y{ v.y }, z{ v.z } {}
+
+		//Lanes [0, FloatN::Width) of three component arrays, like the directions of a RayPacket
+		FORCE_INLINE static Vector3xN Load(const float* pX, const float* pY, const float* pZ)
+		{
+			return { FloatN::Load(pX), FloatN::Load(pY), FloatN::Load(pZ) };
+		}
+		FORCE_INLINE void Store(float* pX, float* pY, float* pZ) const
+		{
+			x.Store(pX);
+			y.Store(pY);
+			z.Store(pZ);
+		}
+
+		FORCE_INLINE FloatN SqrMagnitude() const
+		{
+			return x * x + y * y + z * z;
+		}
+
+		FORCE_INLINE Vector3xN Normalized() const
+		{
+			const FloatN invMagnitude{ FloatN{ 1.f } / FloatN::Sqrt(SqrMagnitude()) };
+			return { x * invMagnitude, y * invMagnitude, z * invMagnitude };
+		}
+
+		FORCE_INLINE static FloatN Dot(const Vector3xN& v1, const Vector3xN& v2)
+		{
+			return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+		}
+
+		FORCE_INLINE static Vector3xN Cross(const Vector3xN& v1, const Vector3xN& v2)
+		{
+			return {
+				v1.y * v2.z - v1.z * v2.y,
+				v1.z * v2.x - v1.x * v2.z,
+				v1.x * v2.y - v1.y * v2.x };
+		}
+
+		FORCE_INLINE static Vector3xN Select(const FloatN& mask, const Vector3xN& a, const Vector3xN& b)
+		{
+			return { FloatN::Select(mask, a.x, b.x), FloatN::Select(mask, a.y, b.y), FloatN::Select(mask, a.z, b.z) };
+		}
+
+		FORCE_INLINE Vector3xN operator+(const Vector3xN& v) const { return { x + v.x, y + v.y, z + v.z }; }
+		FORCE_INLINE Vector3xN operator-(const Vector3xN& v) const { return { x - v.x, y - v.y, z - v.z }; }
+		FORCE_INLINE Vector3xN operator*(const FloatN& scale) const { return { x * scale, y * scale, z * scale }; }
+		FORCE_INLINE Vector3xN operator-() const { return { -x, -y, -z }; }
+	};
+
+	using Vector3x4 = Vector3xN<Float4>;
+	using Vector3x8 = Vector3xN<Float8>;
+#pragma endregion
+}
@@ -1,34 +1,29 @@
 #include "Scene.h"
 #include "Utils.h"
-#include "Material.h"
+#include "SceneFile.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <utility>
 
 namespace dae {
 
 #pragma region Base Scene
-	//Initialize Scene with Default Solid Color Material (RED)
-	Scene::Scene():
-		m_Materials({ new Material_SolidColor({1,0,0})})
+	//Initialize Scene with Default Solid Color Material (RED), the default MaterialHandle refers to it
+	Scene::Scene()
 	{
+		m_Materials.AddSolidColor({ 1, 0, 0 });
 		m_SphereGeometries.reserve(32);
 		m_PlaneGeometries.reserve(32);
-		m_TriangleMeshGeometries.reserve(32);
 		m_Lights.reserve(32);
-		m_SelectedMaterial = AddMaterial(new Material_CookTorrence({ .75f, .0f, .0f }, false, .1f));
+		m_SelectedMaterial = m_Materials.AddCookTorrence({ .75f, .0f, .0f }, false, .1f);
 	}
 
-	Scene::~Scene()
-	{
-		for(auto& pMaterial : m_Materials)
-		{
-			delete pMaterial;
-			pMaterial = nullptr;
-		}
-
-		m_Materials.clear();
-	}
+	Scene::~Scene() = default;
 
 	void Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
 	{
+		RayStats::Add(RayCounter::ClosestHitRays);
 		HitRecord tempRecord;
 		//planes
 		for (const Plane& currentPlane : m_PlaneGeometries)
@@ -39,64 +34,209 @@ namespace dae {
 			}
 		}
 
-		//spheres
-		for (const Sphere& currentSphere : m_SphereGeometries)
-		{
-			if (GeometryUtils::HitTest_Sphere(currentSphere, ray, tempRecord))
+		//spheres and triangle meshes, anything behind the closest hit so far is culled
+		Ray closestRay{ ray };
+		closestRay.max = std::min(ray.max, closestHit.t);
+
+		const uint32_t numSpheres{ static_cast<uint32_t>(m_SphereGeometries.size()) };
+		const std::vector<uint32_t>& objectIndices{ m_TopLevelBVH.GetPrimitiveIndices() };
+		GeometryUtils::TraverseBVH(m_TopLevelBVH, closestRay, [&](uint32_t slot, Ray& currentRay)
 			{
-				if (tempRecord.t < closestHit.t) closestHit = tempRecord;
-			}
-		}
-		
-		//triangles meshes
-		for (const TriangleMesh& currentMesh : m_TriangleMeshGeometries)
+				const uint32_t objectIndex{ objectIndices[slot] };
+				const bool didHit{ objectIndex < numSpheres ?
+					GeometryUtils::HitTest_Sphere(m_SphereGeometries[objectIndex], currentRay, tempRecord) :
+					GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries[objectIndex - numSpheres], currentRay, tempRecord) };
+
+				if (didHit && tempRecord.t < closestHit.t)
+				{
+					closestHit = tempRecord;
+					currentRay.max = tempRecord.t;
+				}
+				return false;
+			});
+	}
+
+	void Scene::GetClosestHits(RayPacket& packet, RayPacketMask mask, HitRecord* hitRecords) const
+	{
+		RayStats::Add(RayCounter::ClosestHitRays, std::popcount(mask));
+		//planes
+		for (const Plane& currentPlane : m_PlaneGeometries)
 		{
-			if (GeometryUtils::HitTest_TriangleMesh(currentMesh, ray, tempRecord))
-			{
-				if (tempRecord.t < closestHit.t) closestHit = tempRecord;
-			}
+			GeometryUtils::HitTest_Plane(currentPlane, packet, mask, hitRecords);
 		}
+
+		//spheres and triangle meshes, anything behind the closest hit of a lane is culled
+		const uint32_t numSpheres{ static_cast<uint32_t>(m_SphereGeometries.size()) };
+		const std::vector<uint32_t>& objectIndices{ m_TopLevelBVH.GetPrimitiveIndices() };
+		GeometryUtils::TraverseBVHPacket(m_TopLevelBVH, packet, mask, [&](const BVHNode& leaf, RayPacket& currentPacket, RayPacketMask leafMask)
+			{
+				for (uint32_t slot{ leaf.leftFirst }; slot < leaf.leftFirst + leaf.primitiveCount; ++slot)
+				{
+					const uint32_t objectIndex{ objectIndices[slot] };
+					if (objectIndex < numSpheres)
+						GeometryUtils::HitTest_Sphere(m_SphereGeometries[objectIndex], currentPacket, leafMask, hitRecords);
+					else
+						GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries[objectIndex - numSpheres], currentPacket, leafMask, hitRecords);
+				}
+			});
 	}
 
 	bool Scene::DoesHit(const Ray& ray) const
 	{
+		OccluderCache occluder{};
+		return IsOccluded(ray, occluder);
+	}
+
+	bool Scene::IsOccluded(const Ray& ray, OccluderCache& occluder) const
+	{
+		RayStats::Add(RayCounter::AnyHitRays);
+		if (IsOccludedByCachedOccluder(ray, occluder))
+		{
+			RayStats::Add(RayCounter::OccluderCacheHits);
+			return true;
+		}
+
 		//planes
-		for (const Plane& currentPlane : m_PlaneGeometries)
+		for (size_t planeIndex{ 0 }; planeIndex < m_PlaneGeometries.size(); ++planeIndex)
 		{
-			if (GeometryUtils::HitTest_Plane(currentPlane, ray))
+			if (GeometryUtils::HitTest_Plane(m_PlaneGeometries[planeIndex], ray))
 			{
+				occluder = { OccluderCache::Type::Plane, static_cast<uint32_t>(planeIndex) };
 				return true;
 			}
 		}
 
-		//spheres
-		for (const Sphere& currentSphere : m_SphereGeometries)
-		{
-			if (GeometryUtils::HitTest_Sphere(currentSphere, ray))
+		//spheres and triangle meshes, the ray is never shrunk since any hit ends the query
+		Ray shadowRay{ ray };
+		OccluderCache newOccluder{};
+
+		const uint32_t numSpheres{ static_cast<uint32_t>(m_SphereGeometries.size()) };
+		const std::vector<uint32_t>& objectIndices{ m_TopLevelBVH.GetPrimitiveIndices() };
+		GeometryUtils::TraverseBVH(m_TopLevelBVH, shadowRay, [&](uint32_t slot, const Ray& currentRay)
 			{
+				const uint32_t objectIndex{ objectIndices[slot] };
+				if (objectIndex < numSpheres)
+				{
+					if (!GeometryUtils::HitTest_Sphere(m_SphereGeometries[objectIndex], currentRay))
+						return false;
+					newOccluder = { OccluderCache::Type::Sphere, objectIndex };
+					return true;
+				}
+
+				uint32_t triangleSlot{};
+				if (!GeometryUtils::IsOccluded_TriangleMesh(m_TriangleMeshGeometries[objectIndex - numSpheres], currentRay, triangleSlot))
+					return false;
+				newOccluder = { OccluderCache::Type::Mesh, objectIndex - numSpheres, triangleSlot };
 				return true;
-			}
+			});
+		occluder = newOccluder;
+		return occluder.type != OccluderCache::Type::None;
+	}
+
+	bool Scene::IsOccludedByCachedOccluder(const Ray& ray, const OccluderCache& occluder) const
+	{
+		switch (occluder.type)
+		{
+		case OccluderCache::Type::Plane:
+			return occluder.objectIndex < m_PlaneGeometries.size() &&
+				GeometryUtils::HitTest_Plane(m_PlaneGeometries[occluder.objectIndex], ray);
+		case OccluderCache::Type::Sphere:
+			return occluder.objectIndex < m_SphereGeometries.size() &&
+				GeometryUtils::HitTest_Sphere(m_SphereGeometries[occluder.objectIndex], ray);
+		case OccluderCache::Type::Mesh:
+			return occluder.objectIndex < m_TriangleMeshGeometries.size() &&
+				GeometryUtils::IsOccluded_Triangle(m_TriangleMeshGeometries[occluder.objectIndex], occluder.triangleSlot, ray);
+		case OccluderCache::Type::None:
+		default:
+			return false;
 		}
+	}
 
-		for (const TriangleMesh& currentMesh : m_TriangleMeshGeometries)
+	bool Scene::UsesOnlyConstantBRDFs() const
+	{
+		//Checked every frame since edit mode can give any object any material
+		const auto hasConstantBRDF{ [](const auto& geometry) { return MaterialTable::HasConstantBRDF(geometry.material); } };
+		return std::ranges::all_of(m_PlaneGeometries, hasConstantBRDF) &&
+			std::ranges::all_of(m_SphereGeometries, hasConstantBRDF) &&
+			std::ranges::all_of(m_TriangleMeshGeometries, hasConstantBRDF);
+	}
+
+	void Scene::UpdateAccelerationStructure(ThreadPool* pThreadPool)
+	{
+		//Instances share their geometry, the flag makes sure it is refit only once
+		bool hasDeformedGeometry{ false };
+		for (TriangleMesh& currentMesh : m_TriangleMeshGeometries)
 		{
-			if (GeometryUtils::HitTest_TriangleMesh(currentMesh, ray))
+			if (currentMesh.pGeometry->arePositionsDirty)
 			{
-				return true;
+				currentMesh.pGeometry->RefitBVH(pThreadPool);
+				hasDeformedGeometry = true;
+			}
+		}
+		if (hasDeformedGeometry)
+		{
+			for (TriangleMesh& currentMesh : m_TriangleMeshGeometries)
+			{
+				currentMesh.UpdateTransformedAABB(currentMesh.worldTransform);
 			}
+			m_IsDirty = true;
+		}
+
+		const size_t numObjects{ m_SphereGeometries.size() + m_TriangleMeshGeometries.size() };
+		m_ObjectMinAABBs.resize(numObjects);
+		m_ObjectMaxAABBs.resize(numObjects);
+
+		size_t objectIndex{ 0 };
+		for (const Sphere& currentSphere : m_SphereGeometries)
+		{
+			const Vector3 radius{ currentSphere.radius, currentSphere.radius, currentSphere.radius };
+			m_ObjectMinAABBs[objectIndex] = currentSphere.origin - radius;
+			m_ObjectMaxAABBs[objectIndex] = currentSphere.origin + radius;
+			++objectIndex;
+		}
+
+		for (const TriangleMesh& currentMesh : m_TriangleMeshGeometries)
+		{
+			m_ObjectMinAABBs[objectIndex] = currentMesh.transformedMinAABB;
+			m_ObjectMaxAABBs[objectIndex] = currentMesh.transformedMaxAABB;
+			++objectIndex;
+		}
+
+		//Transforms only move the object bounds, a refit keeps the tree valid without a full rebuild until objects drifted too far apart
+		if (m_TopLevelBVH.GetPrimitiveCount() != numObjects)
+		{
+			m_TopLevelBVH.Build(m_ObjectMinAABBs, m_ObjectMaxAABBs);
+		}
+		else
+		{
+			m_TopLevelBVH.Refit(m_ObjectMinAABBs, m_ObjectMaxAABBs);
+			if (m_TopLevelBVH.HasDegraded())
+				m_TopLevelBVH.Build(m_ObjectMinAABBs, m_ObjectMaxAABBs);
 		}
-		return false;
+	}
+
+	bool Scene::ConsumeChanges()
+	{
+		bool hasChanged{ std::exchange(m_IsDirty, false) };
+		hasChanged |= std::exchange(m_Camera.isDirty, false);
+		for (TriangleMesh& mesh : m_TriangleMeshGeometries)
+		{
+			hasChanged |= std::exchange(mesh.isDirty, false);
+		}
+		return hasChanged;
 	}
 
 #pragma region Level Editing
 	void Scene::DeleteBalls()
 	{
 		m_SphereGeometries.clear();
+		m_IsDirty = true;
 	}
 
 	void Scene::SelectSphere(const Ray& ray)
 	{
 		ResetSelectedMaterial();
+		m_IsDirty = true;
 		m_SelectedGeometry = SelectedGeometry::Null;
 		HitRecord tempRecord, closestHit;
 		for (int currentSphere{0}; currentSphere < m_SphereGeometries.size(); ++currentSphere)
@@ -104,8 +244,8 @@ namespace dae {
 			if (GeometryUtils::HitTest_Sphere(m_SphereGeometries.at(currentSphere), ray))
 			{
 				m_SelectedSphereIndex = currentSphere;
-				m_OriginalMaterial = m_SphereGeometries.at(currentSphere).materialIndex;
-				m_SphereGeometries.at(currentSphere).materialIndex = m_SelectedMaterial;
+				m_OriginalMaterial = m_SphereGeometries.at(currentSphere).material;
+				m_SphereGeometries.at(currentSphere).material = m_SelectedMaterial;
 				m_SelectedGeometry = SelectedGeometry::Sphere;
 				return;
 			}
@@ -118,8 +258,8 @@ namespace dae {
 			if (GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries.at(currentMesh), ray))
 			{
 				m_SelectedSphereIndex = currentMesh;
-				m_OriginalMaterial = m_TriangleMeshGeometries.at(currentMesh).materialIndex;
-				m_TriangleMeshGeometries.at(currentMesh).materialIndex = m_SelectedMaterial;
+				m_OriginalMaterial = m_TriangleMeshGeometries.at(currentMesh).material;
+				m_TriangleMeshGeometries.at(currentMesh).material = m_SelectedMaterial;
 				m_SelectedGeometry = SelectedGeometry::Mesh;
 				return;
 			}
@@ -141,14 +281,15 @@ namespace dae {
 		if (closestPlaneIndex != -1)
 		{
 			m_SelectedSphereIndex = closestPlaneIndex;
-			m_OriginalMaterial = m_PlaneGeometries.at(closestPlaneIndex).materialIndex;
-			m_PlaneGeometries.at(closestPlaneIndex).materialIndex = m_SelectedMaterial;
+			m_OriginalMaterial = m_PlaneGeometries.at(closestPlaneIndex).material;
+			m_PlaneGeometries.at(closestPlaneIndex).material = m_SelectedMaterial;
 			m_SelectedGeometry = SelectedGeometry::Plane;
 		}
 	}
 
 	void Scene::MoveSelectedBall(const Vector3& offset)
 	{
+		m_IsDirty = true;
 		switch (m_SelectedGeometry)
 		{
 		case SelectedGeometry::Sphere:
@@ -168,16 +309,17 @@ namespace dae {
 
 	void Scene::ResetSelectedMaterial()
 	{
+		m_IsDirty = true;
 		switch (m_SelectedGeometry)
 		{
 		case SelectedGeometry::Sphere:
-			if (m_OriginalMaterial != -1) m_SphereGeometries.at(m_SelectedSphereIndex).materialIndex = m_OriginalMaterial;
+			m_SphereGeometries.at(m_SelectedSphereIndex).material = m_OriginalMaterial;
 			break;
 		case SelectedGeometry::Plane:
-			if (m_OriginalMaterial != -1) m_PlaneGeometries.at(m_SelectedSphereIndex).materialIndex = m_OriginalMaterial;
+			m_PlaneGeometries.at(m_SelectedSphereIndex).material = m_OriginalMaterial;
 			break;
 		case SelectedGeometry::Mesh:
-			if (m_OriginalMaterial != -1) m_TriangleMeshGeometries.at(m_SelectedSphereIndex).materialIndex = m_OriginalMaterial;
+			m_TriangleMeshGeometries.at(m_SelectedSphereIndex).material = m_OriginalMaterial;
 			break;
 		default:
 			break;
@@ -195,6 +337,7 @@ namespace dae {
 			{
 				std::swap(m_SphereGeometries.at(currentSphere), m_SphereGeometries.back());
 				m_SphereGeometries.pop_back();
+				m_IsDirty = true;
 			}
 		}
 	}
@@ -202,44 +345,58 @@ namespace dae {
 	void Scene::MoveLight(Vector3 newOrigin)
 	{
 		m_Lights.front().origin = newOrigin;
+		m_IsDirty = true;
 	}
 
 	void Scene::AddSphereOnClick(Vector3 origin)
 	{
-		unsigned char randomMaterial{ static_cast<unsigned char> (rand() % m_Materials.size()) };
+		const MaterialHandle randomMaterial{ m_Materials.GetHandle(static_cast<uint32_t>(rand()) % m_Materials.GetCount()) };
 		AddSphere(origin, 1.f, randomMaterial);
 	}
 #pragma endregion
 
 #pragma region Scene Helpers
-	Sphere* Scene::AddSphere(const Vector3& origin, float radius, unsigned char materialIndex)
+	Sphere* Scene::AddSphere(const Vector3& origin, float radius, MaterialHandle material)
 	{
 		Sphere s;
 		s.origin = origin;
 		s.radius = radius;
-		s.materialIndex = materialIndex;
+		s.material = material;
 
+		m_IsDirty = true;
 		m_SphereGeometries.emplace_back(s);
 		return &m_SphereGeometries.back();
 	}
 
-	Plane* Scene::AddPlane(const Vector3& origin, const Vector3& normal, unsigned char materialIndex)
+	Plane* Scene::AddPlane(const Vector3& origin, const Vector3& normal, MaterialHandle material)
 	{
 		Plane p;
 		p.origin = origin;
 		p.normal = normal;
-		p.materialIndex = materialIndex;
+		p.material = material;
 
+		m_IsDirty = true;
 		m_PlaneGeometries.emplace_back(p);
 		return &m_PlaneGeometries.back();
 	}
 
-	TriangleMesh* Scene::AddTriangleMesh(TriangleCullMode cullMode, unsigned char materialIndex)
+	TriangleMesh* Scene::AddTriangleMesh(TriangleCullMode cullMode, MaterialHandle material)
 	{
 		TriangleMesh m{};
 		m.cullMode = cullMode;
-		m.materialIndex = materialIndex;
+		m.material = material;
 
+		m_IsDirty = true;
+		m_TriangleMeshGeometries.emplace_back(m);
+		return &m_TriangleMeshGeometries.back();
+	}
+
+	TriangleMesh* Scene::AddTriangleMeshInstance(const TriangleMesh& source, MaterialHandle material)
+	{
+		TriangleMesh m{ source.pGeometry, source.cullMode };
+		m.material = material;
+
+		m_IsDirty = true;
 		m_TriangleMeshGeometries.emplace_back(m);
 		return &m_TriangleMeshGeometries.back();
 	}
@@ -252,6 +409,7 @@ namespace dae {
 		l.color = color;
 		l.type = LightType::Point;
 
+		m_IsDirty = true;
 		m_Lights.emplace_back(l);
 		return &m_Lights.back();
 	}
@@ -264,385 +422,36 @@ namespace dae {
 		l.color = color;
 		l.type = LightType::Directional;
 
+		m_IsDirty = true;
 		m_Lights.emplace_back(l);
 		return &m_Lights.back();
 	}
-
-	unsigned char Scene::AddMaterial(Material* pMaterial)
-	{
-		m_Materials.push_back(pMaterial);
-		return static_cast<unsigned char>(m_Materials.size() - 1);
-	}
 #pragma endregion
 #pragma endregion
 
-#pragma region SCENE W1
-	void Scene_W1::Initialize()
-	{
-		//default: Material id0 >> SolidColor Material (RED)
-		constexpr unsigned char matId_Solid_Red = 0;
-		const unsigned char matId_Solid_Blue = AddMaterial(new Material_SolidColor{ colors::Blue });
-		const unsigned char matId_Solid_Yellow = AddMaterial(new Material_SolidColor{ colors::Yellow });
-		const unsigned char matId_Solid_Green = AddMaterial(new Material_SolidColor{ colors::Green });
-		const unsigned char matId_Solid_Magenta = AddMaterial(new Material_SolidColor{ colors::Magenta });
-		const unsigned char matId_Solid_Gray = AddMaterial(new Material_SolidColor{ colors::Gray });
-
-		//Spheres
-		AddSphere({ -25.f, 0.f, 100.f }, 50.f, matId_Solid_Red);
-		AddSphere({ 25.f, 0.f, 100.f }, 50.f, matId_Solid_Blue);
-		//AddSphere({ 0.f, 25.f, 100.f }, 50.f, matId_Solid_Blue);
-		//AddSphere({ 0.f, -25.f, 100.f }, 50.f, matId_Solid_Blue);
-		//AddSphere({ 0.f, 0.f, 100.f }, 50.f, matId_Solid_Gray);
-		//AddSphere({ 10.f, 0.f, 100.f }, 50.f, matId_Solid_Yellow);
-		//AddSphere({ -10.f, 0.f, 100.f }, 50.f, matId_Solid_Yellow);
-
-		//Plane
-		AddPlane({ -75.f, 0.f, 0.f }, { 1.f, 0.f, 0.f}, matId_Solid_Green);
-		AddPlane({ 75.f, 0.f, 0.f }, { -1.f, 0.f, 0.f}, matId_Solid_Green);
-		AddPlane({ 0.f, -75.f, 0.f }, { 0.f, 1.f, 0.f}, matId_Solid_Yellow);
-		AddPlane({ 0.f, 75.f, 0.f }, { 0.f, -1.f, 0.f}, matId_Solid_Yellow);
-		AddPlane({ 0.f, 0.f, 125.f }, { 0.f, 0.f, -1.f}, matId_Solid_Magenta);
-	}
-#pragma endregion
-#pragma region SCENE W2
-	void Scene_W2::Initialize()
+#pragma region Scene Factory
+	std::vector<std::string> GetSceneNames()
 	{
-		m_Camera.origin = { 0.f, 3.f, -9.f };
-		m_Camera.SetFOV(45.f);
-
-		//default: Material id0 >> SolidColor Material (RED)
-		constexpr unsigned char matId_Solid_Red = 0;
-		const unsigned char matId_Solid_Blue = AddMaterial(new Material_SolidColor{ colors::Blue });
-		const unsigned char matId_Solid_Yellow = AddMaterial(new Material_SolidColor{ colors::Yellow });
-		const unsigned char matId_Solid_Green = AddMaterial(new Material_SolidColor{ colors::Green });
-		const unsigned char matId_Solid_Magenta = AddMaterial(new Material_SolidColor{ colors::Magenta });
-		const unsigned char matId_Solid_Gray = AddMaterial(new Material_SolidColor{ colors::Gray });
-
-		//Spheres
-		AddSphere({ -1.75f, 1.f, 0.f }, .75f, matId_Solid_Red);
-		AddSphere({ 0.f, 1.f, 0.f }, .75f, matId_Solid_Blue);
-		AddSphere({ 1.75f, 1.f, 0.f }, .75f, matId_Solid_Red);
-		AddSphere({ -1.75f, 3.f, 0.f }, .75f, matId_Solid_Blue);
-		AddSphere({ 0.f, 3.f, 0.f }, .75f, matId_Solid_Red);
-		AddSphere({ 1.75f, 3.f, 0.f }, .75f, matId_Solid_Blue);
-
-		//Plane
-		AddPlane({ -5.f, 0.f, 0.f }, { 1.f, 0.f, 0.f}, matId_Solid_Green);
-		AddPlane({ 5.f, 0.f, 0.f }, { -1.f, 0.f, 0.f}, matId_Solid_Green);
-		AddPlane({ 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f}, matId_Solid_Yellow);
-		AddPlane({ 0.f, 10.f, 0.f }, { 0.f, -1.f, 0.f}, matId_Solid_Yellow);
-		AddPlane({ 0.f, 0.f, 10.f }, { 0.f, 0.f, -1.f}, matId_Solid_Magenta);
-
-		//Lights
-		AddPointLight({ 0.f, 5.f, -5.f }, 70.f, colors::White);
-		//AddPointLight({ 0.f, 5.f, -10.f }, 70.f, colors::White);
-		//AddPointLight({ 5.f, 5.f, -5.f }, 70.f, colors::White);
-	}
-#pragma endregion
-	void Scene_W3::Initialize()
-	{
-		m_Camera.origin = { 0.f, 3.f, -9.f };
-		m_Camera.SetFOV(45.f);
-
-		
-		const auto matCT_GrayRoughMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, true, 1.f));
-		const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, true, .6f));
-		const auto matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ .972f, .75f, .915f }, true, .1f));
-		const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, false, 1.f));
-		const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, false, .6f));
-		const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, false, .1f));
-
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, .57f, .57f }, 1.f));
-
-		//Spheres
-		AddSphere({ -1.75f, 1.f, 0.f }, .75f, matCT_GrayRoughMetal);
-		AddSphere({ 0.f, 1.f, 0.f }, .75f, matCT_GrayMediumMetal);
-		AddSphere({ 1.75f, 1.f, 0.f }, .75f, matCT_GraySmoothMetal);
-		AddSphere({ -1.75f, 3.f, 0.f }, .75f, matCT_GrayRoughPlastic);
-		AddSphere({ 0.f, 3.f, 0.f }, .75f, matCT_GrayMediumPlastic);
-		AddSphere({ 1.75f, 3.f, 0.f }, .75f, matCT_GraySmoothPlastic);
-
-		//Plane
-		AddPlane({ 0.f, 0.f, 10.f }, { 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
-		AddPlane({ 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, matLambert_GrayBlue); //BOTTOM
-		AddPlane({ 0.f, 10.f, 0.f }, { 0.f, -1.f, 0.f }, matLambert_GrayBlue); //TOP
-		AddPlane({ 5.f, 0.f, 0.f }, { -1.f, 0.f, 0.f }, matLambert_GrayBlue); //RIGHT
-		AddPlane({ -5.f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, matLambert_GrayBlue); //LEFT
-
-		//Lights
-		AddPointLight({ 0.f, 5.f, 5.f }, 50.f, ColorRGB{ 1.f, .61f, .45f }); //BACKLIGHT
-		AddPointLight({ -2.5f, 5.f, -5.f }, 70.f, ColorRGB{ 1.f, .8f, .45f }); //FRONT LEFT
-		AddPointLight({ 2.5f, 2.5f, -5.f }, 50.f, ColorRGB{ .34f, .47f, .68f }); //BACK LEFT
-		
-
-		//m_Camera.origin = { 0.f, 1.f, -5.f };
-		//
-		//const auto matLambert_Red = AddMaterial(new Material_Lambert({ colors::Red }, 1.f));;
-		//const auto matLambert_Blue = AddMaterial(new Material_Lambert({ colors::Blue }, 1.f));
-		//const auto matLambert_Yellow = AddMaterial(new Material_Lambert({ colors::Yellow }, 1.f));
-		//const auto matLambert_White = AddMaterial(new Material_Lambert({ colors::White }, 1.f));
-		//const auto matLambert_Magenta = AddMaterial(new Material_Lambert({ colors::Magenta }, 1.f));
-		//const auto matLambert_Cyan = AddMaterial(new Material_Lambert({ colors::Cyan }, 1.f));
-		//const auto matLambert_Gray = AddMaterial(new Material_Lambert({ colors::Gray }, 1.f));
-		//const auto matLambert_Green = AddMaterial(new Material_Lambert({ colors::Green }, 1.f));
-		//const auto matLambertPhong_Red = AddMaterial(new Material_LambertPhong({ colors::Red }, 1.f, 1.f, 60.f));
-		//const auto matLambertPhong_Blue = AddMaterial(new Material_LambertPhong({ colors::Blue }, 1.f, 1.f, 60.f));
-		//const auto matLambertPhong_Yellow = AddMaterial(new Material_LambertPhong({ colors::Yellow }, 1.f, 1.f, 60.f));
-		//const auto matLambertPhong_White = AddMaterial(new Material_LambertPhong({ colors::White }, 1.f, 1.f, 60.f));
-		//const auto matLambertPhong_Magenta = AddMaterial(new Material_LambertPhong({ colors::Magenta }, 1.f, 1.f, 60.f));
-		//const auto matLambertPhong_Cyan = AddMaterial(new Material_LambertPhong({ colors::Cyan }, 1.f, 1.f, 60.f));
-		//const auto matLambertPhong_Gray = AddMaterial(new Material_LambertPhong({ colors::Gray }, 1.f, 1.f, 60.f));
-		//const auto matLambertPhong_Green = AddMaterial(new Material_LambertPhong({ colors::Green }, 1.f, 1.f, 60.f));
-		//
-		//AddSphere({ -.75f, 1.f, 0.f }, 1.f, matLambert_Red);
-		//AddSphere({ .75f, 1.f, 0.f }, 1.f, matLambertPhong_Blue);
-		////AddSphere({ 0.f, 5.f, 5.f }, .5f, matLambertPhong_Gray);
-		////AddSphere({ 0.f, 2.5f, -5.f }, 5.f, matLambertPhong_Magenta);
-		//
-		//AddPlane({ 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, matLambert_Yellow);
-		//
-		//AddPointLight({ 0.f, 5.f, 5.f }, 25.f, colors::White);
-		//AddPointLight({ 0.f, 2.5f, -5.f }, 25.f, colors::White);
-	}
-	void Scene_W4::Initialize()
-	{
-		m_Camera.origin = { 0.f, 1.f, -5.f };
-		m_Camera.SetFOV(45.f);
-		m_Camera.totalYaw = 0;
-
-
-		const auto matCT_GrayRoughMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, true, 1.f));
-		const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, true, .6f));
-		const auto matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ .972f, .75f, .915f }, true, .1f));
-		const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, false, 1.f));
-		const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, false, .6f));
-		const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, false, .1f));
-
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, .57f, .57f }, 1.f));
-
-		const auto matLambert_Red = AddMaterial(new Material_Lambert({ colors::Red }, 1.f));;
-		const auto matLambert_Blue = AddMaterial(new Material_Lambert({ colors::Blue }, 1.f));
-		const auto matLambert_Yellow = AddMaterial(new Material_Lambert({ colors::Yellow }, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert({ colors::White }, 1.f));
-		const auto matLambert_Magenta = AddMaterial(new Material_Lambert({ colors::Magenta }, 1.f));
-		const auto matLambert_Cyan = AddMaterial(new Material_Lambert({ colors::Cyan }, 1.f));
-		const auto matLambert_Gray = AddMaterial(new Material_Lambert({ colors::Gray }, 1.f));
-		const auto matLambert_Green = AddMaterial(new Material_Lambert({ colors::Green }, 1.f));
-		const auto matLambertPhong_Red = AddMaterial(new Material_LambertPhong({ colors::Red }, 1.f, 1.f, 60.f));
-		const auto matLambertPhong_Blue = AddMaterial(new Material_LambertPhong({ colors::Blue }, 1.f, 1.f, 60.f));
-		const auto matLambertPhong_Yellow = AddMaterial(new Material_LambertPhong({ colors::Yellow }, 1.f, 1.f, 60.f));
-		const auto matLambertPhong_White = AddMaterial(new Material_LambertPhong({ colors::White }, 1.f, 1.f, 60.f));
-		const auto matLambertPhong_Magenta = AddMaterial(new Material_LambertPhong({ colors::Magenta }, 1.f, 1.f, 60.f));
-		const auto matLambertPhong_Cyan = AddMaterial(new Material_LambertPhong({ colors::Cyan }, 1.f, 1.f, 60.f));
-		const auto matLambertPhong_Gray = AddMaterial(new Material_LambertPhong({ colors::Gray }, 1.f, 1.f, 60.f));
-		const auto matLambertPhong_Green = AddMaterial(new Material_LambertPhong({ colors::Green }, 1.f, 1.f, 60.f));
-
-		const auto cubeMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
-		Utils::ParseOBJ("Resources/lowpoly_bunny2.obj",
-			cubeMesh->positions,
-			cubeMesh->normals,
-			cubeMesh->indices);
-		
-		cubeMesh->Scale({ 2.f, 2.f, 2.f });
-		cubeMesh->UpdateTransforms();
-
-		//m_pMeshesVector.emplace_back(cubeMesh);
-
-		//AddSphere({ -.75f, .5f, .0f }, 0.1f, matLambert_Red);
-		//AddSphere({ -.75f, 2.f, .0f }, 0.1f, matLambert_Blue);
-		//AddSphere({ .75f, .5f, .0f }, 0.1f, matLambert_Green);
-
-		//Plane
-		AddPlane({ 0.f, 0.f, 10.f }, { 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
-		AddPlane({ 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, matLambert_GrayBlue); //BOTTOM
-		AddPlane({ 0.f, 10.f, 0.f }, { 0.f, -1.f, 0.f }, matLambert_GrayBlue); //TOP
-		AddPlane({ 5.f, 0.f, 0.f }, { -1.f, 0.f, 0.f }, matLambert_GrayBlue); //RIGHT
-		AddPlane({ -5.f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, matLambert_GrayBlue); //LEFT
-
-		//Lights
-		AddPointLight({ 0.f, 5.f, 5.f }, 50.f, ColorRGB{ 1.f, .61f, .45f }); //BACKLIGHT
-		AddPointLight({ -2.5f, 5.f, -5.f }, 70.f, ColorRGB{ 1.f, .8f, .45f }); //FRONT LEFT
-		AddPointLight({ 2.5f, 2.5f, -5.f }, 50.f, ColorRGB{ .34f, .47f, .68f }); //BACK LEFT
-	}
-	void Scene_W4::Update(Timer* pTimer)
-	{
-		Scene::Update(pTimer);
-		for (TriangleMesh* currentMesh : m_pMeshesVector)
+		std::vector<std::string> sceneNames{};
+		std::error_code error{};
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator{ SceneDirectory, error })
 		{
-			if (currentMesh)
-			{
-				currentMesh->RotateY(PI_DIV_2 * pTimer->GetTotal());
-				currentMesh->UpdateTransforms();
-			}
-		}
-	}
-	void Scene_W4_ReferenceScene::Initialize()
-	{
-		sceneName = "Reference Scene";
-		m_Camera.origin = { 0.f, 3.f, -9.f };
-		m_Camera.SetFOV(45.f);
-
-		const auto matCT_GrayRoughMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, true, 1.f));
-		const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, true, .6f));
-		const auto matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ .972f, .75f, .915f }, true, .1f));
-		const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, false, 1.f));
-		const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, false, .6f));
-		const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, false, .1f));
-
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, .57f, .57f }, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
-
-		//Spheres
-		AddSphere({ -1.75f, 1.f, 0.f }, .75f, matCT_GrayRoughMetal);
-		AddSphere({ 0.f, 1.f, 0.f }, .75f, matCT_GrayMediumMetal);
-		AddSphere({ 1.75f, 1.f, 0.f }, .75f, matCT_GraySmoothMetal);
-		AddSphere({ -1.75f, 3.f, 0.f }, .75f, matCT_GrayRoughPlastic);
-		AddSphere({ 0.f, 3.f, 0.f }, .75f, matCT_GrayMediumPlastic);
-		AddSphere({ 1.75f, 3.f, 0.f }, .75f, matCT_GraySmoothPlastic);
-
-		//Plane
-		AddPlane({ 0.f, 0.f, 10.f }, { 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
-		AddPlane({ 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, matLambert_GrayBlue); //BOTTOM
-		AddPlane({ 0.f, 10.f, 0.f }, { 0.f, -1.f, 0.f }, matLambert_GrayBlue); //TOP
-		AddPlane({ 5.f, 0.f, 0.f }, { -1.f, 0.f, 0.f }, matLambert_GrayBlue); //RIGHT
-		AddPlane({ -5.f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, matLambert_GrayBlue); //LEFT
-
-		//Triangle Meshes
-		const Triangle baseTriangle = { Vector3(-.75f, 1.5f, .0f), Vector3(.75f, .0f, .0f), Vector3(-.75f, .0f, .0f) };
-		const auto triangleOne = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
-		triangleOne->AppendTriangle(baseTriangle, true);
-		triangleOne->Translate({-1.75f, 4.5f, 0.f});
-		triangleOne->UpdateAABB();
-		triangleOne->UpdateTransforms();
-		m_pMeshesVector.push_back(triangleOne);
-
-		const auto triangleTwo = AddTriangleMesh(TriangleCullMode::FrontFaceCulling, matLambert_White);
-		triangleTwo->AppendTriangle(baseTriangle, true);
-		triangleTwo->Translate({0.f, 4.5f, 0.f});
-		triangleTwo->UpdateAABB();
-		triangleTwo->UpdateTransforms();
-		m_pMeshesVector.push_back(triangleTwo);
-
-		const auto triangleThree = AddTriangleMesh(TriangleCullMode::NoCulling, matLambert_White);
-		triangleThree->AppendTriangle(baseTriangle, true);
-		triangleThree->Translate({1.75f, 4.5f, 0.f});
-		triangleThree->UpdateAABB();
-		triangleThree->UpdateTransforms();
-		m_pMeshesVector.push_back(triangleThree);
-		
-		//Lights
-		AddPointLight({ 0.f, 5.f, 5.f }, 50.f, ColorRGB{ 1.f, .61f, .45f }); //BACKLIGHT
-		AddPointLight({ -2.5f, 5.f, -5.f }, 70.f, ColorRGB{ 1.f, .8f, .45f }); //FRONT LEFT
-		AddPointLight({ 2.5f, 2.5f, -5.f }, 50.f, ColorRGB{ .34f, .47f, .68f }); //BACK LEFT
-	}
-
-	void Scene_W4_ReferenceScene::Update(Timer* pTimer)
-	{
-		Scene::Update(pTimer);
-		const auto yawAngle{ (cos(pTimer->GetTotal()) + 1.f) / 2.f * PI_2 };
-		for (TriangleMesh* currentMesh : m_pMeshesVector)
-		{
-			if (currentMesh)
-			{
-				currentMesh->RotateY(yawAngle);
-				currentMesh->UpdateTransforms();
-			}
-		}
-	}
-	void Scene_W4_BunnyScene::Initialize()
-	{
-		sceneName = "Bunny Scene";
-		m_Camera.origin = { 0.f, 3.f, -9.f };
-		m_Camera.SetFOV(45.f);
-
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, .57f, .57f }, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
-		const auto matLambert_ExtraWhite = AddMaterial(new Material_Lambert(ColorRGB(5.f, 5.f, 5.f), 1.f));
-
-
-		const unsigned char matId_Solid_White = AddMaterial(new Material_SolidColor{ colors::White });
-
-		//Bunny
-		const auto bunnyMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matId_Solid_White);
-		Utils::ParseOBJ("Resources/lowpoly_bunny2.obj",
-			bunnyMesh->positions,
-			bunnyMesh->normals,
-			bunnyMesh->indices);
-
-		bunnyMesh->Scale({ 2.f, 2.f, 2.f });
-		bunnyMesh->UpdateAABB();
-		bunnyMesh->UpdateTransforms();
-
-		m_pMeshesVector.push_back(bunnyMesh);
-
-		//Plane
-		AddPlane({ 0.f, 0.f, 10.f }, { 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
-		AddPlane({ 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, matLambert_GrayBlue); //BOTTOM
-		AddPlane({ 0.f, 10.f, 0.f }, { 0.f, -1.f, 0.f }, matLambert_GrayBlue); //TOP
-		AddPlane({ 5.f, 0.f, 0.f }, { -1.f, 0.f, 0.f }, matLambert_GrayBlue); //RIGHT
-		AddPlane({ -5.f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, matLambert_GrayBlue); //LEFT
-
-		//Lights
-		AddPointLight({ 0.f, 5.f, 5.f }, 50.f, ColorRGB{ 1.f, .61f, .45f }); //BACKLIGHT
-		AddPointLight({ -2.5f, 5.f, -5.f }, 70.f, ColorRGB{ 1.f, .8f, .45f }); //FRONT LEFT
-		AddPointLight({ 2.5f, 2.5f, -5.f }, 50.f, ColorRGB{ .34f, .47f, .68f }); //BACK LEFT
-	}
-
-	void Scene_W4_BunnyScene::Update(Timer* pTimer)
-	{
-		Scene::Update(pTimer);
-		const auto yawAngle{ (cos(pTimer->GetTotal()) + 1.f) / 2.f * PI_2 };
-
-		for (TriangleMesh* currentMesh : m_pMeshesVector)
-		{
-			if (currentMesh)
-			{
-				currentMesh->RotateY(yawAngle);
-				currentMesh->UpdateTransforms();
-			}
+			if (entry.is_regular_file() && entry.path().extension() == ".scene")
+				sceneNames.push_back(entry.path().stem().string());
 		}
+		std::ranges::sort(sceneNames);
+		return sceneNames;
 	}
 
-	void Scene_W4_ExtraScene::Initialize()
+	Scene* CreateScene(const std::string& name)
 	{
-		sceneName = "Extra Scene";
-		m_Camera.origin = { 0.f, 3.f, -9.f };
-		m_Camera.SetFOV(45.f);
-
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, .57f, .57f }, 1.f));
-		const unsigned char matId_Solid_White = AddMaterial(new Material_SolidColor{ colors::White });
-		const unsigned char matId_Solid_Black = AddMaterial(new Material_SolidColor{ colors::Black });
-		const unsigned char matId_Solid_Red = AddMaterial(new Material_SolidColor{ colors::Red });
-
-		const auto matCT_WhiteRoughPlastic = AddMaterial(new Material_CookTorrence(colors::White, false, 1.f));
-		const auto matCT_BlackRoughPlastic = AddMaterial(new Material_CookTorrence(colors::Black, false, 1.f));
-		const auto matCT_RedRoughPlastic = AddMaterial(new Material_CookTorrence(colors::Red, false, 1.f));
-
-
-		AddSphere({ 0.f, .75f, 0.f }, 1.f, matCT_WhiteRoughPlastic);
-		AddSphere({ 0.f, 2.25f, 0.f }, .75f, matCT_WhiteRoughPlastic);
-		AddSphere({ 0.f, 3.25f, 0.f }, .5f, matCT_WhiteRoughPlastic);
-		AddSphere({ .2f, 3.45f, -0.4f }, .1f, matCT_BlackRoughPlastic);
-		AddSphere({ -.2f, 3.45f, -0.4f }, .1f, matCT_BlackRoughPlastic);
-		AddSphere({ .0f, 3.25f, -0.4f }, .15f, matCT_RedRoughPlastic);
-
-		AddSphere({ 3.f, .25f, 0.f }, .75f, matCT_WhiteRoughPlastic);
-		AddSphere({ 3.f, 1.25f, 0.f }, .5f, matCT_WhiteRoughPlastic);
-		AddSphere({ 3.2f, 1.45f, -0.4f }, .1f, matCT_BlackRoughPlastic);
-		AddSphere({ 2.8f, 1.45f, -0.4f }, .1f, matCT_BlackRoughPlastic);
-		AddSphere({ 3.0f, 1.25f, -0.4f }, .15f, matCT_RedRoughPlastic);
-
-		//Plane
-		AddPlane({ 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, matLambert_GrayBlue); //BOTTOM
-
-		//Lights
-		AddPointLight({ 0.f, 5.f, 5.f }, 100.f, ColorRGB{ .8f, .8f, .8f }); // Following Light
-	}
-
-	void Scene_W4_ExtraScene::Update(Timer* pTimer)
-	{
-		Scene::Update(pTimer);
+		std::filesystem::path path{ name };
+		if (path.extension() != ".scene")
+			path = std::filesystem::path{ SceneDirectory } / (name + ".scene");
 
-		m_Lights[0].origin = m_Camera.origin;
+		if (!std::filesystem::is_regular_file(path))
+			return nullptr;
+		return new Scene_File(path.string());
 	}
+#pragma endregion
 }
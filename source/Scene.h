@@ -1,20 +1,41 @@
 #pragma once
+#include <deque>
 #include <string>
 #include <vector>
 
 #include "Math.h"
 #include "DataTypes.h"
+#include "Material.h"
 #include "Camera.h"
+#include "RayPacket.h"
+#include "Profiler.h"
 
 namespace dae
 {
 	//Forward Declarations
 	class Timer;
-	class Material;
+	class ThreadPool;
 	struct Plane;
 	struct Sphere;
 	struct Light;
 
+	//Object that blocked the last shadow ray towards a light, the next ray towards that light tests it first
+	//Neighbouring pixels are mostly shadowed by the same object, usually even by the same triangle
+	struct OccluderCache
+	{
+		enum class Type : uint8_t
+		{
+			None,
+			Plane,
+			Sphere,
+			Mesh
+		};
+
+		Type type{ Type::None };
+		uint32_t objectIndex{}; //index into the planes, spheres or meshes of the scene
+		uint32_t triangleSlot{}; //meshes only, slot of the triangle in the mesh geometry
+	};
+
 	//Scene Base Class
 	class Scene
 	{
@@ -30,17 +51,42 @@ namespace dae
 		virtual void Initialize() = 0;
 		virtual void Update(dae::Timer* pTimer)
 		{
+			PROFILE_ZONE("Camera::Update");
 			m_Camera.Update(pTimer);
 		}
 
 		Camera& GetCamera() { return m_Camera; }
 		void GetClosestHit(const Ray& ray, HitRecord& closestHit) const;
+		/**
+		 * \brief Closest hit of every lane in mask, the packet is traced through the top level BVH as a whole
+		 * \param hitRecords one record per packet lane
+		 */
+		void GetClosestHits(RayPacket& packet, RayPacketMask mask, HitRecord* hitRecords) const;
 		bool DoesHit(const Ray& ray) const;
+		/**
+		 * \brief Occlusion query for shadow rays, stops at the first object inside [ray.min, ray.max] without tracking the closest one
+		 * \param occluder tested before anything else, replaced by the object that blocked the ray and cleared when nothing did
+		 * A stale occluder, e.g. after objects were removed, is only a wrong guess and costs one extra test
+		 */
+		bool IsOccluded(const Ray& ray, OccluderCache& occluder) const;
+		/**
+		 * \brief Refits the BVH of deformed meshes, then rebuilds the top level BVH when objects were added or removed and refits it otherwise
+		 * Refit trees whose SAH cost degraded too far are rebuilt, see BVH::HasDegraded
+		 * \param pThreadPool used to refit large mesh BVHs in parallel, may be nullptr
+		 */
+		void UpdateAccelerationStructure(ThreadPool* pThreadPool = nullptr);
+		/**
+		 * \brief Whether the camera, a mesh transform or any geometry, light or material assignment changed since the last call
+		 * Clears every dirty flag, the renderer calls it once per frame to decide if accumulated samples are still valid
+		 */
+		bool ConsumeChanges();
 
 		const std::vector<Plane>& GetPlaneGeometries() const { return m_PlaneGeometries; }
 		const std::vector<Sphere>& GetSphereGeometries() const { return m_SphereGeometries; }
 		const std::vector<Light>& GetLights() const { return m_Lights; }
-		const std::vector<Material*> GetMaterials() const { return m_Materials; }
+		const MaterialTable& GetMaterials() const { return m_Materials; }
+		//True if every plane, sphere and mesh has a material with a constant BRDF, see MaterialTable::HasConstantBRDF
+		bool UsesOnlyConstantBRDFs() const;
 
 		void MoveLight(Vector3 newOrigin);
 		void AddSphereOnClick(Vector3 origin);
@@ -72,151 +118,45 @@ namespace dae
 			Mesh
 		};
 		bool m_EditMode{ false };
+		bool m_IsDirty{ true }; //geometry, lights or materials changed, mesh transforms and the camera have their own flags
 		SelectedGeometry m_SelectedGeometry{SelectedGeometry::Null};
 		int m_SelectedSphereIndex{ -1 };
-		int m_OriginalMaterial{ -1 };
-		unsigned char m_SelectedMaterial;
+		MaterialHandle m_OriginalMaterial{};
+		MaterialHandle m_SelectedMaterial{};
 
 
 		std::vector<Plane> m_PlaneGeometries{};
 		std::vector<Sphere> m_SphereGeometries{};
-		std::vector<TriangleMesh> m_TriangleMeshGeometries{};
+		std::deque<TriangleMesh> m_TriangleMeshGeometries{}; //deque keeps the returned mesh pointers valid
 		//std::vector<Triangle> m_TriangleGeometries{}; //temporary
 		std::vector<Light> m_Lights{};
-		std::vector<Material*> m_Materials{};
+		MaterialTable m_Materials{};
+
+		//Top level BVH over the spheres followed by the triangle meshes, planes are unbounded and tested separately
+		BVH m_TopLevelBVH{};
+		std::vector<Vector3> m_ObjectMinAABBs{};
+		std::vector<Vector3> m_ObjectMaxAABBs{};
 
 		Camera m_Camera{};
 
-		Sphere* AddSphere(const Vector3& origin, float radius, unsigned char materialIndex = 0);
-		Plane* AddPlane(const Vector3& origin, const Vector3& normal, unsigned char materialIndex = 0);
-		TriangleMesh* AddTriangleMesh(TriangleCullMode cullMode, unsigned char materialIndex = 0);
+		//The object occluder refers to blocks ray, false if it is gone or misses
+		bool IsOccludedByCachedOccluder(const Ray& ray, const OccluderCache& occluder) const;
+
+		Sphere* AddSphere(const Vector3& origin, float radius, MaterialHandle material = {});
+		Plane* AddPlane(const Vector3& origin, const Vector3& normal, MaterialHandle material = {});
+		TriangleMesh* AddTriangleMesh(TriangleCullMode cullMode, MaterialHandle material = {});
+		//Shares the geometry of an existing mesh, the new instance starts with an identity transform
+		TriangleMesh* AddTriangleMeshInstance(const TriangleMesh& source, MaterialHandle material = {});
 
 		Light* AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color);
 		Light* AddDirectionalLight(const Vector3& direction, float intensity, const ColorRGB& color);
-		unsigned char AddMaterial(Material* pMaterial);
-	};
-
-	//+++++++++++++++++++++++++++++++++++++++++
-	//WEEK 1 Test Scene
-	class Scene_W1 final : public Scene
-	{
-	public:
-		Scene_W1() = default;
-		~Scene_W1() override = default;
-
-		Scene_W1(const Scene_W1&) = delete;
-		Scene_W1(Scene_W1&&) noexcept = delete;
-		Scene_W1& operator=(const Scene_W1&) = delete;
-		Scene_W1& operator=(Scene_W1&&) noexcept = delete;
-
-		void Initialize() override;
-	};
-
-	//+++++++++++++++++++++++++++++++++++++++++
-	//WEEK 2 Test Scene
-	class Scene_W2 final : public Scene
-	{
-	public:
-		Scene_W2() = default;
-		~Scene_W2() override = default;
-
-		Scene_W2(const Scene_W2&) = delete;
-		Scene_W2(Scene_W2&&) noexcept = delete;
-		Scene_W2& operator=(const Scene_W2&) = delete;
-		Scene_W2& operator=(Scene_W2&&) noexcept = delete;
-
-		void Initialize() override;
 	};
 
-	//+++++++++++++++++++++++++++++++++++++++++
-	//WEEK 3 Test Scene
-	class Scene_W3 final : public Scene
-	{
-	public:
-		Scene_W3() = default;
-		~Scene_W3() override = default;
-
-		Scene_W3(const Scene_W3&) = delete;
-		Scene_W3(Scene_W3&&) noexcept = delete;
-		Scene_W3& operator=(const Scene_W3&) = delete;
-		Scene_W3& operator=(Scene_W3&&) noexcept = delete;
-
-		void Initialize() override;
-	};
+	//Directory the scene files are read from
+	constexpr const char* SceneDirectory{ "Resources/Scenes" };
 
-	//+++++++++++++++++++++++++++++++++++++++++
-	//WEEK 4 Test Scene
-	class Scene_W4 final : public Scene
-	{
-	public:
-		Scene_W4() = default;
-		~Scene_W4() override = default;
-
-		Scene_W4(const Scene_W4&) = delete;
-		Scene_W4(Scene_W4&&) noexcept = delete;
-		Scene_W4& operator=(const Scene_W4&) = delete;
-		Scene_W4& operator=(Scene_W4&&) noexcept = delete;
-
-		void Initialize() override;
-		void Update(Timer* pTimer) override;
-
-	private:
-		std::vector<TriangleMesh*> m_pMeshesVector;
-	};
-
-	//+++++++++++++++++++++++++++++++++++++++++
-	//WEEK 4 Reference Scene
-	class Scene_W4_ReferenceScene final : public Scene
-	{
-	public:
-		Scene_W4_ReferenceScene() = default;
-		~Scene_W4_ReferenceScene() override = default;
-
-		Scene_W4_ReferenceScene(const Scene_W4_ReferenceScene&) = delete;
-		Scene_W4_ReferenceScene(Scene_W4_ReferenceScene&&) noexcept = delete;
-		Scene_W4_ReferenceScene& operator=(const Scene_W4_ReferenceScene&) = delete;
-		Scene_W4_ReferenceScene& operator=(Scene_W4_ReferenceScene&&) noexcept = delete;
-
-		void Initialize() override;
-		void Update(Timer* pTimer) override;
-
-	private:
-		std::vector<TriangleMesh*> m_pMeshesVector;
-	};
-
-	class Scene_W4_BunnyScene final : public Scene
-	{
-	public:
-		Scene_W4_BunnyScene() = default;
-		~Scene_W4_BunnyScene() override = default;
-
-		Scene_W4_BunnyScene(const Scene_W4_BunnyScene&) = delete;
-		Scene_W4_BunnyScene(Scene_W4_BunnyScene&&) noexcept = delete;
-		Scene_W4_BunnyScene& operator=(const Scene_W4_BunnyScene&) = delete;
-		Scene_W4_BunnyScene& operator=(Scene_W4_BunnyScene&&) noexcept = delete;
-
-		void Initialize() override;
-		void Update(Timer* pTimer) override;
-
-	private:
-		std::vector<TriangleMesh*> m_pMeshesVector;
-	};
-
-	class Scene_W4_ExtraScene final : public Scene
-	{
-	public:
-		Scene_W4_ExtraScene() = default;
-		~Scene_W4_ExtraScene() override = default;
-
-		Scene_W4_ExtraScene(const Scene_W4_ExtraScene&) = delete;
-		Scene_W4_ExtraScene(Scene_W4_ExtraScene&&) noexcept = delete;
-		Scene_W4_ExtraScene& operator=(const Scene_W4_ExtraScene&) = delete;
-		Scene_W4_ExtraScene& operator=(Scene_W4_ExtraScene&&) noexcept = delete;
-
-		void Initialize() override;
-		void Update(Timer* pTimer) override;
-
-	private:
-		std::vector<TriangleMesh*> m_pMeshesVector;
-	};
+	//Names of the scene files in SceneDirectory without their .scene extension, sorted
+	std::vector<std::string> GetSceneNames();
+	//Creates a scene from SceneDirectory/<name>.scene or from a path to a .scene file without initializing it, nullptr if the file does not exist
+	Scene* CreateScene(const std::string& name);
 }
@@ -0,0 +1,412 @@
+#include "SceneFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+#include "MeshCache.h"
+#include "Timer.h"
+
+using namespace dae;
+
+namespace
+{
+	bool ReadVector3(std::istringstream& stream, Vector3& vector)
+	{
+		return static_cast<bool>(stream >> vector.x >> vector.y >> vector.z);
+	}
+
+	bool ReadColor(std::istringstream& stream, ColorRGB& color)
+	{
+		return static_cast<bool>(stream >> color.r >> color.g >> color.b);
+	}
+
+	bool ParseBVHBuildMethod(const std::string& word, BVHBuildMethod& buildMethod)
+	{
+		if (word == "sah") buildMethod = BVHBuildMethod::SAH;
+		else if (word == "lbvh") buildMethod = BVHBuildMethod::Linear;
+		else if (word == "lbvh_treelets") buildMethod = BVHBuildMethod::LinearTreelets;
+		else return false;
+		return true;
+	}
+
+	bool ParseBVHLayout(const std::string& word, BVHLayout& layout)
+	{
+		if (word == "quantized") layout = BVHLayout::Quantized;
+		else if (word == "wide4") layout = BVHLayout::Wide4;
+		else if (word == "wide8") layout = BVHLayout::Wide8;
+		else return false;
+		return true;
+	}
+
+	bool ParseCullMode(const std::string& word, TriangleCullMode& cullMode)
+	{
+		if (word == "backface") cullMode = TriangleCullMode::BackFaceCulling;
+		else if (word == "frontface") cullMode = TriangleCullMode::FrontFaceCulling;
+		else if (word == "none") cullMode = TriangleCullMode::NoCulling;
+		else return false;
+		return true;
+	}
+}
+
+Scene_File::Scene_File(const std::string& path) :
+	m_Path{ path }
+{
+	sceneName = std::filesystem::path{ path }.stem().string();
+}
+
+void Scene_File::Initialize()
+{
+	const auto startTime{ std::chrono::steady_clock::now() };
+	m_IsLoaded = Load();
+
+	//Only a broken file leaves a mesh without triangles, there is nothing to build a BVH over so all meshes are dropped
+	if (std::ranges::any_of(m_TriangleMeshGeometries, [](const TriangleMesh& mesh) { return mesh.pGeometry->indices.empty(); }))
+	{
+		std::cout << m_Path << ": every mesh needs at least one triangle, the meshes are skipped\n";
+		m_TriangleMeshGeometries.clear();
+		m_Animations.clear();
+		m_IsLoaded = false;
+	}
+
+	//Every mesh builds its BVH exactly once, after all of its triangles are known
+	for (TriangleMesh& mesh : m_TriangleMeshGeometries)
+	{
+		mesh.UpdateTransforms();
+	}
+	for (MeshAnimation& animation : m_Animations)
+	{
+		if (animation.type == AnimationType::Wave)
+			animation.restPositions = animation.pMesh->pGeometry->positions;
+	}
+	UpdateAccelerationStructure();
+
+	const std::chrono::duration<float, std::milli> loadTime{ std::chrono::steady_clock::now() - startTime };
+	std::cout << "Loaded scene " << m_Path << " in " << loadTime.count() << " ms (" << m_SphereGeometries.size() << " spheres, "
+		<< m_PlaneGeometries.size() << " planes, " << m_TriangleMeshGeometries.size() << " meshes, " << m_Lights.size() << " lights)\n";
+}
+
+void Scene_File::Update(Timer* pTimer)
+{
+	Scene::Update(pTimer);
+
+	for (const MeshAnimation& animation : m_Animations)
+	{
+		if (animation.type == AnimationType::Wave)
+		{
+			//The phase follows the object space position so the wave runs across the mesh
+			MeshGeometry& geometry{ *animation.pMesh->pGeometry };
+			const float phase{ animation.speed * pTimer->GetTotal() };
+			for (size_t i{ 0 }; i < geometry.positions.size(); ++i)
+			{
+				const Vector3& restPosition{ animation.restPositions[i] };
+				geometry.positions[i].y = restPosition.y + animation.height * sinf(phase + restPosition.x + restPosition.z);
+			}
+			geometry.arePositionsDirty = true;
+			continue;
+		}
+
+		const float yawAngle{ animation.type == AnimationType::YawCosine ?
+			(std::cos(pTimer->GetTotal()) + 1.f) / 2.f * PI_2 :
+			animation.speed * pTimer->GetTotal() };
+		animation.pMesh->RotateY(yawAngle);
+		animation.pMesh->UpdateTransforms();
+	}
+
+	for (const size_t lightIndex : m_CameraLightIndices)
+	{
+		m_Lights[lightIndex].origin = m_Camera.origin;
+	}
+}
+
+bool Scene_File::Load()
+{
+	std::ifstream file{ m_Path };
+	if (!file)
+	{
+		std::cout << "Could not open scene file " << m_Path << "\n";
+		return false;
+	}
+
+	const std::filesystem::path directory{ std::filesystem::path{ m_Path }.parent_path() };
+	std::unordered_map<std::string, MaterialHandle> materials{ { "default", MaterialHandle{} } };
+	std::unordered_map<std::string, TriangleMesh*> meshes{};
+	TriangleMesh* pLastMesh{};
+	int lastLightIndex{ -1 }; //index instead of a pointer, adding lights can reallocate m_Lights
+
+	std::string line{};
+	int lineNumber{ 0 };
+	const auto fail{ [&](const std::string& message)
+		{
+			std::cout << m_Path << ":" << lineNumber << ": " << message << "\n";
+			return false;
+		} };
+
+	while (std::getline(file, line))
+	{
+		++lineNumber;
+		const size_t commentStart{ line.find('#') };
+		if (commentStart != std::string::npos)
+			line.resize(commentStart);
+
+		std::istringstream stream{ line };
+		std::string keyword{};
+		if (!(stream >> keyword))
+			continue;
+
+		const auto findMaterial{ [&](MaterialHandle& material)
+			{
+				std::string materialName{};
+				if (!(stream >> materialName))
+					return fail("expected a material name");
+				const auto it{ materials.find(materialName) };
+				if (it == materials.end())
+					return fail("unknown material '" + materialName + "'");
+				material = it->second;
+				return true;
+			} };
+
+		if (keyword == "name")
+		{
+			std::getline(stream >> std::ws, sceneName);
+		}
+		else if (keyword == "camera")
+		{
+			Vector3 origin{};
+			float fov{};
+			if (!ReadVector3(stream, origin) || !(stream >> fov))
+				return fail("expected camera <x y z> <fov> [<pitch> <yaw>]");
+
+			m_Camera.origin = origin;
+			m_Camera.SetFOV(fov);
+
+			float pitch{}, yaw{};
+			if (stream >> pitch)
+			{
+				if (!(stream >> yaw))
+					return fail("expected a yaw angle after the pitch");
+				m_Camera.totalPitch = pitch * TO_RADIANS;
+				m_Camera.totalYaw = yaw * TO_RADIANS;
+				m_Camera.forward = Matrix::CreateRotation(m_Camera.totalPitch, m_Camera.totalYaw, 0).TransformVector(Vector3::UnitZ).Normalized();
+			}
+			else
+			{
+				stream.clear();
+			}
+		}
+		else if (keyword == "material")
+		{
+			std::string name{}, type{};
+			ColorRGB color{};
+			if (!(stream >> name >> type) || !ReadColor(stream, color))
+				return fail("expected material <name> <type> <r g b> ...");
+			if (materials.contains(name))
+				return fail("material '" + name + "' is already defined");
+
+			MaterialHandle material{};
+			if (type == "solid")
+			{
+				material = m_Materials.AddSolidColor(color);
+			}
+			else if (type == "lambert")
+			{
+				float diffuseReflectance{};
+				if (!(stream >> diffuseReflectance))
+					return fail("expected material <name> lambert <r g b> <kd>");
+				material = m_Materials.AddLambert(color, diffuseReflectance);
+			}
+			else if (type == "lambertphong")
+			{
+				float diffuseReflectance{}, specularReflectance{}, phongExponent{};
+				if (!(stream >> diffuseReflectance >> specularReflectance >> phongExponent))
+					return fail("expected material <name> lambertphong <r g b> <kd> <ks> <exponent>");
+				material = m_Materials.AddLambertPhong(color, diffuseReflectance, specularReflectance, phongExponent);
+			}
+			else if (type == "cooktorrance")
+			{
+				std::string metalness{};
+				float roughness{};
+				if (!(stream >> metalness >> roughness) || (metalness != "metal" && metalness != "dielectric"))
+					return fail("expected material <name> cooktorrance <r g b> <metal|dielectric> <roughness>");
+				material = m_Materials.AddCookTorrence(color, metalness == "metal", roughness);
+			}
+			else
+			{
+				return fail("unknown material type '" + type + "'");
+			}
+			materials.emplace(name, material);
+		}
+		else if (keyword == "sphere")
+		{
+			Vector3 origin{};
+			float radius{};
+			MaterialHandle material{};
+			if (!ReadVector3(stream, origin) || !(stream >> radius))
+				return fail("expected sphere <x y z> <radius> <material>");
+			if (!findMaterial(material))
+				return false;
+			AddSphere(origin, radius, material);
+		}
+		else if (keyword == "plane")
+		{
+			Vector3 origin{}, normal{};
+			MaterialHandle material{};
+			if (!ReadVector3(stream, origin) || !ReadVector3(stream, normal))
+				return fail("expected plane <x y z> <nx ny nz> <material>");
+			if (!findMaterial(material))
+				return false;
+			AddPlane(origin, normal, material);
+		}
+		else if (keyword == "mesh")
+		{
+			std::string name{}, cullModeName{}, source{};
+			TriangleCullMode cullMode{};
+			MaterialHandle material{};
+			if (!(stream >> name >> cullModeName) || !ParseCullMode(cullModeName, cullMode))
+				return fail("expected mesh <name> <backface|frontface|none> <material> <obj <path>|empty>");
+			if (meshes.contains(name))
+				return fail("mesh '" + name + "' is already defined");
+			if (!findMaterial(material))
+				return false;
+			if (!(stream >> source) || (source != "obj" && source != "empty"))
+				return fail("expected obj <path> or empty after the material");
+
+			pLastMesh = AddTriangleMesh(cullMode, material);
+			if (source == "obj")
+			{
+				std::string objPath{};
+				if (!std::getline(stream >> std::ws, objPath))
+					return fail("expected the path of the OBJ file");
+				if (!MeshCache::LoadOBJ((directory / objPath).lexically_normal().string(), *pLastMesh->pGeometry))
+					return fail("could not load '" + objPath + "'");
+			}
+			meshes.emplace(name, pLastMesh);
+		}
+		else if (keyword == "instance")
+		{
+			std::string name{}, sourceName{};
+			MaterialHandle material{};
+			if (!(stream >> name >> sourceName))
+				return fail("expected instance <name> <mesh> <material>");
+			if (meshes.contains(name))
+				return fail("mesh '" + name + "' is already defined");
+			const auto it{ meshes.find(sourceName) };
+			if (it == meshes.end())
+				return fail("unknown mesh '" + sourceName + "'");
+			if (!findMaterial(material))
+				return false;
+
+			pLastMesh = AddTriangleMeshInstance(*it->second, material);
+			meshes.emplace(name, pLastMesh);
+		}
+		else if (keyword == "light")
+		{
+			std::string type{};
+			Vector3 vector{};
+			float intensity{};
+			ColorRGB color{};
+			if (!(stream >> type) || !ReadVector3(stream, vector) || !(stream >> intensity) || !ReadColor(stream, color))
+				return fail("expected light <point|directional> <x y z> <intensity> <r g b>");
+
+			if (type == "point")
+				AddPointLight(vector, intensity, color);
+			else if (type == "directional")
+				AddDirectionalLight(vector.Normalized(), intensity, color);
+			else
+				return fail("unknown light type '" + type + "'");
+			lastLightIndex = static_cast<int>(m_Lights.size()) - 1;
+		}
+		else if (keyword == "follow_camera")
+		{
+			if (lastLightIndex < 0)
+				return fail("follow_camera needs a light before it");
+			m_CameraLightIndices.push_back(static_cast<size_t>(lastLightIndex));
+		}
+		else if (keyword == "triangle" || keyword == "translate" || keyword == "rotate_y" || keyword == "scale" || keyword == "bvh" || keyword == "animate")
+		{
+			if (!pLastMesh)
+				return fail(keyword + " needs a mesh before it");
+
+			if (keyword == "triangle")
+			{
+				Vector3 v0{}, v1{}, v2{};
+				if (!ReadVector3(stream, v0) || !ReadVector3(stream, v1) || !ReadVector3(stream, v2))
+					return fail("expected triangle <x y z> <x y z> <x y z>");
+				pLastMesh->AppendTriangle({ v0, v1, v2 }, true);
+				pLastMesh->UpdateAABB();
+			}
+			else if (keyword == "translate")
+			{
+				Vector3 translation{};
+				if (!ReadVector3(stream, translation))
+					return fail("expected translate <x y z>");
+				pLastMesh->Translate(translation);
+			}
+			else if (keyword == "rotate_y")
+			{
+				float yaw{};
+				if (!(stream >> yaw))
+					return fail("expected rotate_y <degrees>");
+				pLastMesh->RotateY(yaw * TO_RADIANS);
+			}
+			else if (keyword == "scale")
+			{
+				Vector3 scale{};
+				if (!ReadVector3(stream, scale))
+					return fail("expected scale <x y z>");
+				pLastMesh->Scale(scale);
+			}
+			else if (keyword == "bvh")
+			{
+				std::string method{}, layout{};
+				pLastMesh->pGeometry->bvhLayout = BVHLayout::Binary;
+				if (!(stream >> method) || !ParseBVHBuildMethod(method, pLastMesh->pGeometry->bvhBuildMethod))
+					return fail("expected bvh <sah|lbvh|lbvh_treelets> [quantized|wide4|wide8]");
+				if (stream >> layout && !ParseBVHLayout(layout, pLastMesh->pGeometry->bvhLayout))
+					return fail("expected bvh <sah|lbvh|lbvh_treelets> [quantized|wide4|wide8]");
+				//A cached mesh arrives with its SAH tree, clearing it makes Initialize build the tree again with this method
+				pLastMesh->pGeometry->bvh.Clear();
+			}
+			else
+			{
+				std::string type{};
+				MeshAnimation animation{ pLastMesh };
+				if (!(stream >> type))
+					return fail("expected animate <yaw_cosine|yaw <degrees per second>|wave <height> <waves per second>>");
+				if (type == "yaw_cosine")
+				{
+					animation.type = AnimationType::YawCosine;
+				}
+				else if (type == "yaw" && stream >> animation.speed)
+				{
+					animation.type = AnimationType::YawLinear;
+					animation.speed *= TO_RADIANS;
+				}
+				else if (type == "wave" && stream >> animation.height >> animation.speed)
+				{
+					animation.type = AnimationType::Wave;
+					animation.speed *= PI_2;
+				}
+				else
+				{
+					return fail("expected animate <yaw_cosine|yaw <degrees per second>|wave <height> <waves per second>>");
+				}
+				m_Animations.push_back(animation);
+			}
+		}
+		else
+		{
+			return fail("unknown statement '" + keyword + "'");
+		}
+
+		if (!(stream >> std::ws).eof())
+			return fail("unexpected text after the statement");
+	}
+
+	return true;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Scene.h"
+
+namespace dae
+{
+	/**
+	 * \brief Scene described by a text file, see Resources/Scenes for the shipped scenes
+	 *
+	 * One statement per line, '#' starts a comment, names cannot contain spaces:
+	 *   name <words...>
+	 *   camera <x y z> <fov> [<pitch> <yaw>]                         angles in degrees
+	 *   material <name> solid <r g b>
+	 *   material <name> lambert <r g b> <kd>
+	 *   material <name> lambertphong <r g b> <kd> <ks> <exponent>
+	 *   material <name> cooktorrance <r g b> <metal|dielectric> <roughness>
+	 *   sphere <x y z> <radius> <material>
+	 *   plane <x y z> <nx ny nz> <material>
+	 *   mesh <name> <backface|frontface|none> <material> obj <path>    path is relative to the scene file
+	 *   mesh <name> <backface|frontface|none> <material> empty
+	 *   instance <name> <mesh> <material>                              shares the geometry of an earlier mesh
+	 *   light point <x y z> <intensity> <r g b>
+	 *   light directional <dx dy dz> <intensity> <r g b>
+	 *
+	 * Modifiers apply to the last mesh or light:
+	 *   triangle <x y z> <x y z> <x y z>     appends a triangle to the mesh geometry
+	 *   translate <x y z>
+	 *   rotate_y <degrees>
+	 *   scale <x y z>
+	 *   bvh <sah|lbvh|lbvh_treelets> [quantized|wide4|wide8]   builder of the mesh geometry's BVH (sah), instances share it
+	 *                                        quantized traces single rays through 8 bit child bounds, see QuantizedBVH
+	 *                                        wide4 and wide8 trace them through 4 or 8 children per node, see WideBVH
+	 *   animate yaw_cosine                   swings between 0 and 360 degrees following the cosine of the total time
+	 *   animate yaw <degrees per second>
+	 *   animate wave <height> <waves per second>   moves the vertices up and down, the BVH of the geometry is refit every frame
+	 *   follow_camera                        the light is moved to the camera every frame
+	 *
+	 * Material 'default' is the solid red every scene starts with.
+	 * Meshes only build their BVH once the whole file is read, the top level BVH is built right after.
+	 */
+	class Scene_File final : public Scene
+	{
+	public:
+		explicit Scene_File(const std::string& path);
+		~Scene_File() override = default;
+
+		Scene_File(const Scene_File&) = delete;
+		Scene_File(Scene_File&&) noexcept = delete;
+		Scene_File& operator=(const Scene_File&) = delete;
+		Scene_File& operator=(Scene_File&&) noexcept = delete;
+
+		void Initialize() override;
+		void Update(Timer* pTimer) override;
+
+		//False if the file could not be opened or had an error, everything up to the faulty line is kept
+		bool IsLoaded() const { return m_IsLoaded; }
+
+	private:
+		enum class AnimationType
+		{
+			YawCosine,
+			YawLinear,
+			Wave
+		};
+
+		struct MeshAnimation
+		{
+			TriangleMesh* pMesh{};
+			AnimationType type{};
+			float speed{}; //radians per second, only used by YawLinear and Wave
+			float height{}; //only used by Wave
+			std::vector<Vector3> restPositions{}; //object space vertices the wave starts from, only used by Wave
+		};
+
+		std::string m_Path{};
+		bool m_IsLoaded{ false };
+
+		std::vector<MeshAnimation> m_Animations{};
+		std::vector<size_t> m_CameraLightIndices{};
+
+		bool Load();
+	};
+}
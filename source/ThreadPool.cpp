@@ -0,0 +1,140 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <string>
+
+#include "Profiler.h"
+
+using namespace dae;
+
+ThreadPool::ThreadPool(uint32_t numThreads)
+{
+	if (numThreads == 0)
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	m_Queues.reserve(numThreads);
+	for (uint32_t i{ 0 }; i < numThreads; ++i)
+	{
+		m_Queues.push_back(std::make_unique<WorkQueue>());
+	}
+
+	//The thread calling ParallelFor is worker 0, only the others get their own thread
+	m_Workers.reserve(numThreads - 1);
+	for (uint32_t i{ 1 }; i < numThreads; ++i)
+	{
+		m_Workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock{ m_Mutex };
+		m_IsShuttingDown = true;
+	}
+	m_WorkAvailable.notify_all();
+
+	for (std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::ParallelFor(uint32_t numTasks, const Task& task)
+{
+	if (numTasks == 0)
+		return;
+
+	//Contiguous runs keep neighbouring tiles on one worker, stealing evens out runs that turn out more expensive
+	const uint32_t numThreads{ GetThreadCount() };
+	for (uint32_t i{ 0 }; i < numThreads; ++i)
+	{
+		const uint32_t firstTask{ static_cast<uint32_t>(static_cast<uint64_t>(numTasks) * i / numThreads) };
+		const uint32_t endTask{ static_cast<uint32_t>(static_cast<uint64_t>(numTasks) * (i + 1) / numThreads) };
+
+		std::lock_guard lock{ m_Queues[i]->mutex };
+		for (uint32_t taskIndex{ firstTask }; taskIndex < endTask; ++taskIndex)
+		{
+			m_Queues[i]->tasks.push_back(taskIndex);
+		}
+	}
+
+	{
+		std::lock_guard lock{ m_Mutex };
+		m_pTask = &task;
+		m_NumBusyWorkers = static_cast<uint32_t>(m_Workers.size());
+		++m_Generation;
+	}
+	m_WorkAvailable.notify_all();
+
+	RunTasks(0);
+
+	//All queues are empty now, but the other workers can still be running their last task
+	PROFILE_ZONE("ThreadPool::Wait");
+	std::unique_lock lock{ m_Mutex };
+	m_WorkDone.wait(lock, [this]() { return m_NumBusyWorkers == 0; });
+	m_pTask = nullptr;
+}
+
+void ThreadPool::WorkerLoop(uint32_t threadIndex)
+{
+	Profiler::SetThreadName("Worker " + std::to_string(threadIndex));
+
+	uint64_t generation{ 0 };
+	while (true)
+	{
+		{
+			std::unique_lock lock{ m_Mutex };
+			m_WorkAvailable.wait(lock, [&]() { return m_IsShuttingDown || m_Generation != generation; });
+			if (m_IsShuttingDown)
+				return;
+			generation = m_Generation;
+		}
+
+		RunTasks(threadIndex);
+
+		std::lock_guard lock{ m_Mutex };
+		if (--m_NumBusyWorkers == 0)
+			m_WorkDone.notify_one();
+	}
+}
+
+void ThreadPool::RunTasks(uint32_t threadIndex)
+{
+	//No tasks are added while a ParallelFor runs, so once every queue is empty this worker is done
+	uint32_t taskIndex{};
+	while (PopTask(threadIndex, taskIndex) || StealTask(threadIndex, taskIndex))
+	{
+		(*m_pTask)(taskIndex, threadIndex);
+	}
+}
+
+bool ThreadPool::PopTask(uint32_t threadIndex, uint32_t& taskIndex)
+{
+	WorkQueue& queue{ *m_Queues[threadIndex] };
+	std::lock_guard lock{ queue.mutex };
+	if (queue.tasks.empty())
+		return false;
+
+	taskIndex = queue.tasks.front();
+	queue.tasks.pop_front();
+	return true;
+}
+
+bool ThreadPool::StealTask(uint32_t threadIndex, uint32_t& taskIndex)
+{
+	const uint32_t numThreads{ GetThreadCount() };
+	for (uint32_t offset{ 1 }; offset < numThreads; ++offset)
+	{
+		//Steal from the back, the victim keeps working through the front of its run
+		WorkQueue& queue{ *m_Queues[(threadIndex + offset) % numThreads] };
+		std::lock_guard lock{ queue.mutex };
+		if (queue.tasks.empty())
+			continue;
+
+		taskIndex = queue.tasks.back();
+		queue.tasks.pop_back();
+		return true;
+	}
+	return false;
+}
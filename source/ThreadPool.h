@@ -0,0 +1,62 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	//Persistent pool of worker threads with one task deque per worker
+	//Workers take tasks from the front of their own deque and steal from the back of the others once theirs runs dry
+	class ThreadPool final
+	{
+	public:
+		//Task callback, threadIndex is in [0, GetThreadCount()) and unique among the tasks running at the same time
+		using Task = std::function<void(uint32_t taskIndex, uint32_t threadIndex)>;
+
+		//numThreads includes the calling thread, 0 uses one thread per hardware thread
+		explicit ThreadPool(uint32_t numThreads = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) noexcept = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+		/**
+		 * \brief Runs task for every index in [0, numTasks) and returns once all of them are done
+		 * Indices are handed out in contiguous runs per worker, the calling thread works along as thread 0
+		 */
+		void ParallelFor(uint32_t numTasks, const Task& task);
+
+		uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Queues.size()); }
+
+	private:
+		struct WorkQueue
+		{
+			std::mutex mutex{};
+			std::deque<uint32_t> tasks{};
+		};
+
+		std::vector<std::unique_ptr<WorkQueue>> m_Queues{};
+		std::vector<std::thread> m_Workers{};
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_WorkAvailable{};
+		std::condition_variable m_WorkDone{};
+		uint64_t m_Generation{}; //incremented for every ParallelFor, wakes up the workers
+		uint32_t m_NumBusyWorkers{};
+		bool m_IsShuttingDown{ false };
+
+		const Task* m_pTask{};
+
+		void WorkerLoop(uint32_t threadIndex);
+		void RunTasks(uint32_t threadIndex);
+		bool PopTask(uint32_t threadIndex, uint32_t& taskIndex);
+		bool StealTask(uint32_t threadIndex, uint32_t& taskIndex);
+	};
+}
@@ -1,5 +1,6 @@
 #include "Timer.h"
 
+#include <cfloat>
 #include <iostream>
 #include <numeric>
 
@@ -24,6 +25,7 @@ void Timer::Reset()
 	m_StopTime = 0;
 	m_FPSTimer = 0.0f;
 	m_FPSCount = 0;
+	m_FixedTotalTime = 0.0f;
 	m_IsStopped = false;
 }
 
@@ -90,6 +92,14 @@ void Timer::Update()
 
 	m_TotalTime = (float)(((m_CurrentTime - m_PausedTime) - m_BaseTime) * m_SecondsPerCount);
 
+	//Fixed steps make animations independent of how long a frame took, e.g. for offline rendering
+	if (m_FixedTimeStep > 0.0f)
+	{
+		m_ElapsedTime = m_FixedTimeStep;
+		m_FixedTotalTime += m_FixedTimeStep;
+		m_TotalTime = m_FixedTotalTime;
+	}
+
 	//FPS LOGIC
 	m_FPSTimer += m_ElapsedTime;
 	++m_FPSCount;
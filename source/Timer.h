@@ -23,6 +23,8 @@ namespace dae
 		void Start();
 		void Update();
 		void Stop();
+		//Advances the timer by a constant step per Update instead of the measured time, 0 measures again
+		void SetFixedTimeStep(float seconds) { m_FixedTimeStep = seconds; }
 
 		uint32_t GetFPS() const { return m_FPS; };
 		float GetdFPS() const { return m_dFPS; };
@@ -47,6 +49,9 @@ namespace dae
 		float m_ElapsedUpperBound = 0.03f;
 		float m_FPSTimer = 0.0f;
 
+		float m_FixedTimeStep = 0.0f;
+		float m_FixedTotalTime = 0.0f;
+
 		bool m_IsStopped = true;
 		bool m_ForceElapsedUpperBound = false;
 
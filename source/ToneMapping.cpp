@@ -0,0 +1,170 @@
+#include "ToneMapping.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "SIMDMath.h"
+
+using namespace dae;
+
+namespace
+{
+	//Linear values are quantized to 12 bits before the sRGB lookup, fine enough to stay within one step of the exact curve
+	constexpr int SRGBTableSize{ 4096 };
+
+	const std::array<uint8_t, SRGBTableSize>& GetSRGBTable()
+	{
+		static const std::array<uint8_t, SRGBTableSize> table{ []()
+			{
+				std::array<uint8_t, SRGBTableSize> values{};
+				for (int i{ 0 }; i < SRGBTableSize; ++i)
+				{
+					const float linear{ static_cast<float>(i) / (SRGBTableSize - 1) };
+					const float encoded{ linear <= 0.0031308f ? 12.92f * linear : 1.055f * std::pow(linear, 1.f / 2.4f) - 0.055f };
+					values[i] = static_cast<uint8_t>(encoded * 255.f + .5f);
+				}
+				return values;
+			}() };
+		return table;
+	}
+
+	//Narkowicz's ACES fit
+	constexpr float AcesA{ 2.51f }, AcesB{ 0.03f }, AcesC{ 2.43f }, AcesD{ 0.59f }, AcesE{ 0.14f };
+
+	uint32_t Pack(uint32_t r, uint32_t g, uint32_t b)
+	{
+		return 0xFF000000u | r << 16 | g << 8 | b;
+	}
+
+	//Reference for the SIMD path, also resolves the pixels that do not fill a whole register
+	uint32_t ResolvePixel(float r, float g, float b, float scale, const ToneMappingSettings& settings, const uint8_t* pSRGBTable)
+	{
+		//Negative and NaN colors become black, like the max with zero in the SIMD path
+		float channels[3]{ std::max(0.f, r * scale), std::max(0.f, g * scale), std::max(0.f, b * scale) };
+		switch (settings.toneMapper)
+		{
+		case ToneMapper::Clamp:
+		{
+			const float maxValue{ std::max(channels[0], std::max(channels[1], channels[2])) };
+			if (maxValue > 1.f)
+			{
+				for (float& channel : channels)
+					channel /= maxValue;
+			}
+			break;
+		}
+		case ToneMapper::Reinhard:
+			for (float& channel : channels)
+				channel = channel / (1.f + channel);
+			break;
+		case ToneMapper::ACES:
+			for (float& channel : channels)
+				channel = std::min(channel * (AcesA * channel + AcesB) / (channel * (AcesC * channel + AcesD) + AcesE), 1.f);
+			break;
+		}
+
+		uint32_t bytes[3]{};
+		for (int i{ 0 }; i < 3; ++i)
+		{
+			bytes[i] = settings.encodeSRGB ?
+				pSRGBTable[static_cast<int>(channels[i] * (SRGBTableSize - 1) + .5f)] :
+				static_cast<uint32_t>(channels[i] * 255);
+		}
+		return Pack(bytes[0], bytes[1], bytes[2]);
+	}
+
+#if defined(SIMDMATH_SSE)
+	void ToneMap(Float4 (&channels)[3], ToneMapper toneMapper)
+	{
+		const Float4 one{ 1.f };
+		switch (toneMapper)
+		{
+		case ToneMapper::Clamp:
+		{
+			const Float4 maxValue{ Float4::Max(channels[0], Float4::Max(channels[1], channels[2])) };
+			const Float4 isOverOne{ maxValue > one };
+			for (Float4& channel : channels)
+				channel = Float4::Select(isOverOne, channel / maxValue, channel);
+			break;
+		}
+		case ToneMapper::Reinhard:
+			for (Float4& channel : channels)
+				channel = channel / (one + channel);
+			break;
+		case ToneMapper::ACES:
+			for (Float4& channel : channels)
+				channel = Float4::Min(channel * (Float4{ AcesA } * channel + Float4{ AcesB }) / (channel * (Float4{ AcesC } * channel + Float4{ AcesD }) + Float4{ AcesE }), one);
+			break;
+		}
+	}
+
+	//4 pixels per iteration, the same math as ResolvePixel
+	size_t Resolve_SSE(const float* pRed, const float* pGreen, const float* pBlue, size_t numPixels, float scale,
+	                   const ToneMappingSettings& settings, const uint8_t* pSRGBTable, uint32_t* pPixels)
+	{
+		const Float4 scales{ scale }, zero{ 0.f };
+		const size_t numWhole{ numPixels - numPixels % Float4::Width };
+		for (size_t i{ 0 }; i < numWhole; i += Float4::Width)
+		{
+			Float4 channels[3]{
+				Float4::Max(Float4::Load(pRed + i) * scales, zero),
+				Float4::Max(Float4::Load(pGreen + i) * scales, zero),
+				Float4::Max(Float4::Load(pBlue + i) * scales, zero) };
+			ToneMap(channels, settings.toneMapper);
+
+			if (settings.encodeSRGB)
+			{
+				const Float4 tableScale{ SRGBTableSize - 1 }, half{ .5f };
+				alignas(16) int32_t indices[3][Float4::Width];
+				for (int c{ 0 }; c < 3; ++c)
+					_mm_store_si128(reinterpret_cast<__m128i*>(indices[c]), _mm_cvttps_epi32((channels[c] * tableScale + half).v));
+
+				for (int lane{ 0 }; lane < Float4::Width; ++lane)
+					pPixels[i + lane] = Pack(pSRGBTable[indices[0][lane]], pSRGBTable[indices[1][lane]], pSRGBTable[indices[2][lane]]);
+			}
+			else
+			{
+				const Float4 byteScale{ 255.f };
+				const __m128i red{ _mm_cvttps_epi32((channels[0] * byteScale).v) };
+				const __m128i green{ _mm_cvttps_epi32((channels[1] * byteScale).v) };
+				const __m128i blue{ _mm_cvttps_epi32((channels[2] * byteScale).v) };
+				const __m128i pixels{ _mm_or_si128(_mm_or_si128(_mm_set1_epi32(static_cast<int>(0xFF000000u)), _mm_slli_epi32(red, 16)),
+					_mm_or_si128(_mm_slli_epi32(green, 8), blue)) };
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pPixels + i), pixels);
+			}
+		}
+		return numWhole;
+	}
+#endif
+}
+
+void ToneMapping::Resolve(const float* pRed, const float* pGreen, const float* pBlue, size_t numPixels, float sampleScale,
+                          const ToneMappingSettings& settings, uint32_t* pPixels)
+{
+	const float scale{ sampleScale * settings.exposure };
+	const uint8_t* pSRGBTable{ GetSRGBTable().data() };
+
+	size_t first{ 0 };
+#if defined(SIMDMATH_SSE)
+	first = Resolve_SSE(pRed, pGreen, pBlue, numPixels, scale, settings, pSRGBTable, pPixels);
+#endif
+	for (size_t i{ first }; i < numPixels; ++i)
+	{
+		pPixels[i] = ResolvePixel(pRed[i], pGreen[i], pBlue[i], scale, settings, pSRGBTable);
+	}
+}
+
+const char* ToneMapping::ToString(ToneMapper toneMapper)
+{
+	switch (toneMapper)
+	{
+	case ToneMapper::Clamp:
+		return "Clamp";
+	case ToneMapper::Reinhard:
+		return "Reinhard";
+	case ToneMapper::ACES:
+		return "ACES";
+	}
+	return "Unknown";
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace dae
+{
+	enum class ToneMapper
+	{
+		Clamp, //divides by the largest channel when it exceeds one, keeps the hue
+		Reinhard,
+		ACES //Narkowicz's fit of the ACES filmic curve
+	};
+
+	struct ToneMappingSettings
+	{
+		float exposure{ 1.f };
+		ToneMapper toneMapper{ ToneMapper::Clamp };
+		bool encodeSRGB{ false }; //the framebuffer has always stored linear values, so encoding is opt in
+	};
+
+	//Turns the linear float colors the renderer accumulates into the 0xAARRGGBB framebuffer
+	namespace ToneMapping
+	{
+		/**
+		 * \brief Exposure, tone mapping, optional sRGB encoding and packing of a range of pixels, 4 at a time with SSE2 on x64
+		 * \param pRed linear red of every pixel, likewise pGreen and pBlue
+		 * \param sampleScale multiplies every color before the exposure, 1 / sample count for accumulated colors
+		 * \param pPixels receives one 0xAARRGGBB pixel per color
+		 */
+		void Resolve(const float* pRed, const float* pGreen, const float* pBlue, size_t numPixels, float sampleScale,
+		             const ToneMappingSettings& settings, uint32_t* pPixels);
+
+		const char* ToString(ToneMapper toneMapper);
+	}
+}
@@ -0,0 +1,330 @@
+#include "TriangleSIMD.h"
+
+#include <bit>
+#include <cfloat>
+
+#include "DataTypes.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define TRIANGLE_SIMD_X64
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+namespace dae
+{
+	namespace
+	{
+		//+1: only positive determinants (front faces) can hit, -1: only negative ones, 0: both
+		float GetRequiredDeterminantSign(TriangleCullMode cullMode, const Ray& ray)
+		{
+			switch (cullMode)
+			{
+			case TriangleCullMode::BackFaceCulling:
+				return ray.castsShadow ? -1.f : 1.f;
+			case TriangleCullMode::FrontFaceCulling:
+				return ray.castsShadow ? 1.f : -1.f;
+			case TriangleCullMode::NoCulling:
+			default:
+				return 0.f;
+			}
+		}
+
+		//AnyHit returns the first lane that hits and leaves t, u and v alone, the closest lane only matters for closest hit rays
+		template<bool AnyHit>
+		int IntersectBlock_Scalar(const TriangleBlock& block, float requiredSign, const Ray& ray, float& t, float& u, float& v)
+		{
+			int closestLane{ -1 };
+			float closestT{ ray.max };
+			for (int lane{ 0 }; lane < static_cast<int>(TriangleBlockSize); ++lane)
+			{
+				const Vector3 edge1{ block.edge1X[lane], block.edge1Y[lane], block.edge1Z[lane] };
+				const Vector3 edge2{ block.edge2X[lane], block.edge2Y[lane], block.edge2Z[lane] };
+
+				const Vector3 pVector{ Vector3::Cross(ray.direction, edge2) };
+				const float determinant{ Vector3::Dot(edge1, pVector) };
+				if (determinant == 0.f || determinant * requiredSign < 0.f) continue;
+
+				const float invDeterminant{ 1.f / determinant };
+				const Vector3 tVector{ ray.origin.x - block.v0X[lane], ray.origin.y - block.v0Y[lane], ray.origin.z - block.v0Z[lane] };
+				const float hitU{ Vector3::Dot(tVector, pVector) * invDeterminant };
+				if (hitU < 0.f || hitU > 1.f) continue;
+
+				const Vector3 qVector{ Vector3::Cross(tVector, edge1) };
+				const float hitV{ Vector3::Dot(ray.direction, qVector) * invDeterminant };
+				if (hitV < 0.f || hitU + hitV > 1.f) continue;
+
+				const float hitT{ Vector3::Dot(edge2, qVector) * invDeterminant };
+				if (hitT < ray.min || hitT > closestT) continue;
+
+				if constexpr (AnyHit)
+					return lane;
+				closestT = hitT;
+				closestLane = lane;
+				t = hitT;
+				u = hitU;
+				v = hitV;
+			}
+			return closestLane;
+		}
+
+#if defined(TRIANGLE_SIMD_X64)
+		//Picks the closest of the lanes set in hitMask, lanes are only written back when they beat closestT
+		int ResolveClosestLane(int hitMask, int laneOffset, const float* hitT, const float* hitU, const float* hitV, float& closestT, float& t, float& u, float& v)
+		{
+			int closestLane{ -1 };
+			for (int lane{ 0 }; hitMask != 0; ++lane, hitMask >>= 1)
+			{
+				if ((hitMask & 1) && hitT[lane] <= closestT)
+				{
+					closestT = hitT[lane];
+					closestLane = laneOffset + lane;
+					t = hitT[lane];
+					u = hitU[lane];
+					v = hitV[lane];
+				}
+			}
+			return closestLane;
+		}
+
+		template<bool AnyHit>
+		int IntersectBlock_SSE(const TriangleBlock& block, float requiredSign, const Ray& ray, float& t, float& u, float& v)
+		{
+			const __m128 directionX{ _mm_set1_ps(ray.direction.x) };
+			const __m128 directionY{ _mm_set1_ps(ray.direction.y) };
+			const __m128 directionZ{ _mm_set1_ps(ray.direction.z) };
+			const __m128 originX{ _mm_set1_ps(ray.origin.x) };
+			const __m128 originY{ _mm_set1_ps(ray.origin.y) };
+			const __m128 originZ{ _mm_set1_ps(ray.origin.z) };
+			const __m128 zero{ _mm_setzero_ps() };
+			const __m128 one{ _mm_set1_ps(1.f) };
+			const __m128 rayMin{ _mm_set1_ps(ray.min) };
+
+			int closestLane{ -1 };
+			float closestT{ ray.max };
+			for (int offset{ 0 }; offset < static_cast<int>(TriangleBlockSize); offset += 4)
+			{
+				const __m128 edge1X{ _mm_load_ps(block.edge1X + offset) };
+				const __m128 edge1Y{ _mm_load_ps(block.edge1Y + offset) };
+				const __m128 edge1Z{ _mm_load_ps(block.edge1Z + offset) };
+				const __m128 edge2X{ _mm_load_ps(block.edge2X + offset) };
+				const __m128 edge2Y{ _mm_load_ps(block.edge2Y + offset) };
+				const __m128 edge2Z{ _mm_load_ps(block.edge2Z + offset) };
+
+				//pVector = direction x edge2
+				const __m128 pX{ _mm_sub_ps(_mm_mul_ps(directionY, edge2Z), _mm_mul_ps(directionZ, edge2Y)) };
+				const __m128 pY{ _mm_sub_ps(_mm_mul_ps(directionZ, edge2X), _mm_mul_ps(directionX, edge2Z)) };
+				const __m128 pZ{ _mm_sub_ps(_mm_mul_ps(directionX, edge2Y), _mm_mul_ps(directionY, edge2X)) };
+				const __m128 determinant{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge1X, pX), _mm_mul_ps(edge1Y, pY)), _mm_mul_ps(edge1Z, pZ)) };
+
+				__m128 mask{};
+				if (requiredSign > 0.f) mask = _mm_cmpgt_ps(determinant, zero);
+				else if (requiredSign < 0.f) mask = _mm_cmplt_ps(determinant, zero);
+				else mask = _mm_cmpneq_ps(determinant, zero);
+				if (_mm_movemask_ps(mask) == 0) continue;
+
+				const __m128 invDeterminant{ _mm_div_ps(one, determinant) };
+				const __m128 tX{ _mm_sub_ps(originX, _mm_load_ps(block.v0X + offset)) };
+				const __m128 tY{ _mm_sub_ps(originY, _mm_load_ps(block.v0Y + offset)) };
+				const __m128 tZ{ _mm_sub_ps(originZ, _mm_load_ps(block.v0Z + offset)) };
+				const __m128 hitU{ _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tX, pX), _mm_mul_ps(tY, pY)), _mm_mul_ps(tZ, pZ)), invDeterminant) };
+
+				//qVector = tVector x edge1
+				const __m128 qX{ _mm_sub_ps(_mm_mul_ps(tY, edge1Z), _mm_mul_ps(tZ, edge1Y)) };
+				const __m128 qY{ _mm_sub_ps(_mm_mul_ps(tZ, edge1X), _mm_mul_ps(tX, edge1Z)) };
+				const __m128 qZ{ _mm_sub_ps(_mm_mul_ps(tX, edge1Y), _mm_mul_ps(tY, edge1X)) };
+				const __m128 hitV{ _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, qX), _mm_mul_ps(directionY, qY)), _mm_mul_ps(directionZ, qZ)), invDeterminant) };
+				const __m128 hitT{ _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edge2X, qX), _mm_mul_ps(edge2Y, qY)), _mm_mul_ps(edge2Z, qZ)), invDeterminant) };
+
+				mask = _mm_and_ps(mask, _mm_cmpge_ps(hitU, zero));
+				mask = _mm_and_ps(mask, _mm_cmpge_ps(hitV, zero));
+				mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(hitU, hitV), one));
+				mask = _mm_and_ps(mask, _mm_cmpge_ps(hitT, rayMin));
+				mask = _mm_and_ps(mask, _mm_cmple_ps(hitT, _mm_set1_ps(closestT)));
+
+				const int hitMask{ _mm_movemask_ps(mask) };
+				if (hitMask == 0) continue;
+				if constexpr (AnyHit)
+					return offset + std::countr_zero(static_cast<unsigned>(hitMask));
+
+				alignas(16) float hitTs[4], hitUs[4], hitVs[4];
+				_mm_store_ps(hitTs, hitT);
+				_mm_store_ps(hitUs, hitU);
+				_mm_store_ps(hitVs, hitV);
+				const int lane{ ResolveClosestLane(hitMask, offset, hitTs, hitUs, hitVs, closestT, t, u, v) };
+				if (lane != -1) closestLane = lane;
+			}
+			return closestLane;
+		}
+
+		template<bool AnyHit>
+		TARGET_AVX2 int IntersectBlock_AVX2(const TriangleBlock& block, float requiredSign, const Ray& ray, float& t, float& u, float& v)
+		{
+			const __m256 directionX{ _mm256_set1_ps(ray.direction.x) };
+			const __m256 directionY{ _mm256_set1_ps(ray.direction.y) };
+			const __m256 directionZ{ _mm256_set1_ps(ray.direction.z) };
+			const __m256 zero{ _mm256_setzero_ps() };
+			const __m256 one{ _mm256_set1_ps(1.f) };
+
+			const __m256 edge1X{ _mm256_load_ps(block.edge1X) };
+			const __m256 edge1Y{ _mm256_load_ps(block.edge1Y) };
+			const __m256 edge1Z{ _mm256_load_ps(block.edge1Z) };
+			const __m256 edge2X{ _mm256_load_ps(block.edge2X) };
+			const __m256 edge2Y{ _mm256_load_ps(block.edge2Y) };
+			const __m256 edge2Z{ _mm256_load_ps(block.edge2Z) };
+
+			//pVector = direction x edge2
+			const __m256 pX{ _mm256_fmsub_ps(directionY, edge2Z, _mm256_mul_ps(directionZ, edge2Y)) };
+			const __m256 pY{ _mm256_fmsub_ps(directionZ, edge2X, _mm256_mul_ps(directionX, edge2Z)) };
+			const __m256 pZ{ _mm256_fmsub_ps(directionX, edge2Y, _mm256_mul_ps(directionY, edge2X)) };
+			const __m256 determinant{ _mm256_fmadd_ps(edge1X, pX, _mm256_fmadd_ps(edge1Y, pY, _mm256_mul_ps(edge1Z, pZ))) };
+
+			__m256 mask{};
+			if (requiredSign > 0.f) mask = _mm256_cmp_ps(determinant, zero, _CMP_GT_OQ);
+			else if (requiredSign < 0.f) mask = _mm256_cmp_ps(determinant, zero, _CMP_LT_OQ);
+			else mask = _mm256_cmp_ps(determinant, zero, _CMP_NEQ_OQ);
+			if (_mm256_movemask_ps(mask) == 0) return -1;
+
+			const __m256 invDeterminant{ _mm256_div_ps(one, determinant) };
+			const __m256 tX{ _mm256_sub_ps(_mm256_set1_ps(ray.origin.x), _mm256_load_ps(block.v0X)) };
+			const __m256 tY{ _mm256_sub_ps(_mm256_set1_ps(ray.origin.y), _mm256_load_ps(block.v0Y)) };
+			const __m256 tZ{ _mm256_sub_ps(_mm256_set1_ps(ray.origin.z), _mm256_load_ps(block.v0Z)) };
+			const __m256 hitU{ _mm256_mul_ps(_mm256_fmadd_ps(tX, pX, _mm256_fmadd_ps(tY, pY, _mm256_mul_ps(tZ, pZ))), invDeterminant) };
+
+			//qVector = tVector x edge1
+			const __m256 qX{ _mm256_fmsub_ps(tY, edge1Z, _mm256_mul_ps(tZ, edge1Y)) };
+			const __m256 qY{ _mm256_fmsub_ps(tZ, edge1X, _mm256_mul_ps(tX, edge1Z)) };
+			const __m256 qZ{ _mm256_fmsub_ps(tX, edge1Y, _mm256_mul_ps(tY, edge1X)) };
+			const __m256 hitV{ _mm256_mul_ps(_mm256_fmadd_ps(directionX, qX, _mm256_fmadd_ps(directionY, qY, _mm256_mul_ps(directionZ, qZ))), invDeterminant) };
+			const __m256 hitT{ _mm256_mul_ps(_mm256_fmadd_ps(edge2X, qX, _mm256_fmadd_ps(edge2Y, qY, _mm256_mul_ps(edge2Z, qZ))), invDeterminant) };
+
+			mask = _mm256_and_ps(mask, _mm256_cmp_ps(hitU, zero, _CMP_GE_OQ));
+			mask = _mm256_and_ps(mask, _mm256_cmp_ps(hitV, zero, _CMP_GE_OQ));
+			mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(hitU, hitV), one, _CMP_LE_OQ));
+			mask = _mm256_and_ps(mask, _mm256_cmp_ps(hitT, _mm256_set1_ps(ray.min), _CMP_GE_OQ));
+			mask = _mm256_and_ps(mask, _mm256_cmp_ps(hitT, _mm256_set1_ps(ray.max), _CMP_LE_OQ));
+
+			const int hitMask{ _mm256_movemask_ps(mask) };
+			if (hitMask == 0) return -1;
+			if constexpr (AnyHit)
+				return std::countr_zero(static_cast<unsigned>(hitMask));
+
+			alignas(32) float hitTs[8], hitUs[8], hitVs[8];
+			_mm256_store_ps(hitTs, hitT);
+			_mm256_store_ps(hitUs, hitU);
+			_mm256_store_ps(hitVs, hitV);
+			float closestT{ ray.max };
+			return ResolveClosestLane(hitMask, 0, hitTs, hitUs, hitVs, closestT, t, u, v);
+		}
+#endif
+
+		SIMDLevel DetectSupportedLevel()
+		{
+#if defined(TRIANGLE_SIMD_X64)
+#if defined(_MSC_VER)
+			int info[4]{};
+			__cpuid(info, 0);
+			const int maxLeaf{ info[0] };
+
+			__cpuid(info, 1);
+			const bool hasOSXSave{ (info[2] & (1 << 27)) != 0 };
+			const bool hasAVX{ (info[2] & (1 << 28)) != 0 };
+			const bool hasFMA{ (info[2] & (1 << 12)) != 0 };
+			//The OS has to save the YMM registers on context switches as well
+			const bool osSavesYMM{ hasOSXSave && (_xgetbv(0) & 6) == 6 };
+
+			bool hasAVX2{ false };
+			if (maxLeaf >= 7)
+			{
+				__cpuidex(info, 7, 0);
+				hasAVX2 = (info[1] & (1 << 5)) != 0;
+			}
+
+			if (hasAVX && hasFMA && hasAVX2 && osSavesYMM)
+				return SIMDLevel::AVX2;
+#else
+			if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+				return SIMDLevel::AVX2;
+#endif
+			//SSE2 is part of the x64 baseline
+			return SIMDLevel::SSE;
+#else
+			return SIMDLevel::Scalar;
+#endif
+		}
+
+		const SIMDLevel g_SupportedLevel{ DetectSupportedLevel() };
+		SIMDLevel g_ActiveLevel{ g_SupportedLevel };
+	}
+
+	SIMDLevel TriangleSIMD::GetSupportedLevel()
+	{
+		return g_SupportedLevel;
+	}
+
+	SIMDLevel TriangleSIMD::GetActiveLevel()
+	{
+		return g_ActiveLevel;
+	}
+
+	void TriangleSIMD::SetActiveLevel(SIMDLevel level)
+	{
+		g_ActiveLevel = static_cast<int>(level) > static_cast<int>(g_SupportedLevel) ? g_SupportedLevel : level;
+	}
+
+	const char* TriangleSIMD::ToString(SIMDLevel level)
+	{
+		switch (level)
+		{
+		case SIMDLevel::Scalar: return "Scalar";
+		case SIMDLevel::SSE: return "SSE";
+		case SIMDLevel::AVX2: return "AVX2";
+		default: return "Unknown";
+		}
+	}
+
+	int TriangleSIMD::IntersectBlock(const TriangleBlock& block, TriangleCullMode cullMode, const Ray& ray, float& t, float& u, float& v)
+	{
+		return IntersectBlock(g_ActiveLevel, block, cullMode, ray, t, u, v);
+	}
+
+	int TriangleSIMD::IntersectBlock(SIMDLevel level, const TriangleBlock& block, TriangleCullMode cullMode, const Ray& ray, float& t, float& u, float& v)
+	{
+		const float requiredSign{ GetRequiredDeterminantSign(cullMode, ray) };
+		switch (level)
+		{
+#if defined(TRIANGLE_SIMD_X64)
+		case SIMDLevel::AVX2:
+			return IntersectBlock_AVX2<false>(block, requiredSign, ray, t, u, v);
+		case SIMDLevel::SSE:
+			return IntersectBlock_SSE<false>(block, requiredSign, ray, t, u, v);
+#endif
+		case SIMDLevel::Scalar:
+		default:
+			return IntersectBlock_Scalar<false>(block, requiredSign, ray, t, u, v);
+		}
+	}
+
+	int TriangleSIMD::OccludeBlock(const TriangleBlock& block, TriangleCullMode cullMode, const Ray& ray)
+	{
+		const float requiredSign{ GetRequiredDeterminantSign(cullMode, ray) };
+		float t{}, u{}, v{};
+		switch (g_ActiveLevel)
+		{
+#if defined(TRIANGLE_SIMD_X64)
+		case SIMDLevel::AVX2:
+			return IntersectBlock_AVX2<true>(block, requiredSign, ray, t, u, v);
+		case SIMDLevel::SSE:
+			return IntersectBlock_SSE<true>(block, requiredSign, ray, t, u, v);
+#endif
+		case SIMDLevel::Scalar:
+		default:
+			return IntersectBlock_Scalar<true>(block, requiredSign, ray, t, u, v);
+		}
+	}
+}
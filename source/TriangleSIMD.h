@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+
+namespace dae
+{
+	struct Ray;
+	enum class TriangleCullMode;
+
+	constexpr uint32_t TriangleBlockSize{ 8 };
+
+	//Structure of arrays layout of 8 precomputed triangles, unused lanes are zeroed and can never be hit
+	struct alignas(32) TriangleBlock
+	{
+		float v0X[TriangleBlockSize]{};
+		float v0Y[TriangleBlockSize]{};
+		float v0Z[TriangleBlockSize]{};
+		float edge1X[TriangleBlockSize]{};
+		float edge1Y[TriangleBlockSize]{};
+		float edge1Z[TriangleBlockSize]{};
+		float edge2X[TriangleBlockSize]{};
+		float edge2Y[TriangleBlockSize]{};
+		float edge2Z[TriangleBlockSize]{};
+	};
+
+	enum class SIMDLevel
+	{
+		Scalar,
+		SSE,
+		AVX2
+	};
+
+	namespace TriangleSIMD
+	{
+		//Highest level supported by both the CPU and the OS, detected once through CPUID
+		SIMDLevel GetSupportedLevel();
+		SIMDLevel GetActiveLevel();
+		//Selects the kernel used by IntersectBlock, clamped to the supported level
+		void SetActiveLevel(SIMDLevel level);
+		const char* ToString(SIMDLevel level);
+
+		/**
+		 * \brief Moller-Trumbore test of a ray against all 8 triangles of a block, with the same culling rules as HitTest_Triangle
+		 * \param t distance to the closest hit, only written on a hit
+		 * \param u barycentric weight of v1 of the closest hit, only written on a hit
+		 * \param v barycentric weight of v2 of the closest hit, only written on a hit
+		 * \return lane of the closest hit inside [ray.min, ray.max], -1 on a miss
+		 */
+		int IntersectBlock(const TriangleBlock& block, TriangleCullMode cullMode, const Ray& ray, float& t, float& u, float& v);
+		int IntersectBlock(SIMDLevel level, const TriangleBlock& block, TriangleCullMode cullMode, const Ray& ray, float& t, float& u, float& v);
+		//Occlusion variant of IntersectBlock, returns the first lane hit inside [ray.min, ray.max] without looking for the closest one, -1 on a miss
+		int OccludeBlock(const TriangleBlock& block, TriangleCullMode cullMode, const Ray& ray);
+	}
+}
@@ -1,8 +1,13 @@
 #pragma once
+#include <bit>
 #include <cassert>
-#include <fstream>
+#include <type_traits>
 #include "Math.h"
 #include "DataTypes.h"
+#include "RayPacket.h"
+#include "SIMDMath.h"
+#include "RayStats.h"
+#include "ObjLoader.h"
 #include <iostream>
 
 namespace dae
@@ -13,6 +18,7 @@ namespace dae
 		//SPHERE HIT-TESTS
 		inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
 		{
+			RayStats::Add(RayCounter::SphereTests);
 			const float a{ Vector3::Dot(ray.direction, ray.direction) };
 			const float b{ Vector3::Dot(2*ray.direction, ray.origin - sphere.origin) };
 			const float c{ Vector3::Dot(ray.origin - sphere.origin, ray.origin - sphere.origin) - Square(sphere.radius) };
@@ -30,7 +36,7 @@ namespace dae
 					{
 						hitRecord.origin = ray.origin + t * ray.direction;
 						hitRecord.t = t;
-						hitRecord.materialIndex = sphere.materialIndex;
+						hitRecord.material = sphere.material;
 						hitRecord.didHit = true;
 						hitRecord.normal = Vector3{ hitRecord.origin - sphere.origin }.Normalized();
 					}
@@ -45,11 +51,57 @@ namespace dae
 			HitRecord temp{};
 			return HitTest_Sphere(sphere, ray, temp, true);
 		}
+
+		/**
+		 * \brief Sphere test for every packet lane in mask, the shared origin makes c the same for all lanes
+		 * \param hitRecords one record per lane, only overwritten for lanes that hit the sphere before their packet.max
+		 * \return lanes that hit the sphere, their packet.max is shrunk to the hit distance
+		 */
+		inline RayPacketMask HitTest_Sphere(const Sphere& sphere, RayPacket& packet, RayPacketMask mask, HitRecord* hitRecords)
+		{
+			RayStats::Add(RayCounter::SphereTests, std::popcount(mask));
+			const Vector3 offset{ packet.origin - sphere.origin };
+			const Vector3x8 offsets{ offset };
+			const Float8 c{ Vector3::Dot(offset, offset) - Square(sphere.radius) };
+			const Float8 two{ 2.f }, four{ 4.f }, zero{ 0.f }, min{ packet.min };
+
+			//8 lanes at a time, the lanes whose t lies inside (min, max) are collected into inRange
+			float t[RayPacketSize];
+			RayPacketMask inRange{ 0 };
+			for (int lane{ 0 }; lane < RayPacketSize; lane += Float8::Width)
+			{
+				const Vector3x8 direction{ Vector3x8::Load(packet.directionX + lane, packet.directionY + lane, packet.directionZ + lane) };
+				const Float8 a{ Vector3x8::Dot(direction, direction) };
+				const Float8 b{ two * Vector3x8::Dot(direction, offsets) };
+				const Float8 discriminant{ b * b - four * a * c };
+				const Float8 laneT{ (-b - Float8::Sqrt(Float8::Max(discriminant, zero))) / (two * a) };
+				laneT.Store(t + lane);
+
+				const Float8 hits{ (discriminant > zero) & (laneT > min) & (laneT < Float8::Load(packet.max + lane)) };
+				inRange |= static_cast<RayPacketMask>(hits.MoveMask()) << lane;
+			}
+
+			RayPacketMask hitMask{ 0 };
+			for (RayPacketMask remaining{ mask & inRange }; remaining != 0; remaining &= remaining - 1)
+			{
+				const int lane{ std::countr_zero(remaining) };
+				HitRecord& hitRecord{ hitRecords[lane] };
+				hitRecord.origin = packet.origin + t[lane] * packet.GetDirection(lane);
+				hitRecord.t = t[lane];
+				hitRecord.material = sphere.material;
+				hitRecord.didHit = true;
+				hitRecord.normal = Vector3{ hitRecord.origin - sphere.origin }.Normalized();
+				packet.max[lane] = t[lane];
+				hitMask |= RayPacketMask{ 1 } << lane;
+			}
+			return hitMask;
+		}
 #pragma endregion
 #pragma region Plane HitTest
 		//PLANE HIT-TESTS
 		inline bool HitTest_Plane(const Plane& plane, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
 		{
+			RayStats::Add(RayCounter::PlaneTests);
 			const float t{ Vector3::Dot((plane.origin - ray.origin), plane.normal) / Vector3::Dot(ray.direction, plane.normal) };
 
 			if (t > ray.min && t < ray.max)
@@ -59,7 +111,7 @@ namespace dae
 				{
 					hitRecord.t = t;
 					hitRecord.didHit = true;
-					hitRecord.materialIndex = plane.materialIndex;
+					hitRecord.material = plane.material;
 					hitRecord.normal = plane.normal;
 					hitRecord.origin = intersectionPoint;
 				}
@@ -74,6 +126,40 @@ namespace dae
 			HitRecord temp{};
 			return HitTest_Plane(plane, ray, temp, true);
 		}
+
+		/**
+		 * \brief Plane test for every packet lane in mask, the distance to the plane is shared since all lanes start at the same origin
+		 * \param hitRecords one record per lane, only overwritten for lanes that hit the plane before their packet.max
+		 * \return lanes that hit the plane, their packet.max is shrunk to the hit distance
+		 */
+		inline RayPacketMask HitTest_Plane(const Plane& plane, RayPacket& packet, RayPacketMask mask, HitRecord* hitRecords)
+		{
+			RayStats::Add(RayCounter::PlaneTests, std::popcount(mask));
+			const float distance{ Vector3::Dot((plane.origin - packet.origin), plane.normal) };
+			float t[RayPacketSize];
+			for (int lane{ 0 }; lane < RayPacketSize; ++lane)
+			{
+				t[lane] = distance / (packet.directionX[lane] * plane.normal.x + packet.directionY[lane] * plane.normal.y + packet.directionZ[lane] * plane.normal.z);
+			}
+
+			RayPacketMask hitMask{ 0 };
+			for (RayPacketMask remaining{ mask }; remaining != 0; remaining &= remaining - 1)
+			{
+				const int lane{ std::countr_zero(remaining) };
+				if (t[lane] <= packet.min || t[lane] >= packet.max[lane])
+					continue;
+
+				HitRecord& hitRecord{ hitRecords[lane] };
+				hitRecord.t = t[lane];
+				hitRecord.didHit = true;
+				hitRecord.material = plane.material;
+				hitRecord.normal = plane.normal;
+				hitRecord.origin = packet.origin + t[lane] * packet.GetDirection(lane);
+				packet.max[lane] = t[lane];
+				hitMask |= RayPacketMask{ 1 } << lane;
+			}
+			return hitMask;
+		}
 #pragma endregion
 #pragma region Triangle HitTest
 		//TRIANGLE HIT-TESTS
@@ -126,7 +212,7 @@ namespace dae
 				hitRecord.normal = normal;
 				hitRecord.origin = p;
 				hitRecord.t = t;
-				hitRecord.materialIndex = triangle.materialIndex;
+				hitRecord.material = triangle.material;
 			}
 			return true;
 		}
@@ -136,54 +222,545 @@ namespace dae
 			HitRecord temp{};
 			return HitTest_Triangle(triangle, ray, temp, true);
 		}
+
+		/**
+		 * \brief Moller-Trumbore intersection against a precomputed triangle
+		 * \param t distance along the ray, only written on a hit
+		 * \param u barycentric weight of v1, only written on a hit
+		 * \param v barycentric weight of v2, only written on a hit
+		 */
+		inline bool HitTest_Triangle(const PrecomputedTriangle& triangle, TriangleCullMode cullMode, const Ray& ray, float& t, float& u, float& v)
+		{
+			//det == -dot(edge1 x edge2, direction), so a negative determinant means the ray hits the back face
+			const Vector3 pVector{ Vector3::Cross(ray.direction, triangle.edge2) };
+			const float determinant{ Vector3::Dot(triangle.edge1, pVector) };
+			if (determinant == 0.f) return false;
+
+			//Shadow rays travel away from the surface, so the culled side is inverted for them
+			switch (cullMode)
+			{
+			case TriangleCullMode::BackFaceCulling:
+				if (ray.castsShadow ? determinant > 0.f : determinant < 0.f) return false;
+				break;
+			case TriangleCullMode::FrontFaceCulling:
+				if (ray.castsShadow ? determinant < 0.f : determinant > 0.f) return false;
+				break;
+			case TriangleCullMode::NoCulling: break;
+			}
+
+			const float invDeterminant{ 1.f / determinant };
+			const Vector3 tVector{ ray.origin - triangle.v0 };
+			const float hitU{ Vector3::Dot(tVector, pVector) * invDeterminant };
+			if (hitU < 0.f || hitU > 1.f) return false;
+
+			const Vector3 qVector{ Vector3::Cross(tVector, triangle.edge1) };
+			const float hitV{ Vector3::Dot(ray.direction, qVector) * invDeterminant };
+			if (hitV < 0.f || hitU + hitV > 1.f) return false;
+
+			const float hitT{ Vector3::Dot(triangle.edge2, qVector) * invDeterminant };
+			if (hitT < ray.min || hitT > ray.max) return false;
+
+			t = hitT;
+			u = hitU;
+			v = hitV;
+			return true;
+		}
 #pragma endregion
 #pragma region TriangeMesh HitTest
-		inline bool SlabTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
+		/**
+		 * \brief Slab test against an axis aligned box
+		 * \param invDirection component wise inverse of the ray direction
+		 * \param maxT closest distance found so far
+		 * \return distance to the box entry point, FLT_MAX on a miss
+		 */
+		inline float SlabTest_AABB(const Vector3& minAABB, const Vector3& maxAABB, const Ray& ray, const Vector3& invDirection, float maxT)
 		{
-			const float tx1{ (mesh.transformedMinAABB.x - ray.origin.x) / ray.direction.x };
-			const float tx2{ (mesh.transformedMaxAABB.x - ray.origin.x) / ray.direction.x };
+			const float tx1{ (minAABB.x - ray.origin.x) * invDirection.x };
+			const float tx2{ (maxAABB.x - ray.origin.x) * invDirection.x };
 
 			float tMin{ std::min(tx1, tx2) };
 			float tMax{ std::max(tx1, tx2) };
 
-			const float ty1{ (mesh.transformedMinAABB.y - ray.origin.y) / ray.direction.y };
-			const float ty2{ (mesh.transformedMaxAABB.y - ray.origin.y) / ray.direction.y };
+			const float ty1{ (minAABB.y - ray.origin.y) * invDirection.y };
+			const float ty2{ (maxAABB.y - ray.origin.y) * invDirection.y };
 
-			tMin = std::min( tMin, std::min(ty1, ty2));
-			tMax = std::max(tMax, std::max(ty1, ty2));
+			tMin = std::max(tMin, std::min(ty1, ty2));
+			tMax = std::min(tMax, std::max(ty1, ty2));
 
-			const float tz1{ (mesh.transformedMinAABB.z - ray.origin.z) / ray.direction.z };
-			const float tz2{ (mesh.transformedMaxAABB.z - ray.origin.z) / ray.direction.z };
+			const float tz1{ (minAABB.z - ray.origin.z) * invDirection.z };
+			const float tz2{ (maxAABB.z - ray.origin.z) * invDirection.z };
 
-			tMin = std::min( tMin, std::min(tz1, tz2));
-			tMax = std::max(tMax,std::max(tz1, tz2));
+			tMin = std::max(tMin, std::min(tz1, tz2));
+			tMax = std::min(tMax, std::max(tz1, tz2));
 
-			return tMax > 0 && tMax >= tMin;
+			if (tMax >= tMin && tMax > ray.min && tMin < maxT)
+				return tMin;
+			return FLT_MAX;
 		}
 
-		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		inline bool SlabTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
 		{
-			if (!SlabTest_TriangleMesh(mesh, ray))
-				return false;
+			const Vector3 invDirection{ 1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z };
+			return SlabTest_AABB(mesh.transformedMinAABB, mesh.transformedMaxAABB, ray, invDirection, ray.max) != FLT_MAX;
+		}
+
+		//Lanes of mask that can hit the mesh bounds, a box outside the packet frustum rejects all of them at once
+		inline RayPacketMask SlabTest_TriangleMesh(const TriangleMesh& mesh, const RayPacket& packet, RayPacketMask mask)
+		{
+			if (!packet.FrustumTest_AABB(mesh.transformedMinAABB, mesh.transformedMaxAABB))
+				return 0;
+			return packet.SlabTest_AABB(mesh.transformedMinAABB, mesh.transformedMaxAABB, mask);
+		}
+
+		/**
+		 * \brief Front to back traversal of a BVH, nodes that start behind ray.max are skipped
+		 * \param intersectLeaf callable (const BVHNode& leaf, Ray& ray) -> bool, shrinks ray.max on a hit and returns true to stop the traversal
+		 * \param rootIndex node the traversal starts from, only its subtree is visited
+		 */
+		template<typename IntersectLeaf>
+		inline void TraverseBVHLeaves(const BVH& bvh, Ray& ray, IntersectLeaf&& intersectLeaf, uint32_t rootIndex = 0)
+		{
+			const std::vector<BVHNode>& nodes{ bvh.GetNodes() };
+			if (nodes.empty())
+				return;
+
+			const Vector3 invDirection{ 1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z };
+			if (SlabTest_AABB(nodes[rootIndex].minAABB, nodes[rootIndex].maxAABB, ray, invDirection, ray.max) == FLT_MAX)
+			{
+				RayStats::Add(RayCounter::BVHNodeVisits);
+				return;
+			}
 
-			HitRecord tempRecord;
-			for (int currentTriangle{ 0 }; currentTriangle < mesh.indices.size()-2; currentTriangle += 3)
+			struct StackEntry
+			{
+				uint32_t nodeIndex;
+				float t;
+			};
+			StackEntry stack[BVH::MaxDepth + 1];
+			int stackSize{ 0 };
+			uint32_t nodeIndex{ rootIndex };
+			uint64_t numVisitedNodes{ 0 };
+
+			while (true)
 			{
-				const Vector3 v0{ mesh.transformedPositions[mesh.indices[currentTriangle]] };
-				const Vector3 v1{ mesh.transformedPositions[mesh.indices[currentTriangle + 1]] };
-				const Vector3 v2{ mesh.transformedPositions[mesh.indices[currentTriangle + 2]] };
-				Triangle newTriangle{ v0, v1, v2 };
-				newTriangle.materialIndex = mesh.materialIndex;
-				newTriangle.normal = mesh.transformedNormals[currentTriangle/3];
-				newTriangle.cullMode = mesh.cullMode;
-				if (HitTest_Triangle(newTriangle, ray, tempRecord, ignoreHitRecord))
+				++numVisitedNodes;
+				const BVHNode& node{ nodes[nodeIndex] };
+				if (node.IsLeaf())
 				{
-					if (ignoreHitRecord) return true;
-					if (tempRecord.t < hitRecord.t) hitRecord = tempRecord;
+					if (intersectLeaf(node, ray))
+						break;
 				}
+				else
+				{
+					//Visit the nearest child first, the other one is only visited if it starts before the closest hit
+					uint32_t nearChild{ node.leftFirst };
+					uint32_t farChild{ node.leftFirst + 1 };
+					float nearT{ SlabTest_AABB(nodes[nearChild].minAABB, nodes[nearChild].maxAABB, ray, invDirection, ray.max) };
+					float farT{ SlabTest_AABB(nodes[farChild].minAABB, nodes[farChild].maxAABB, ray, invDirection, ray.max) };
+					if (farT < nearT)
+					{
+						std::swap(nearChild, farChild);
+						std::swap(nearT, farT);
+					}
+
+					if (nearT != FLT_MAX)
+					{
+						if (farT != FLT_MAX)
+							stack[stackSize++] = { farChild, farT };
+						nodeIndex = nearChild;
+						continue;
+					}
+				}
+
+				//Pop the next node that still lies in front of the closest hit
+				while (stackSize > 0 && stack[stackSize - 1].t >= ray.max)
+					--stackSize;
+				if (stackSize == 0)
+					break;
+				nodeIndex = stack[--stackSize].nodeIndex;
 			}
-			if (hitRecord.didHit) return true;
-			return false;
+			RayStats::Add(RayCounter::BVHNodeVisits, numVisitedNodes);
+		}
+
+		/**
+		 * \brief SlabTest_AABB against the dequantized bounds of a quantized child
+		 * \param minAABB receives the dequantized minimum, the frame origin of the child's own children
+		 */
+		inline float SlabTest_QuantizedChild(const QuantizedBVHChild& child, const Vector3& frameMin, const Vector3& scale, const Ray& ray,
+		                                     const Vector3& invDirection, Vector3& minAABB)
+		{
+#if defined(SIMDMATH_SSE)
+			//Bytes minX..maxZ widened to two xyz vectors, the w lanes hold maxX and exponentX and are overwritten before the reduction
+			const __m128i zero{ _mm_setzero_si128() };
+			const __m128i bytes{ _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&child)), zero) };
+			const __m128 minSteps{ _mm_cvtepi32_ps(_mm_unpacklo_epi16(bytes, zero)) };
+			const __m128 maxSteps{ _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_srli_si128(bytes, 6), zero)) };
+
+			const __m128 frameMin4{ _mm_setr_ps(frameMin.x, frameMin.y, frameMin.z, 0.f) };
+			const __m128 scale4{ _mm_setr_ps(scale.x, scale.y, scale.z, 0.f) };
+			const __m128 origin{ _mm_setr_ps(ray.origin.x, ray.origin.y, ray.origin.z, 0.f) };
+			const __m128 invDirection4{ _mm_setr_ps(invDirection.x, invDirection.y, invDirection.z, 0.f) };
+
+			const __m128 min4{ _mm_add_ps(frameMin4, _mm_mul_ps(minSteps, scale4)) };
+			const __m128 max4{ _mm_add_ps(frameMin4, _mm_mul_ps(maxSteps, scale4)) };
+			const __m128 t1{ _mm_mul_ps(_mm_sub_ps(min4, origin), invDirection4) };
+			const __m128 t2{ _mm_mul_ps(_mm_sub_ps(max4, origin), invDirection4) };
+
+			//Lane w repeats lane x so it never decides the reduction
+			__m128 tMin4{ _mm_min_ps(t1, t2) };
+			__m128 tMax4{ _mm_max_ps(t1, t2) };
+			tMin4 = _mm_shuffle_ps(tMin4, tMin4, _MM_SHUFFLE(0, 2, 1, 0));
+			tMax4 = _mm_shuffle_ps(tMax4, tMax4, _MM_SHUFFLE(0, 2, 1, 0));
+			tMin4 = _mm_max_ps(tMin4, _mm_shuffle_ps(tMin4, tMin4, _MM_SHUFFLE(1, 0, 3, 2)));
+			tMax4 = _mm_min_ps(tMax4, _mm_shuffle_ps(tMax4, tMax4, _MM_SHUFFLE(1, 0, 3, 2)));
+			const float tMin{ _mm_cvtss_f32(_mm_max_ss(tMin4, _mm_shuffle_ps(tMin4, tMin4, _MM_SHUFFLE(2, 3, 0, 1)))) };
+			const float tMax{ _mm_cvtss_f32(_mm_min_ss(tMax4, _mm_shuffle_ps(tMax4, tMax4, _MM_SHUFFLE(2, 3, 0, 1)))) };
+
+			alignas(16) float minValues[4];
+			_mm_store_ps(minValues, min4);
+			minAABB = Vector3{ minValues[0], minValues[1], minValues[2] };
+
+			if (tMax >= tMin && tMax > ray.min && tMin < ray.max)
+				return tMin;
+			return FLT_MAX;
+#else
+			Vector3 maxAABB{};
+			QuantizedBVH::GetChildAABB(child, frameMin, scale, minAABB, maxAABB);
+			return SlabTest_AABB(minAABB, maxAABB, ray, invDirection, ray.max);
+#endif
+		}
+
+		/**
+		 * \brief TraverseBVHLeaves over a QuantizedBVH, child boxes are dequantized in the frame of the node holding them
+		 * \param intersectLeaf same as for TraverseBVHLeaves, the leaf passed to it only has leftFirst and primitiveCount set
+		 */
+		template<typename IntersectLeaf>
+		inline void TraverseQuantizedBVHLeaves(const QuantizedBVH& bvh, Ray& ray, IntersectLeaf&& intersectLeaf)
+		{
+			if (bvh.IsEmpty())
+				return;
+
+			const Vector3 invDirection{ 1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z };
+			if (SlabTest_AABB(bvh.GetRootMinAABB(), bvh.GetRootMaxAABB(), ray, invDirection, ray.max) == FLT_MAX)
+			{
+				RayStats::Add(RayCounter::BVHNodeVisits);
+				return;
+			}
+
+			//Only the parent knows the rounded minimum and the frame step of a node, so both travel with it
+			struct StackEntry
+			{
+				Vector3 frameMin;
+				Vector3 scale;
+				uint32_t leftFirst;
+				uint32_t primitiveCount;
+				float t;
+			};
+			StackEntry stack[BVH::MaxDepth + 1];
+			int stackSize{ 0 };
+			StackEntry current{ bvh.GetRootMinAABB(), bvh.GetRootScale(), bvh.GetRootLeftFirst(), bvh.GetRootPrimitiveCount(), 0.f };
+			const std::vector<QuantizedBVHNode>& nodes{ bvh.GetNodes() };
+			uint64_t numVisitedNodes{ 0 };
+
+			while (true)
+			{
+				++numVisitedNodes;
+				if (current.primitiveCount > 0)
+				{
+					if (intersectLeaf(BVHNode{ {}, current.leftFirst, {}, current.primitiveCount }, ray))
+						break;
+				}
+				else
+				{
+					const QuantizedBVHNode& node{ nodes[current.leftFirst] };
+					Vector3 childMin[2]{};
+					float childT[2]{};
+					for (int i{ 0 }; i < 2; ++i)
+						childT[i] = SlabTest_QuantizedChild(node.children[i], current.frameMin, current.scale, ray, invDirection, childMin[i]);
+
+					//Visit the nearest child first, the other one is only visited if it starts before the closest hit
+					const int near{ childT[1] < childT[0] ? 1 : 0 };
+					const auto toEntry{ [&](int i)
+						{
+							const QuantizedBVHChild& child{ node.children[i] };
+							return StackEntry{ childMin[i], child.IsLeaf() ? Vector3{} : QuantizedBVH::GetChildScale(child), child.leftFirst, child.primitiveCount, childT[i] };
+						} };
+					if (childT[near] != FLT_MAX)
+					{
+						if (childT[1 - near] != FLT_MAX)
+							stack[stackSize++] = toEntry(1 - near);
+						current = toEntry(near);
+						continue;
+					}
+				}
+
+				//Pop the next node that still lies in front of the closest hit
+				while (stackSize > 0 && stack[stackSize - 1].t >= ray.max)
+					--stackSize;
+				if (stackSize == 0)
+					break;
+				current = stack[--stackSize];
+			}
+			RayStats::Add(RayCounter::BVHNodeVisits, numVisitedNodes);
+		}
+
+		/**
+		 * \brief TraverseBVHLeaves over a WideBVH, all children of a node are slab tested at once and visited nearest first
+		 * \param intersectLeaf same as for TraverseBVHLeaves, the leaf passed to it only has leftFirst and primitiveCount set
+		 */
+		template<int Width, typename IntersectLeaf>
+		inline void TraverseWideBVHLeaves(const WideBVH<Width>& bvh, Ray& ray, IntersectLeaf&& intersectLeaf)
+		{
+			using FloatN = std::conditional_t<Width == Float8::Width, Float8, Float4>;
+			static_assert(FloatN::Width == Width);
+
+			const std::vector<WideBVHNode<Width>>& nodes{ bvh.GetNodes() };
+			if (nodes.empty())
+				return;
+
+			const Vector3xN<FloatN> origin{ ray.origin };
+			const Vector3xN<FloatN> invDirection{ Vector3{ 1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z } };
+			const FloatN rayMin{ ray.min };
+
+			struct StackEntry
+			{
+				uint32_t leftFirst;
+				uint32_t primitiveCount;
+				float t;
+			};
+			StackEntry stack[WideBVH<Width>::MaxStackSize];
+			int stackSize{ 0 };
+			StackEntry current{ 0, 0, 0.f };
+			uint64_t numVisitedNodes{ 0 };
+
+			while (true)
+			{
+				++numVisitedNodes;
+				if (current.primitiveCount > 0)
+				{
+					if (intersectLeaf(BVHNode{ {}, current.leftFirst, {}, current.primitiveCount }, ray))
+						break;
+				}
+				else
+				{
+					const WideBVHNode<Width>& node{ nodes[current.leftFirst] };
+					const FloatN tx1{ (FloatN::Load(node.minX) - origin.x) * invDirection.x };
+					const FloatN tx2{ (FloatN::Load(node.maxX) - origin.x) * invDirection.x };
+					const FloatN ty1{ (FloatN::Load(node.minY) - origin.y) * invDirection.y };
+					const FloatN ty2{ (FloatN::Load(node.maxY) - origin.y) * invDirection.y };
+					const FloatN tz1{ (FloatN::Load(node.minZ) - origin.z) * invDirection.z };
+					const FloatN tz2{ (FloatN::Load(node.maxZ) - origin.z) * invDirection.z };
+					const FloatN tMin{ FloatN::Max(FloatN::Max(FloatN::Min(tx1, tx2), FloatN::Min(ty1, ty2)), FloatN::Min(tz1, tz2)) };
+					const FloatN tMax{ FloatN::Min(FloatN::Min(FloatN::Max(tx1, tx2), FloatN::Max(ty1, ty2)), FloatN::Max(tz1, tz2)) };
+					int hitMask{ ((tMax >= tMin) & (tMax > rayMin) & (tMin < FloatN{ ray.max })).MoveMask() };
+
+					if (hitMask != 0)
+					{
+						float childT[Width];
+						tMin.Store(childT);
+
+						//Hit children sorted far to near, all but the nearest go on the stack so they pop nearest first
+						StackEntry hits[Width];
+						int numHits{ 0 };
+						for (; hitMask != 0; hitMask &= hitMask - 1)
+						{
+							const int lane{ std::countr_zero(static_cast<unsigned>(hitMask)) };
+							const StackEntry hit{ node.leftFirst[lane], node.primitiveCount[lane], childT[lane] };
+							int i{ numHits++ };
+							for (; i > 0 && hits[i - 1].t < hit.t; --i)
+								hits[i] = hits[i - 1];
+							hits[i] = hit;
+						}
+						for (int i{ 0 }; i < numHits - 1; ++i)
+							stack[stackSize++] = hits[i];
+						current = hits[numHits - 1];
+						continue;
+					}
+				}
+
+				//Pop the next node that still lies in front of the closest hit
+				while (stackSize > 0 && stack[stackSize - 1].t >= ray.max)
+					--stackSize;
+				if (stackSize == 0)
+					break;
+				current = stack[--stackSize];
+			}
+			RayStats::Add(RayCounter::BVHNodeVisits, numVisitedNodes);
+		}
+
+		/**
+		 * \brief Front to back traversal of a BVH that visits the primitives of each leaf one by one
+		 * \param intersectPrimitive callable (uint32_t slot, Ray& ray) -> bool, shrinks ray.max on a hit and returns true to stop the traversal
+		 * Leaves pass primitive slots, BVH::GetPrimitiveIndices maps them back to the original primitive
+		 */
+		template<typename IntersectPrimitive>
+		inline void TraverseBVH(const BVH& bvh, Ray& ray, IntersectPrimitive&& intersectPrimitive)
+		{
+			TraverseBVHLeaves(bvh, ray, [&](const BVHNode& leaf, Ray& currentRay)
+				{
+					for (uint32_t i{ leaf.leftFirst }; i < leaf.leftFirst + leaf.primitiveCount; ++i)
+					{
+						if (intersectPrimitive(i, currentRay))
+							return true;
+					}
+					return false;
+				});
+		}
+
+		/**
+		 * \brief Front to back traversal of a BVH with a whole ray packet, one frustum test can reject a node for every ray at once
+		 * \param mask lanes of the packet that take part in the traversal
+		 * \param intersectLeaf callable (const BVHNode& leaf, RayPacket& packet, RayPacketMask mask) -> void, shrinks packet.max of the lanes it hits
+		 * Once fewer than RayPacketDivergenceThreshold rays are left in a subtree they finish it one by one with TraverseBVHLeaves
+		 */
+		template<typename IntersectLeaf>
+		inline void TraverseBVHPacket(const BVH& bvh, RayPacket& packet, RayPacketMask mask, IntersectLeaf&& intersectLeaf)
+		{
+			const std::vector<BVHNode>& nodes{ bvh.GetNodes() };
+			if (nodes.empty() || mask == 0)
+				return;
+
+			struct StackEntry
+			{
+				uint32_t nodeIndex;
+				RayPacketMask mask;
+			};
+			StackEntry stack[BVH::MaxDepth + 1];
+			int stackSize{ 0 };
+			stack[stackSize++] = { 0, mask };
+			uint64_t numVisitedNodes{ 0 };
+
+			while (stackSize > 0)
+			{
+				++numVisitedNodes;
+				const StackEntry entry{ stack[--stackSize] };
+				const BVHNode& node{ nodes[entry.nodeIndex] };
+				if (!packet.FrustumTest_AABB(node.minAABB, node.maxAABB))
+					continue;
+
+				const RayPacketMask activeMask{ packet.SlabTest_AABB(node.minAABB, node.maxAABB, entry.mask) };
+				if (activeMask == 0)
+					continue;
+
+				if (std::popcount(activeMask) < RayPacketDivergenceThreshold)
+				{
+					//The packet diverged, the few rays that are left are cheaper to trace on their own
+					for (RayPacketMask remaining{ activeMask }; remaining != 0; remaining &= remaining - 1)
+					{
+						const int lane{ std::countr_zero(remaining) };
+						Ray ray{ packet.GetRay(lane) };
+						TraverseBVHLeaves(bvh, ray, [&](const BVHNode& leaf, Ray& currentRay)
+							{
+								packet.max[lane] = currentRay.max;
+								intersectLeaf(leaf, packet, RayPacketMask{ 1 } << lane);
+								currentRay.max = packet.max[lane];
+								return false;
+							}, entry.nodeIndex);
+					}
+					continue;
+				}
+
+				if (node.IsLeaf())
+				{
+					intersectLeaf(node, packet, activeMask);
+					continue;
+				}
+
+				//The near child is the one lying first along the packet direction, on the axis that separates both children the most
+				const BVHNode& leftChild{ nodes[node.leftFirst] };
+				const BVHNode& rightChild{ nodes[node.leftFirst + 1] };
+				const Vector3 separation{ (rightChild.minAABB + rightChild.maxAABB) - (leftChild.minAABB + leftChild.maxAABB) };
+				int axis{ 0 };
+				if (std::abs(separation.y) > std::abs(separation[axis])) axis = 1;
+				if (std::abs(separation.z) > std::abs(separation[axis])) axis = 2;
+
+				const bool isLeftNear{ separation[axis] * packet.centerDirection[axis] >= 0.f };
+				stack[stackSize++] = { isLeftNear ? node.leftFirst + 1 : node.leftFirst, activeMask };
+				stack[stackSize++] = { isLeftNear ? node.leftFirst : node.leftFirst + 1, activeMask };
+			}
+			RayStats::Add(RayCounter::BVHNodeVisits, numVisitedNodes);
+		}
+
+		/**
+		 * \brief Tests a ray against the triangle blocks of a mesh BVH leaf, leaves are aligned to whole blocks so 8 triangles are tested at once
+		 * \param closestSlot slot of the closest triangle, only written on a hit
+		 * \param stopAtFirstHit return as soon as any triangle is hit
+		 * \return true if a triangle was hit, ray.max is shrunk to its distance
+		 */
+		inline bool HitTest_TriangleLeaf(const MeshGeometry& geometry, const BVHNode& leaf, TriangleCullMode cullMode, Ray& ray,
+			float& t, float& u, float& v, uint32_t& closestSlot, bool stopAtFirstHit)
+		{
+			bool didHit{ false };
+			const uint32_t firstBlock{ leaf.leftFirst / TriangleBlockSize };
+			const uint32_t endBlock{ (leaf.leftFirst + leaf.primitiveCount + TriangleBlockSize - 1) / TriangleBlockSize };
+			uint32_t block{ firstBlock };
+			for (; block < endBlock; ++block)
+			{
+				const int lane{ TriangleSIMD::IntersectBlock(geometry.triangleBlocks[block], cullMode, ray, t, u, v) };
+				if (lane == -1)
+					continue;
+
+				didHit = true;
+				closestSlot = block * TriangleBlockSize + lane;
+				ray.max = t;
+				if (stopAtFirstHit)
+				{
+					++block;
+					break;
+				}
+			}
+			RayStats::Add(RayCounter::TriangleTests, static_cast<uint64_t>(block - firstBlock) * TriangleBlockSize);
+			return didHit;
+		}
+
+		//Single ray traversal of a mesh BVH in the layout of the geometry, see MeshGeometry::bvhLayout
+		template<typename IntersectLeaf>
+		inline void TraverseMeshBVHLeaves(const MeshGeometry& geometry, Ray& ray, IntersectLeaf&& intersectLeaf)
+		{
+			//Only the copy of the layout the geometry asked for is built, the binary tree is the fallback if that failed
+			if (!geometry.wideBVH8.IsEmpty())
+				TraverseWideBVHLeaves(geometry.wideBVH8, ray, intersectLeaf);
+			else if (!geometry.wideBVH4.IsEmpty())
+				TraverseWideBVHLeaves(geometry.wideBVH4, ray, intersectLeaf);
+			else if (!geometry.quantizedBVH.IsEmpty())
+				TraverseQuantizedBVHLeaves(geometry.quantizedBVH, ray, intersectLeaf);
+			else
+				TraverseBVHLeaves(geometry.bvh, ray, intersectLeaf);
+		}
+
+		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		{
+			//Intersect in object space, the direction is not normalized so t is the same in both spaces
+			Ray objectRay{ ray };
+			objectRay.origin = mesh.inverseTransform.TransformPoint(ray.origin);
+			objectRay.direction = mesh.inverseTransform.TransformVector(ray.direction);
+
+			const MeshGeometry& geometry{ *mesh.pGeometry };
+			float t{}, u{}, v{};
+			uint32_t closestSlot{};
+			bool didHit{ false };
+			const auto intersectLeaf{ [&](const BVHNode& leaf, Ray& currentRay)
+				{
+					if (!HitTest_TriangleLeaf(geometry, leaf, mesh.cullMode, currentRay, t, u, v, closestSlot, ignoreHitRecord))
+						return false;
+
+					didHit = true;
+					return ignoreHitRecord;
+				} };
+			TraverseMeshBVHLeaves(geometry, objectRay, intersectLeaf);
+
+			//The hit record is only filled in once, for the closest triangle
+			if (didHit && !ignoreHitRecord)
+			{
+				hitRecord.didHit = true;
+				hitRecord.t = t;
+				hitRecord.u = u;
+				hitRecord.v = v;
+				hitRecord.origin = ray.origin + t * ray.direction;
+				hitRecord.normal = mesh.normalTransform.TransformVector(geometry.triangles[closestSlot].normal).Normalized();
+				hitRecord.material = mesh.material;
+			}
+			return didHit;
 		}
 
 		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
@@ -191,6 +768,115 @@ namespace dae
 			HitRecord temp{};
 			return HitTest_TriangleMesh(mesh, ray, temp, true);
 		}
+
+		/**
+		 * \brief Occlusion test against a mesh, stops at the first triangle inside [ray.min, ray.max] and never shrinks the ray
+		 * \param occluderSlot slot of the triangle that blocked the ray, only written on a hit
+		 */
+		inline bool IsOccluded_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, uint32_t& occluderSlot)
+		{
+			Ray objectRay{ ray };
+			objectRay.origin = mesh.inverseTransform.TransformPoint(ray.origin);
+			objectRay.direction = mesh.inverseTransform.TransformVector(ray.direction);
+
+			const MeshGeometry& geometry{ *mesh.pGeometry };
+			bool isOccluded{ false };
+			TraverseMeshBVHLeaves(geometry, objectRay, [&](const BVHNode& leaf, const Ray& currentRay)
+				{
+					const uint32_t firstBlock{ leaf.leftFirst / TriangleBlockSize };
+					const uint32_t endBlock{ (leaf.leftFirst + leaf.primitiveCount + TriangleBlockSize - 1) / TriangleBlockSize };
+					for (uint32_t block{ firstBlock }; block < endBlock; ++block)
+					{
+						const int lane{ TriangleSIMD::OccludeBlock(geometry.triangleBlocks[block], mesh.cullMode, currentRay) };
+						if (lane == -1)
+							continue;
+
+						RayStats::Add(RayCounter::TriangleTests, static_cast<uint64_t>(block - firstBlock + 1) * TriangleBlockSize);
+						occluderSlot = block * TriangleBlockSize + lane;
+						isOccluded = true;
+						return true;
+					}
+					RayStats::Add(RayCounter::TriangleTests, static_cast<uint64_t>(endBlock - firstBlock) * TriangleBlockSize);
+					return false;
+				});
+			return isOccluded;
+		}
+
+		//Occlusion test against a single triangle of a mesh, the slot a previous IsOccluded_TriangleMesh returned
+		inline bool IsOccluded_Triangle(const TriangleMesh& mesh, uint32_t slot, const Ray& ray)
+		{
+			const MeshGeometry& geometry{ *mesh.pGeometry };
+			if (slot >= geometry.triangles.size())
+				return false;
+
+			Ray objectRay{ ray };
+			objectRay.origin = mesh.inverseTransform.TransformPoint(ray.origin);
+			objectRay.direction = mesh.inverseTransform.TransformVector(ray.direction);
+			RayStats::Add(RayCounter::TriangleTests);
+			float t{}, u{}, v{};
+			return HitTest_Triangle(geometry.triangles[slot], mesh.cullMode, objectRay, t, u, v);
+		}
+
+		/**
+		 * \brief Closest hit of every packet lane in mask, the packet is traced through the mesh BVH in object space
+		 * \param hitRecords one record per lane, only overwritten for lanes that hit the mesh before their packet.max
+		 * \return lanes that hit the mesh, their packet.max is shrunk to the hit distance
+		 */
+		inline RayPacketMask HitTest_TriangleMesh(const TriangleMesh& mesh, RayPacket& packet, RayPacketMask mask, HitRecord* hitRecords)
+		{
+			mask = SlabTest_TriangleMesh(mesh, packet, mask);
+			if (mask == 0)
+				return 0;
+
+			//Diverged packets reach their leaves one lane at a time, transforming all lanes for a single ray would cost far more than tracing it
+			if (std::has_single_bit(mask))
+			{
+				const int lane{ std::countr_zero(mask) };
+				if (!HitTest_TriangleMesh(mesh, packet.GetRay(lane), hitRecords[lane]))
+					return 0;
+				packet.max[lane] = hitRecords[lane].t;
+				return mask;
+			}
+
+			//Same as the single ray test, the object space directions are not normalized so t is the same in both spaces
+			RayPacket objectPacket;
+			packet.Transform(mesh.inverseTransform, objectPacket);
+
+			const MeshGeometry& geometry{ *mesh.pGeometry };
+			uint32_t closestSlots[RayPacketSize];
+			RayPacketMask hitMask{ 0 };
+			TraverseBVHPacket(geometry.bvh, objectPacket, mask, [&](const BVHNode& leaf, RayPacket& currentPacket, RayPacketMask leafMask)
+				{
+					for (RayPacketMask remaining{ leafMask }; remaining != 0; remaining &= remaining - 1)
+					{
+						const int lane{ std::countr_zero(remaining) };
+						Ray ray{ currentPacket.GetRay(lane) };
+						float t{}, u{}, v{};
+						if (!HitTest_TriangleLeaf(geometry, leaf, mesh.cullMode, ray, t, u, v, closestSlots[lane], false))
+							continue;
+
+						HitRecord& hitRecord{ hitRecords[lane] };
+						hitRecord.t = t;
+						hitRecord.u = u;
+						hitRecord.v = v;
+						currentPacket.max[lane] = t;
+						hitMask |= RayPacketMask{ 1 } << lane;
+					}
+				});
+
+			//The rest of the hit records are only filled in once, for the closest triangle
+			for (RayPacketMask remaining{ hitMask }; remaining != 0; remaining &= remaining - 1)
+			{
+				const int lane{ std::countr_zero(remaining) };
+				HitRecord& hitRecord{ hitRecords[lane] };
+				hitRecord.didHit = true;
+				hitRecord.origin = packet.origin + hitRecord.t * packet.GetDirection(lane);
+				hitRecord.normal = mesh.normalTransform.TransformVector(geometry.triangles[closestSlots[lane]].normal).Normalized();
+				hitRecord.material = mesh.material;
+				packet.max[lane] = hitRecord.t;
+			}
+			return hitMask;
+		}
 #pragma endregion
 	}
 
@@ -210,76 +896,28 @@ namespace dae
 
 	namespace Utils
 	{
-		//Just parses vertices and indices
-#pragma warning(push)
-#pragma warning(disable : 4505) //Warning unreferenced local function
-		static bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
+		/**
+		 * \brief Loads a triangulated OBJ with ObjLoader and computes one normal per triangle
+		 * \param normals face normals, one per triangle, the vertex normals of the file are not used
+		 */
+		inline bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
 		{
-			std::ifstream file(filename);
-			if (!file)
+			ObjData data{};
+			if (!ObjLoader::Load(filename, data))
 				return false;
 
-			std::string sCommand;
-			// start a while iteration ending when the end of file is reached (ios::eof)
-			while (!file.eof())
-			{
-				//read the first word of the string, use the >> operator (istream::operator>>) 
-				file >> sCommand;
-				//use conditional statements to process the different commands	
-				if (sCommand == "#")
-				{
-					// Ignore Comment
-				}
-				else if (sCommand == "v")
-				{
-					//Vertex
-					float x, y, z;
-					file >> x >> y >> z;
-					positions.push_back({ x, y, z });
-				}
-				else if (sCommand == "f")
-				{
-					float i0, i1, i2;
-					file >> i0 >> i1 >> i2;
-
-					indices.push_back((int)i0 - 1);
-					indices.push_back((int)i1 - 1);
-					indices.push_back((int)i2 - 1);
-				}
-				//read till end of line and ignore all remaining chars
-				file.ignore(1000, '\n');
-
-				if (file.eof()) 
-					break;
-			}
+			positions = std::move(data.positions);
+			indices = std::move(data.indices);
 
 			//Precompute normals
-			for (uint64_t index = 0; index < indices.size(); index += 3)
+			normals.resize(indices.size() / 3);
+			for (size_t index{ 0 }; index < indices.size(); index += 3)
 			{
-				const uint32_t i0 = indices[index];
-				const uint32_t i1 = indices[index + 1];
-				const uint32_t i2 = indices[index + 2];
-
-				Vector3 edgeV0V1 = positions[i1] - positions[i0];
-				Vector3 edgeV0V2 = positions[i2] - positions[i0];
-				Vector3 normal = Vector3::Cross(edgeV0V1, edgeV0V2);
-
-				if(isnan(normal.x))
-				{
-					int k = 0;
-				}
-
-				normal.Normalize();
-				if (isnan(normal.x))
-				{
-					int k = 0;
-				}
-
-				normals.push_back(normal);
+				const Vector3 edgeV0V1{ positions[indices[index + 1]] - positions[indices[index]] };
+				const Vector3 edgeV0V2{ positions[indices[index + 2]] - positions[indices[index]] };
+				normals[index / 3] = Vector3::Cross(edgeV0V1, edgeV0V2).Normalized();
 			}
-
 			return true;
 		}
-#pragma warning(pop)
 	}
 }
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "WavefrontShading.h"
+
+#include <algorithm>
+
+#include "Material.h"
+#include "TriangleSIMD.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define WAVEFRONT_SIMD_X64
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+using namespace dae;
+
+namespace
+{
+	//Structure of arrays copy of up to 8 Cook-Torrance samples and their material parameters
+	struct alignas(32) CookTorrenceBatch
+	{
+		float lX[ShadingBatchSize], lY[ShadingBatchSize], lZ[ShadingBatchSize];
+		float vX[ShadingBatchSize], vY[ShadingBatchSize], vZ[ShadingBatchSize];
+		float nX[ShadingBatchSize], nY[ShadingBatchSize], nZ[ShadingBatchSize];
+		float albedoR[ShadingBatchSize], albedoG[ShadingBatchSize], albedoB[ShadingBatchSize];
+		float roughness[ShadingBatchSize];
+		float metalness[ShadingBatchSize]; //1 for metals, 0 for dielectrics
+
+		//Output
+		float brdfR[ShadingBatchSize], brdfG[ShadingBatchSize], brdfB[ShadingBatchSize];
+	};
+
+	HitRecord MakeShadingHitRecord(const ShadingSample& sample)
+	{
+		HitRecord hitRecord{};
+		hitRecord.normal = sample.normal;
+		return hitRecord;
+	}
+
+	//Solid colors and Lambert are constant per material, LambertPhong needs a pow per sample and stays scalar
+	template<typename MaterialStruct>
+	void ShadeBucket_Scalar(const std::vector<ShadingSample>& bucket, const std::vector<MaterialStruct>& table, ColorRGB* colors)
+	{
+		for (const ShadingSample& sample : bucket)
+		{
+			colors[sample.colorIndex] += sample.irradiance * table[sample.materialIndex].Shade(MakeShadingHitRecord(sample), sample.l, sample.v);
+		}
+	}
+
+#if defined(WAVEFRONT_SIMD_X64)
+	TARGET_AVX2 inline __m256 Dot_AVX2(__m256 aX, __m256 aY, __m256 aZ, __m256 bX, __m256 bY, __m256 bZ)
+	{
+		return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(aX, bX), _mm256_mul_ps(aY, bY)), _mm256_mul_ps(aZ, bZ));
+	}
+
+	//Same terms as Material_CookTorrence::Shade: Schlick Fresnel, GGX distribution and Smith geometry with Schlick-GGX,
+	//the only difference is the Fresnel power, which is multiplied out instead of calling pow
+	TARGET_AVX2 void ShadeCookTorrence_AVX2(CookTorrenceBatch& batch)
+	{
+		const __m256 one{ _mm256_set1_ps(1.f) };
+		const __m256 pi{ _mm256_set1_ps(PI) };
+		const __m256 lX{ _mm256_load_ps(batch.lX) }, lY{ _mm256_load_ps(batch.lY) }, lZ{ _mm256_load_ps(batch.lZ) };
+		const __m256 vX{ _mm256_load_ps(batch.vX) }, vY{ _mm256_load_ps(batch.vY) }, vZ{ _mm256_load_ps(batch.vZ) };
+		const __m256 nX{ _mm256_load_ps(batch.nX) }, nY{ _mm256_load_ps(batch.nY) }, nZ{ _mm256_load_ps(batch.nZ) };
+		const __m256 albedo[3]{ _mm256_load_ps(batch.albedoR), _mm256_load_ps(batch.albedoG), _mm256_load_ps(batch.albedoB) };
+		const __m256 roughness{ _mm256_load_ps(batch.roughness) };
+		const __m256 isMetal{ _mm256_cmp_ps(_mm256_load_ps(batch.metalness), _mm256_setzero_ps(), _CMP_NEQ_OQ) };
+
+		//Half vector
+		__m256 hX{ _mm256_add_ps(vX, lX) }, hY{ _mm256_add_ps(vY, lY) }, hZ{ _mm256_add_ps(vZ, lZ) };
+		const __m256 invLength{ _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(hX, hX), _mm256_mul_ps(hY, hY)), _mm256_mul_ps(hZ, hZ)))) };
+		hX = _mm256_mul_ps(hX, invLength);
+		hY = _mm256_mul_ps(hY, invLength);
+		hZ = _mm256_mul_ps(hZ, invLength);
+
+		const __m256 hDotV{ Dot_AVX2(hX, hY, hZ, vX, vY, vZ) };
+		const __m256 nDotH{ Dot_AVX2(nX, nY, nZ, hX, hY, hZ) };
+		const __m256 nDotV{ Dot_AVX2(nX, nY, nZ, vX, vY, vZ) };
+		const __m256 nDotL{ Dot_AVX2(nX, nY, nZ, lX, lY, lZ) };
+
+		//Fresnel weight (1 - h.v)^5
+		const __m256 base{ _mm256_sub_ps(one, hDotV) };
+		const __m256 base2{ _mm256_mul_ps(base, base) };
+		const __m256 fresnelWeight{ _mm256_mul_ps(_mm256_mul_ps(base2, base2), base) };
+
+		//GGX: a = roughness^4
+		const __m256 roughness2{ _mm256_mul_ps(roughness, roughness) };
+		const __m256 a{ _mm256_mul_ps(roughness2, roughness2) };
+		const __m256 denominator{ _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(nDotH, nDotH), _mm256_sub_ps(a, one)), one) };
+		const __m256 d{ _mm256_div_ps(a, _mm256_mul_ps(pi, _mm256_mul_ps(denominator, denominator))) };
+
+		//Smith with Schlick-GGX: k = (roughness^2 + 1)^2 / 8
+		const __m256 kBase{ _mm256_add_ps(roughness2, one) };
+		const __m256 k{ _mm256_div_ps(_mm256_mul_ps(kBase, kBase), _mm256_set1_ps(8.f)) };
+		const __m256 oneMinusK{ _mm256_sub_ps(one, k) };
+		const __m256 gV{ _mm256_div_ps(nDotV, _mm256_add_ps(_mm256_mul_ps(nDotV, oneMinusK), k)) };
+		const __m256 gL{ _mm256_div_ps(nDotL, _mm256_add_ps(_mm256_mul_ps(nDotL, oneMinusK), k)) };
+		const __m256 g{ _mm256_mul_ps(gV, gL) };
+
+		const __m256 invDots{ _mm256_div_ps(one, _mm256_mul_ps(_mm256_set1_ps(4.f), _mm256_mul_ps(nDotV, nDotL))) };
+		const __m256 dielectricF0{ _mm256_set1_ps(0.04f) };
+
+		float* brdf[3]{ batch.brdfR, batch.brdfG, batch.brdfB };
+		for (int channel{ 0 }; channel < 3; ++channel)
+		{
+			const __m256 f0{ _mm256_blendv_ps(dielectricF0, albedo[channel], isMetal) };
+			const __m256 f{ _mm256_add_ps(f0, _mm256_mul_ps(_mm256_sub_ps(one, f0), fresnelWeight)) };
+			const __m256 specular{ _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(d, f), g), invDots) };
+
+			//Metals have no diffuse part
+			const __m256 kd{ _mm256_andnot_ps(isMetal, _mm256_sub_ps(one, f)) };
+			const __m256 diffuse{ _mm256_div_ps(_mm256_mul_ps(albedo[channel], kd), pi) };
+			_mm256_store_ps(brdf[channel], _mm256_add_ps(_mm256_mul_ps(kd, diffuse), specular));
+		}
+	}
+#endif
+
+	void ShadeCookTorrenceBucket(const std::vector<ShadingSample>& bucket, const std::vector<Material_CookTorrence>& table, ColorRGB* colors)
+	{
+#if defined(WAVEFRONT_SIMD_X64)
+		if (TriangleSIMD::GetActiveLevel() == SIMDLevel::AVX2)
+		{
+			CookTorrenceBatch batch;
+			for (size_t first{ 0 }; first < bucket.size(); first += ShadingBatchSize)
+			{
+				const uint32_t numSamples{ static_cast<uint32_t>(std::min<size_t>(ShadingBatchSize, bucket.size() - first)) };
+				for (uint32_t lane{ 0 }; lane < ShadingBatchSize; ++lane)
+				{
+					//Unused lanes repeat the last sample so they never divide by zero
+					const ShadingSample& sample{ bucket[first + std::min(lane, numSamples - 1)] };
+					const Material_CookTorrence& material{ table[sample.materialIndex] };
+					batch.lX[lane] = sample.l.x;
+					batch.lY[lane] = sample.l.y;
+					batch.lZ[lane] = sample.l.z;
+					batch.vX[lane] = sample.v.x;
+					batch.vY[lane] = sample.v.y;
+					batch.vZ[lane] = sample.v.z;
+					batch.nX[lane] = sample.normal.x;
+					batch.nY[lane] = sample.normal.y;
+					batch.nZ[lane] = sample.normal.z;
+					batch.albedoR[lane] = material.albedo.r;
+					batch.albedoG[lane] = material.albedo.g;
+					batch.albedoB[lane] = material.albedo.b;
+					batch.roughness[lane] = material.roughness;
+					batch.metalness[lane] = material.metalness ? 1.f : 0.f;
+				}
+
+				ShadeCookTorrence_AVX2(batch);
+
+				for (uint32_t lane{ 0 }; lane < numSamples; ++lane)
+				{
+					const ShadingSample& sample{ bucket[first + lane] };
+					colors[sample.colorIndex] += sample.irradiance * ColorRGB{ batch.brdfR[lane], batch.brdfG[lane], batch.brdfB[lane] };
+				}
+			}
+			return;
+		}
+#endif
+		ShadeBucket_Scalar(bucket, table, colors);
+	}
+}
+
+void ShadingQueue::Clear()
+{
+	for (std::vector<ShadingSample>& bucket : m_Buckets)
+	{
+		bucket.clear();
+	}
+}
+
+void ShadingQueue::Add(MaterialHandle material, ShadingSample sample)
+{
+	sample.materialIndex = material.GetIndex();
+	m_Buckets[static_cast<uint32_t>(material.GetType())].push_back(sample);
+}
+
+void ShadingQueue::Shade(const MaterialTable& materials, ColorRGB* colors) const
+{
+	ShadeBucket_Scalar(m_Buckets[static_cast<uint32_t>(MaterialType::SolidColor)], materials.GetSolidColors(), colors);
+	ShadeBucket_Scalar(m_Buckets[static_cast<uint32_t>(MaterialType::Lambert)], materials.GetLamberts(), colors);
+	ShadeBucket_Scalar(m_Buckets[static_cast<uint32_t>(MaterialType::LambertPhong)], materials.GetLambertPhongs(), colors);
+	ShadeCookTorrenceBucket(m_Buckets[static_cast<uint32_t>(MaterialType::CookTorrence)], materials.GetCookTorrences(), colors);
+}
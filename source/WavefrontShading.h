@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	class MaterialTable;
+
+	constexpr uint32_t ShadingBatchSize{ 8 }; //lanes of the SIMD BRDF kernels
+	constexpr uint32_t NumMaterialTypes{ static_cast<uint32_t>(MaterialType::CookTorrence) + 1 };
+
+	//One light that reaches a hit, waiting for the BRDF of the hit's material
+	struct ShadingSample
+	{
+		Vector3 l{}; //normalized direction to the light
+		Vector3 v{}; //normalized direction to the viewer
+		Vector3 normal{};
+		ColorRGB irradiance{}; //radiance of the light times the Lambert cosine
+		uint32_t materialIndex{}; //slot in the table of the bucket's material type
+		uint32_t colorIndex{}; //output color the shaded sample is added to
+	};
+
+	//Second stage of wavefront shading: light samples are bucketed by material type while a tile is traced,
+	//then every bucket runs through one BRDF kernel, Cook-Torrance 8 samples at a time with AVX2
+	class ShadingQueue final
+	{
+	public:
+		void Clear();
+		void Add(MaterialHandle material, ShadingSample sample);
+
+		/**
+		 * \brief Adds BRDF * irradiance of every queued sample to colors[sample.colorIndex]
+		 * The samples of one output color always share a material, so they are summed in the order they were added
+		 */
+		void Shade(const MaterialTable& materials, ColorRGB* colors) const;
+
+	private:
+		std::vector<ShadingSample> m_Buckets[NumMaterialTypes]{};
+	};
+}
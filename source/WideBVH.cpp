@@ -0,0 +1,144 @@
+#include "WideBVH.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "ThreadPool.h"
+
+using namespace dae;
+
+namespace
+{
+	float HalfSurfaceArea(const BVHNode& node)
+	{
+		const Vector3 extent{ node.maxAABB - node.minAABB };
+		return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+	}
+}
+
+template<int Width>
+void WideBVH<Width>::Build(const BVH& bvh)
+{
+	Clear();
+	if (bvh.IsEmpty())
+		return;
+
+	//Every wide node replaces at least one binary inner node
+	m_Nodes.reserve(bvh.GetNodes().size() / 2 + 1);
+	m_SourceNodes.reserve((bvh.GetNodes().size() / 2 + 1) * Width);
+	BuildNode(bvh, 0);
+}
+
+template<int Width>
+void WideBVH<Width>::Refit(const BVH& bvh, ThreadPool* pThreadPool)
+{
+	const std::vector<BVHNode>& bvhNodes{ bvh.GetNodes() };
+	const auto refitNodes{ [&](size_t first, size_t end)
+		{
+			for (size_t nodeIndex{ first }; nodeIndex < end; ++nodeIndex)
+			{
+				WideBVHNode<Width>& node{ m_Nodes[nodeIndex] };
+				for (int i{ 0 }; i < Width; ++i)
+				{
+					const uint32_t sourceNode{ m_SourceNodes[nodeIndex * Width + i] };
+					if (sourceNode == BVH::InvalidPrimitive)
+						continue;
+
+					const BVHNode& child{ bvhNodes[sourceNode] };
+					node.minX[i] = child.minAABB.x;
+					node.minY[i] = child.minAABB.y;
+					node.minZ[i] = child.minAABB.z;
+					node.maxX[i] = child.maxAABB.x;
+					node.maxY[i] = child.maxAABB.y;
+					node.maxZ[i] = child.maxAABB.z;
+				}
+			}
+		} };
+
+	const uint32_t numChunks{ static_cast<uint32_t>((m_Nodes.size() + RefitChunkSize - 1) / RefitChunkSize) };
+	if (!pThreadPool || numChunks <= 1)
+	{
+		refitNodes(0, m_Nodes.size());
+		return;
+	}
+	pThreadPool->ParallelFor(numChunks, [&](uint32_t chunk, uint32_t)
+		{
+			refitNodes(static_cast<size_t>(chunk) * RefitChunkSize, std::min(m_Nodes.size(), static_cast<size_t>(chunk + 1) * RefitChunkSize));
+		});
+}
+
+template<int Width>
+uint32_t WideBVH<Width>::BuildNode(const BVH& bvh, uint32_t bvhNodeIndex)
+{
+	const std::vector<BVHNode>& bvhNodes{ bvh.GetNodes() };
+	const BVHNode& bvhNode{ bvhNodes[bvhNodeIndex] };
+
+	//Open the largest inner child until the node is full, large children are the ones most rays have to enter anyway
+	uint32_t children[Width]{};
+	int childCount{ 0 };
+	if (bvhNode.IsLeaf())
+	{
+		children[childCount++] = bvhNodeIndex;
+	}
+	else
+	{
+		children[childCount++] = bvhNode.leftFirst;
+		children[childCount++] = bvhNode.leftFirst + 1;
+	}
+	while (childCount < Width)
+	{
+		int largestChild{ -1 };
+		float largestArea{ -1.f };
+		for (int i{ 0 }; i < childCount; ++i)
+		{
+			const BVHNode& child{ bvhNodes[children[i]] };
+			if (!child.IsLeaf() && HalfSurfaceArea(child) > largestArea)
+			{
+				largestChild = i;
+				largestArea = HalfSurfaceArea(child);
+			}
+		}
+		if (largestChild == -1)
+			break;
+
+		const uint32_t openedChild{ children[largestChild] };
+		children[largestChild] = bvhNodes[openedChild].leftFirst;
+		children[childCount++] = bvhNodes[openedChild].leftFirst + 1;
+	}
+
+	const uint32_t nodeIndex{ static_cast<uint32_t>(m_Nodes.size()) };
+	m_Nodes.emplace_back();
+	m_SourceNodes.resize(m_SourceNodes.size() + Width, BVH::InvalidPrimitive);
+
+	constexpr float infinity{ std::numeric_limits<float>::infinity() };
+	for (int i{ 0 }; i < Width; ++i)
+	{
+		if (i >= childCount)
+		{
+			m_Nodes[nodeIndex].minX[i] = m_Nodes[nodeIndex].minY[i] = m_Nodes[nodeIndex].minZ[i] = infinity;
+			m_Nodes[nodeIndex].maxX[i] = m_Nodes[nodeIndex].maxY[i] = m_Nodes[nodeIndex].maxZ[i] = infinity;
+			m_Nodes[nodeIndex].leftFirst[i] = 0;
+			m_Nodes[nodeIndex].primitiveCount[i] = 0;
+			continue;
+		}
+
+		const BVHNode& child{ bvhNodes[children[i]] };
+		m_SourceNodes[static_cast<size_t>(nodeIndex) * Width + i] = children[i];
+		//Recursing grows m_Nodes, so the node is only indexed after it
+		const uint32_t leftFirst{ child.IsLeaf() ? child.leftFirst : BuildNode(bvh, children[i]) };
+
+		WideBVHNode<Width>& node{ m_Nodes[nodeIndex] };
+		node.minX[i] = child.minAABB.x;
+		node.minY[i] = child.minAABB.y;
+		node.minZ[i] = child.minAABB.z;
+		node.maxX[i] = child.maxAABB.x;
+		node.maxY[i] = child.maxAABB.y;
+		node.maxZ[i] = child.maxAABB.z;
+		node.leftFirst[i] = leftFirst;
+		node.primitiveCount[i] = child.primitiveCount;
+	}
+	return nodeIndex;
+}
+
+template class dae::WideBVH<4>;
+template class dae::WideBVH<8>;
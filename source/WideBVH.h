@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "BVH.h"
+
+namespace dae
+{
+	class ThreadPool;
+
+	//Up to Width children of a collapsed node in structure of arrays form, so one SIMD slab test covers all of them
+	//Unused lanes get a box with every bound at +infinity, every ray misses it without a separate lane mask
+	template<int Width>
+	struct alignas(32) WideBVHNode
+	{
+		float minX[Width], minY[Width], minZ[Width];
+		float maxX[Width], maxY[Width], maxZ[Width];
+		uint32_t leftFirst[Width]; //inner: index of the child's node, leaf: index of the first primitive slot
+		uint32_t primitiveCount[Width]; //0 for inner and unused children
+	};
+	static_assert(sizeof(WideBVHNode<4>) == 128);
+	static_assert(sizeof(WideBVHNode<8>) == 256);
+
+	/**
+	 * \brief Copy of a binary BVH collapsed into nodes with up to Width children (BVH4, BVH8)
+	 * Each wide node takes the children of a binary node and keeps opening the inner child with the largest surface
+	 * until Width children are found, so the SAH tree's leaves and primitive slots are kept as they are
+	 */
+	template<int Width>
+	class WideBVH final
+	{
+	public:
+		WideBVH() = default;
+		~WideBVH() = default;
+
+		//(Re)builds from bvh, node 0 is the root and a BVH that is a single leaf becomes a root with one child
+		void Build(const BVH& bvh);
+		/**
+		 * \brief Copies the bounds of a refit bvh into the nodes built from it, the binary topology must be unchanged since Build
+		 * \param pThreadPool if set, large trees copy their nodes in parallel chunks
+		 */
+		void Refit(const BVH& bvh, ThreadPool* pThreadPool = nullptr);
+		void Clear()
+		{
+			m_Nodes.clear();
+			m_SourceNodes.clear();
+		}
+
+		bool IsEmpty() const { return m_Nodes.empty(); }
+		const std::vector<WideBVHNode<Width>>& GetNodes() const { return m_Nodes; }
+		size_t GetMemoryUsage() const { return m_Nodes.size() * sizeof(WideBVHNode<Width>); }
+
+		//A wide tree is never deeper than the binary one, every level pushes at most Width - 1 children
+		static constexpr int MaxStackSize{ BVH::MaxDepth * (Width - 1) + 1 };
+		//Nodes copied per task of a parallel Refit
+		static constexpr uint32_t RefitChunkSize{ 1024 };
+
+	private:
+		std::vector<WideBVHNode<Width>> m_Nodes{};
+		//Binary node every child lane was collapsed from, Width per node, BVH::InvalidPrimitive for unused lanes
+		//Refits copy through it, collapsing again could open different children once the surface areas changed
+		std::vector<uint32_t> m_SourceNodes{};
+
+		uint32_t BuildNode(const BVH& bvh, uint32_t bvhNodeIndex);
+	};
+}
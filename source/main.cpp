@@ -1,16 +1,26 @@
 //External includes
+#if defined(_WIN32)
 #include "vld.h"
+#endif
 #include "SDL.h"
 #include "SDL_surface.h"
 #undef main
 
 //Standard includes
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <string>
 
 //Project includes
 #include "Timer.h"
 #include "Renderer.h"
+#include "FrameSink.h"
 #include "Scene.h"
+#include "MicroBenchmarks.h"
+#include "Benchmark.h"
+#include "Profiler.h"
 
 using namespace dae;
 
@@ -25,35 +35,286 @@ void ShutDown(SDL_Window* pWindow)
 	SDL_Quit();
 }
 
+struct RenderOptions
+{
+	std::string sceneName{}; //empty renders the Reference scene, or every scene when benchmarking
+	int width{ 640 };
+	int height{ 480 };
+	uint32_t numThreads{ 0 }; //0 uses every hardware thread
+	int tileSize{ 0 }; //0 keeps the renderer default
+	ToneMappingSettings toneMapping{};
+	bool isProgressive{ false };
+
+	bool isHeadless{ false };
+	int numFrames{ 1 };
+	float timeStep{ 1.f / 30.f }; //headless frames advance the scene by a fixed step so runs are reproducible
+	std::string outputPrefix{}; //empty keeps headless frames in memory only
+	std::string tracePath{}; //non empty profiles all headless frames and writes a Chrome trace here
+
+	std::string benchmarkPath{}; //non empty runs the benchmark and writes its results here
+	int numBenchmarkFrames{ 60 };
+};
+
+void PrintUsage()
+{
+	std::cout << "Usage: RayTracer [options]\n"
+		<< "  --scene <name>       scene to render:";
+	for (const std::string& sceneName : GetSceneNames())
+		std::cout << " " << sceneName;
+	std::cout << ",\n"
+		<< "                       or the path of a .scene file\n"
+		<< "  --width <pixels>     framebuffer width (640)\n"
+		<< "  --height <pixels>    framebuffer height (480)\n"
+		<< "  --threads <count>    render threads, 0 for all hardware threads (0)\n"
+		<< "  --tile-size <pixels> width and height of a scheduled screen tile (16)\n"
+		<< "  --exposure <scale>   multiplies the linear colors before tone mapping (1)\n"
+		<< "  --tonemap <name>     clamp, reinhard or aces (clamp), F10 cycles them in the window\n"
+		<< "  --srgb               encode the output as sRGB instead of storing linear values, F11 toggles it\n"
+		<< "  --progressive        accumulate jittered samples while the view is static, F12 toggles it\n"
+		<< "  --headless           render without a window and exit\n"
+		<< "  --frames <count>     frames to render in headless mode (1)\n"
+		<< "  --time-step <sec>    scene time between headless frames (0.0333)\n"
+		<< "  --output <prefix>    save headless frames as <prefix>_0000.bmp, ...\n"
+		<< "  --trace <file>       write a Chrome trace of the headless frames, F8 toggles a capture in the window\n"
+		<< "  --benchmark <file>   render a fixed camera path over every scene (or --scene) and write the frame times as JSON\n"
+		<< "  --bench-frames <n>    measured frames per scene in the benchmark (60)\n"
+		<< "  --bench-kernels      run the triangle and sphere kernel micro benchmarks\n"
+		<< "  --bench-packets      run the primary ray packet micro benchmark\n"
+		<< "  --bench-bvh [obj]    compare the SAH and linear BVH builders on a mesh (Resources/lowpoly_bunny2.obj)\n"
+		<< "  --bench-quantized [obj]  compare the memory and trace speed of quantized BVH nodes on a mesh (Resources/lowpoly_bunny2.obj)\n"
+		<< "  --bench-wide [obj]   compare binary, BVH4 and BVH8 traversal of closest hit and shadow rays on a mesh (Resources/lowpoly_bunny2.obj)" << std::endl;
+}
+
+bool ParseToneMapper(const std::string& name, ToneMapper& toneMapper)
+{
+	if (name == "clamp") toneMapper = ToneMapper::Clamp;
+	else if (name == "reinhard") toneMapper = ToneMapper::Reinhard;
+	else if (name == "aces") toneMapper = ToneMapper::ACES;
+	else return false;
+	return true;
+}
+
+void PrintRayStatistics(const RayStatistics& statistics)
+{
+	std::cout << "Last frame:";
+	for (int i{ 0 }; i < NumRayCounters; ++i)
+	{
+		std::cout << (i == 0 ? " " : ", ") << statistics.counts[i] << " " << RayStats::ToString(static_cast<RayCounter>(i));
+	}
+	std::cout << std::endl;
+}
+
+Renderer* CreateRenderer(const RenderOptions& options)
+{
+	const auto pRenderer = new Renderer(options.width, options.height);
+	if (options.numThreads > 0)
+		pRenderer->SetThreadCount(options.numThreads);
+	if (options.tileSize > 0)
+		pRenderer->SetTileSize(options.tileSize);
+	pRenderer->SetToneMapping(options.toneMapping);
+	if (options.isProgressive)
+		pRenderer->ToggleProgressive();
+	std::cout << "Rendering " << options.width << "x" << options.height << " with " << pRenderer->GetThreadCount() << " threads, "
+		<< pRenderer->GetTileSize() << "x" << pRenderer->GetTileSize() << " tiles" << std::endl;
+	return pRenderer;
+}
+
+//Renders a fixed number of frames without creating a window, frames go to image files or stay in memory
+int RunHeadless(const RenderOptions& options)
+{
+	Scene* pScene{ CreateScene(options.sceneName) };
+	if (!pScene)
+	{
+		std::cout << "Unknown scene " << options.sceneName << std::endl;
+		return 1;
+	}
+	pScene->GetCamera().isInputEnabled = false;
+	pScene->Initialize();
+
+	Renderer* pRenderer{ CreateRenderer(options) };
+	ImageFileSink imageFileSink{ options.outputPrefix };
+	if (!options.outputPrefix.empty())
+		pRenderer->SetFrameSink(&imageFileSink);
+
+	Timer timer{};
+	timer.SetFixedTimeStep(options.timeStep);
+	timer.Start();
+
+	if (!options.tracePath.empty())
+		Profiler::BeginCapture();
+
+	double totalMilliseconds{ 0.0 };
+	for (int frame{ 0 }; frame < options.numFrames; ++frame)
+	{
+		PROFILE_ZONE("Frame");
+		{
+			PROFILE_ZONE("Scene::Update");
+			pScene->Update(&timer);
+		}
+
+		const auto start{ std::chrono::steady_clock::now() };
+		pRenderer->Render(pScene);
+		const std::chrono::duration<double, std::milli> elapsed{ std::chrono::steady_clock::now() - start };
+		totalMilliseconds += elapsed.count();
+		std::cout << "Frame " << frame << ": " << elapsed.count() << " ms, " << pRenderer->GetFrameStatistics().GetRayCount() << " rays" << std::endl;
+
+		timer.Update();
+	}
+	timer.Stop();
+
+	if (options.numFrames > 0)
+	{
+		std::cout << "Average: " << totalMilliseconds / options.numFrames << " ms/frame" << std::endl;
+		PrintRayStatistics(pRenderer->GetFrameStatistics());
+	}
+
+	if (!options.tracePath.empty())
+	{
+		Profiler::EndCapture();
+		if (Profiler::WriteChromeTrace(options.tracePath))
+			std::cout << "Trace written to " << options.tracePath << std::endl;
+		else
+			std::cout << "Could not write " << options.tracePath << std::endl;
+	}
+
+	delete pRenderer;
+	delete pScene;
+	return 0;
+}
+
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
-	
+	Profiler::SetThreadName("Main");
+
+	//Command line
+	RenderOptions options{};
+	for (int i{ 1 }; i < argc; ++i)
+	{
+		const std::string argument{ args[i] };
+		const bool hasValue{ i + 1 < argc };
+		if (argument == "--scene" && hasValue)
+			options.sceneName = args[++i];
+		else if (argument == "--width" && hasValue)
+			options.width = std::max(1, std::atoi(args[++i]));
+		else if (argument == "--height" && hasValue)
+			options.height = std::max(1, std::atoi(args[++i]));
+		else if (argument == "--threads" && hasValue)
+			options.numThreads = static_cast<uint32_t>(std::max(0, std::atoi(args[++i])));
+		else if (argument == "--tile-size" && hasValue)
+			options.tileSize = std::atoi(args[++i]);
+		else if (argument == "--exposure" && hasValue)
+			options.toneMapping.exposure = static_cast<float>(std::atof(args[++i]));
+		else if (argument == "--tonemap" && hasValue && ParseToneMapper(args[i + 1], options.toneMapping.toneMapper))
+			++i;
+		else if (argument == "--srgb")
+			options.toneMapping.encodeSRGB = true;
+		else if (argument == "--progressive")
+			options.isProgressive = true;
+		else if (argument == "--headless")
+			options.isHeadless = true;
+		else if (argument == "--frames" && hasValue)
+			options.numFrames = std::max(0, std::atoi(args[++i]));
+		else if (argument == "--time-step" && hasValue)
+			options.timeStep = static_cast<float>(std::atof(args[++i]));
+		else if (argument == "--output" && hasValue)
+			options.outputPrefix = args[++i];
+		else if (argument == "--trace" && hasValue)
+			options.tracePath = args[++i];
+		else if (argument == "--benchmark" && hasValue)
+			options.benchmarkPath = args[++i];
+		else if (argument == "--bench-frames" && hasValue)
+			options.numBenchmarkFrames = std::max(1, std::atoi(args[++i]));
+		else if (argument == "--bench-kernels")
+		{
+			MicroBenchmarks::RunTriangleKernel();
+			MicroBenchmarks::RunTriangleBlockKernels();
+			MicroBenchmarks::RunRaySphere();
+			return 0;
+		}
+		else if (argument == "--bench-packets")
+		{
+			MicroBenchmarks::RunPrimaryRays();
+			return 0;
+		}
+		else if (argument == "--bench-bvh")
+		{
+			if (hasValue && std::string{ args[i + 1] }.rfind("--", 0) != 0)
+				MicroBenchmarks::RunBVHBuilders(args[i + 1]);
+			else
+				MicroBenchmarks::RunBVHBuilders();
+			return 0;
+		}
+		else if (argument == "--bench-quantized")
+		{
+			if (hasValue && std::string{ args[i + 1] }.rfind("--", 0) != 0)
+				MicroBenchmarks::RunQuantizedBVH(args[i + 1]);
+			else
+				MicroBenchmarks::RunQuantizedBVH();
+			return 0;
+		}
+		else if (argument == "--bench-wide")
+		{
+			if (hasValue && std::string{ args[i + 1] }.rfind("--", 0) != 0)
+				MicroBenchmarks::RunWideBVH(args[i + 1]);
+			else
+				MicroBenchmarks::RunWideBVH();
+			return 0;
+		}
+		else
+		{
+			PrintUsage();
+			return argument == "--help" ? 0 : 1;
+		}
+	}
+
+	if (!options.benchmarkPath.empty())
+	{
+		BenchmarkSettings settings{};
+		if (!options.sceneName.empty())
+			settings.sceneNames.push_back(options.sceneName);
+		settings.width = options.width;
+		settings.height = options.height;
+		settings.numThreads = options.numThreads;
+		settings.tileSize = options.tileSize;
+		settings.numFrames = options.numBenchmarkFrames;
+		settings.timeStep = options.timeStep;
+		settings.outputPath = options.benchmarkPath;
+		return Benchmark::Run(settings);
+	}
+
+	if (options.sceneName.empty())
+		options.sceneName = "Reference";
+
+	if (options.isHeadless)
+		return RunHeadless(options);
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
 
-	const uint32_t width = 640;
-	const uint32_t height = 480;
-
 	SDL_Window* pWindow = SDL_CreateWindow(
 		"RayTracer - **Dresselaers Joren (2DAE07)**",
 		SDL_WINDOWPOS_UNDEFINED,
 		SDL_WINDOWPOS_UNDEFINED,
-		width, height, 0);
+		options.width, options.height, 0);
 
 	if (!pWindow)
 		return 1;
 
 	//Initialize "framework"
 	const auto pTimer = new Timer();
-	const auto pRenderer = new Renderer(pWindow);
+	const auto pRenderer = CreateRenderer(options);
+	WindowSink windowSink{ pWindow };
+	pRenderer->SetFrameSink(&windowSink);
 
-	//const auto pScene = new Scene_W4_ExtraScene();
-	//const auto pScene = new Scene_W4_BunnyScene();
-	const auto pScene = new Scene_W4_ReferenceScene();
+	const auto pScene = CreateScene(options.sceneName);
+	if (!pScene)
+	{
+		std::cout << "Unknown scene " << options.sceneName << std::endl;
+		delete pRenderer;
+		delete pTimer;
+		ShutDown(pWindow);
+		return 1;
+	}
 	pScene->Initialize();
 
 	//Start loop
@@ -61,8 +322,29 @@ int main(int argc, char* args[])
 	float printTimer = 0.f;
 	bool isLooping = true;
 	bool takeScreenshot = false;
+	bool toggleCapture = false;
 	while (isLooping)
 	{
+		//Captures start and stop between frames, so the trace only holds complete frames
+		if (toggleCapture)
+		{
+			if (!Profiler::IsCapturing())
+			{
+				Profiler::BeginCapture();
+				std::cout << "Profiling, press F8 again to write the trace" << std::endl;
+			}
+			else
+			{
+				Profiler::EndCapture();
+				if (Profiler::WriteChromeTrace("RayTracing_Trace.json"))
+					std::cout << "Trace saved!" << std::endl;
+				else
+					std::cout << "Something went wrong. Trace not saved!" << std::endl;
+			}
+			toggleCapture = false;
+		}
+		PROFILE_ZONE("Frame");
+
 		//--------- Get input events ---------
 		SDL_Event e;
 		int mouseX{}, mouseY{};
@@ -96,6 +378,24 @@ int main(int argc, char* args[])
 				case SDL_SCANCODE_F6:
 					pTimer->StartBenchmark();
 					break;
+				case SDL_SCANCODE_F7:
+					pRenderer->TogglePacketTracing();
+					break;
+				case SDL_SCANCODE_F8:
+					toggleCapture = true;
+					break;
+				case SDL_SCANCODE_F9:
+					pRenderer->ToggleWavefrontShading();
+					break;
+				case SDL_SCANCODE_F10:
+					pRenderer->CycleToneMapper();
+					break;
+				case SDL_SCANCODE_F11:
+					pRenderer->ToggleSRGB();
+					break;
+				case SDL_SCANCODE_F12:
+					pRenderer->ToggleProgressive();
+					break;
 				case SDL_SCANCODE_1:
 					pScene->MoveSelectedBall(Vector3(0.f, 1.f, 0.f));
 					break;
@@ -133,7 +433,10 @@ int main(int argc, char* args[])
 		}
 
 		//--------- Update ---------
-		pScene->Update(pTimer);
+		{
+			PROFILE_ZONE("Scene::Update");
+			pScene->Update(pTimer);
+		}
 
 		//--------- Render ---------
 		pRenderer->Render(pScene);
@@ -145,6 +448,7 @@ int main(int argc, char* args[])
 		{
 			printTimer = 0.f;
 			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+			PrintRayStatistics(pRenderer->GetFrameStatistics());
 		}
 
 		//Save screenshot after full render